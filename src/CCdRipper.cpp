@@ -1,21 +1,96 @@
 #include "CCdRipper.h"
 
+#include <stdexcept>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+
+#include "CSectorRingBuffer.h"
+#include "CFileNameGenerator.h"
+
 #include <iostream>
 using std::cout;
 using std::endl;
 
 using std::vector;
 
-CCdRipper::CCdRipper(ISourceCdda& src, ISink& snk) : source(src), canceled(false)
+CCdRipper::CCdRipper(ISourceCdda& src, ISink& snk)
+    : source(src), ringsize(750), batchsize(75), canceled(false), nencoders(1)
 {
     sinks.emplace_back(snk);
 }
 
 CCdRipper::CCdRipper(ISourceCdda& src, const ISinkRefVector &snks)
-    : source(src), sinks(snks) {}
+    : source(src), sinks(snks), ringsize(750), batchsize(75), canceled(false), nencoders(1) {}
 
 CCdRipper::~CCdRipper() {}
 
+/**
+ * @brief Set the size of the sector ring buffer between the reader
+ *        and the sinks
+ * @param[in] number of sectors in the ring. If 0, the sectors are read
+ *            and written synchronously on a single thread.
+ * @throw runtime_error if thread is already running
+ */
+void CCdRipper::SetBufferSize(const size_t nsectors)
+{
+    if (Running()) throw(std::runtime_error("CCdRipper thread is already running."));
+    ringsize = nsectors;
+}
+
+/**
+ * @brief Set the number of sectors read from the source and written to
+ *        the sinks at once
+ * @param[in] number of sectors per read/write (must be positive)
+ * @throw runtime_error if thread is already running
+ * @throw invalid_argument if nsectors is zero
+ */
+void CCdRipper::SetBatchSize(const size_t nsectors)
+{
+    if (Running()) throw(std::runtime_error("CCdRipper thread is already running."));
+    if (!nsectors) throw(std::invalid_argument("CCdRipper batch size must be positive."));
+    batchsize = nsectors;
+}
+
+/**
+ * @brief Enable the per-track mode, in which each track is saved to its
+ *        own file.
+ * @param[in] cuesheet with track index 1 times and total time populated
+ *            along with the metadata for file naming
+ * @param[in] file name generator
+ * @param[in] function to create the sink for each track file
+ * @param[in] number of encoder threads (0 to use the number of cores)
+ * @throw runtime_error if thread is already running
+ * @throw invalid_argument if cuesheet has no track or factory is empty
+ */
+void CCdRipper::SetTrackMode(const SCueSheet &cuesheet, const CFileNameGenerator &namer,
+                             const TrackSinkFactory &factory, const unsigned n)
+{
+    if (Running()) throw(std::runtime_error("CCdRipper thread is already running."));
+    if (cuesheet.Tracks.empty()) throw(std::invalid_argument("Cuesheet has no track."));
+    if (!factory) throw(std::invalid_argument("Track sink factory is not given."));
+
+    track_cuesheet = cuesheet;
+    track_namer.reset(new CFileNameGenerator(namer));
+    track_factory = factory;
+    nencoders = n ? n : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * @brief Disable the per-track mode
+ * @throw runtime_error if thread is already running
+ */
+void CCdRipper::ClearTrackMode()
+{
+    if (Running()) throw(std::runtime_error("CCdRipper thread is already running."));
+
+    track_namer.reset();
+    track_factory = nullptr;
+}
+
 void CCdRipper::ThreadMain()
 {
     canceled = false;
@@ -30,21 +105,9 @@ void CCdRipper::ThreadMain()
     try
     {
         // Rip now!
-        size_t framesize = source.GetSectorSize();
-        const int16_t* data = source.ReadNextSector(); /* returns non-NULL until end of CD */
-
-        while (data && ~stop_request)
-        {
-            // Write data to all sinks
-            for (it = sinks.begin(); it!=sinks.end(); it++)
-                (*it).get().WriteFrame(data, framesize, sign);
-
-            // Read next sector
-            data = source.ReadNextSector(); /* returns non-NULL until end of CD */
-        }
-
-        // if operatio is canceled
-        if (data) canceled = true;
+        if (track_factory) RipTracks_(sign);
+        else if (ringsize && !sinks.empty()) RipBuffered_(sign); // ring needs a reader
+        else RipDirect_(sign);
     }
     catch (...)
     {
@@ -58,3 +121,292 @@ void CCdRipper::ThreadMain()
     for (it = sinks.begin(); it!=sinks.end(); it++)
         (*it).get().Unlock(sign);
 }
+
+void CCdRipper::RipDirect_(const uintptr_t sign)
+{
+    ISinkRefVector::iterator it;
+
+    size_t sectorsize = source.GetSectorSize();
+    vector<int16_t> data(batchsize*sectorsize);
+    size_t n = source.ReadSectors(data.data(), batchsize); /* returns non-zero until end of CD */
+
+    while (n && !stop_request)
+    {
+        // Write data to all sinks
+        for (it = sinks.begin(); it!=sinks.end(); it++)
+            (*it).get().WriteFrame(data.data(), n*sectorsize, sign);
+
+        // Read next batch of sectors
+        n = source.ReadSectors(data.data(), batchsize); /* returns non-zero until end of CD */
+    }
+
+    // if operatio is canceled
+    if (n) canceled = true;
+}
+
+void CCdRipper::RipBuffered_(const uintptr_t sign)
+{
+    size_t nsinks = sinks.size();
+    size_t nslots = (ringsize+batchsize-1)/batchsize; // round up
+    CSectorRingBuffer ring(nslots, batchsize*source.GetSectorSize(), nsinks);
+
+    // start one writer thread per sink, keeping their exceptions (if thrown)
+    // to be rethrown here
+    vector<std::exception_ptr> write_errors(nsinks);
+    vector<std::thread> writers;
+    writers.reserve(nsinks);
+    for (size_t i=0; i<nsinks; i++)
+    {
+        writers.emplace_back([&,i]()
+        {
+            try
+            {
+                WriteSectors_(ring, i, sign);
+            }
+            catch (...)
+            {
+                write_errors[i] = std::current_exception();
+                ring.Abort();
+            }
+        });
+    }
+
+    try
+    {
+        // read sectors on this thread
+        ReadSectors_(ring);
+    }
+    catch (...)
+    {
+        // stop the writers and rethrow the exception
+        ring.Abort();
+        for (size_t i=0; i<nsinks; i++) writers[i].join();
+        throw;
+    }
+
+    for (size_t i=0; i<nsinks; i++) writers[i].join();
+
+    // forward the first write error (if any)
+    for (size_t i=0; i<nsinks; i++)
+        if (write_errors[i]) std::rethrow_exception(write_errors[i]);
+}
+
+void CCdRipper::ReadSectors_(CSectorRingBuffer &ring)
+{
+    size_t sectorsize = source.GetSectorSize();
+    size_t n = 1;
+
+    while (n && !stop_request)
+    {
+        // wait for a free slot (returns NULL if a writer aborted)
+        int16_t *slot = ring.BeginWrite();
+        if (!slot) return;
+
+        // Read next batch of sectors directly into the slot
+        n = source.ReadSectors(slot, batchsize); /* returns non-zero until end of CD */
+        if (n) ring.EndWrite(n*sectorsize);
+    }
+
+    // if operation is canceled, drop the buffered sectors
+    if (n)
+    {
+        canceled = true;
+        ring.Abort();
+    }
+    else // no more data
+    {
+        ring.Close();
+    }
+}
+
+void CCdRipper::WriteSectors_(CSectorRingBuffer &ring, const size_t reader, const uintptr_t sign)
+{
+    ISink &sink = sinks[reader].get();
+
+    size_t framesize;
+    const int16_t* data = ring.BeginRead(framesize, reader); /* returns non-NULL until end of CD */
+
+    while (data)
+    {
+        sink.WriteFrame(data, framesize, sign);
+
+        // release the slot & get the next
+        ring.EndRead(reader);
+        data = ring.BeginRead(framesize, reader);
+    }
+}
+
+void CCdRipper::RipTracks_(const uintptr_t sign)
+{
+    struct STrackJob
+    {
+        size_t track;
+        vector<int16_t> data;
+    };
+
+    size_t sectorsize = source.GetSectorSize();
+    size_t ntracks = track_cuesheet.Tracks.size();
+
+    // track boundaries in sectors: from index 1 of a track to index 1 of the next
+    vector<size_t> bounds(ntracks+1);
+    for (size_t i=0; i<ntracks; i++)
+        bounds[i] = track_cuesheet.Tracks[i].StartTime();
+    bounds[ntracks] = source.GetLength();
+
+    // job queue shared with the encoders. To bound the memory use, at most
+    // 2 tracks per encoder are held (queued or being encoded).
+    std::mutex mutex_jobs;
+    std::condition_variable cv_jobs;
+    std::deque<STrackJob> jobs;
+    size_t npending = 0;
+    bool done = false;
+    std::exception_ptr error;
+
+    vector<std::thread> encoders;
+    encoders.reserve(nencoders);
+    for (unsigned i=0; i<nencoders; i++)
+    {
+        encoders.emplace_back([&]()
+        {
+            std::unique_lock<std::mutex> lck(mutex_jobs);
+            while (true)
+            {
+                while (jobs.empty() && !done) cv_jobs.wait(lck);
+                if (jobs.empty()) return;
+
+                STrackJob job = std::move(jobs.front());
+                jobs.pop_front();
+
+                lck.unlock();
+                try
+                {
+                    EncodeTrack_(job.track, job.data, sign);
+                    lck.lock();
+                }
+                catch (...)
+                {
+                    // keep the first error & drop the remaining tracks
+                    lck.lock();
+                    if (!error) error = std::current_exception();
+                    npending -= jobs.size();
+                    jobs.clear();
+                }
+
+                npending--;
+                cv_jobs.notify_all();
+            }
+        });
+    }
+
+    // queue a completed track (returns false if an encoder failed)
+    auto submit = [&](const size_t track, vector<int16_t> &data) -> bool
+    {
+        std::unique_lock<std::mutex> lck(mutex_jobs);
+        while (!error && npending>=2*nencoders) cv_jobs.wait(lck);
+        if (error) return false;
+
+        jobs.push_back(STrackJob{track, std::move(data)});
+        npending++;
+        cv_jobs.notify_all();
+        return true;
+    };
+
+    // let the encoders finish the queued tracks & exit (or drop them if canceled)
+    auto finish = [&](const bool drop)
+    {
+        {
+            std::lock_guard<std::mutex> lck(mutex_jobs);
+            if (drop)
+            {
+                npending -= jobs.size();
+                jobs.clear();
+            }
+            done = true;
+            cv_jobs.notify_all();
+        }
+        for (size_t i=0; i<encoders.size(); i++) encoders[i].join();
+    };
+
+    size_t n = 0;
+    try
+    {
+        vector<int16_t> data(batchsize*sectorsize);
+        vector<int16_t> trackdata;
+        size_t itrk = 0; // index of the current track
+        size_t pos = 0;  // sector position of data
+        bool ok = true;
+
+        trackdata.reserve((bounds[1]-bounds[0])*sectorsize);
+
+        n = source.ReadSectors(data.data(), batchsize); /* returns non-zero until end of CD */
+        while (n && ok && !stop_request)
+        {
+            // Write data to all disc sinks
+            for (ISinkRefVector::iterator it = sinks.begin(); it!=sinks.end(); it++)
+                (*it).get().WriteFrame(data.data(), n*sectorsize, sign);
+
+            // split data into the tracks
+            size_t i = 0;
+            while (i<n && itrk<ntracks && ok)
+            {
+                if (pos+i<bounds[itrk]) // before the first track
+                {
+                    i = std::min(n, bounds[itrk]-pos);
+                    continue;
+                }
+
+                size_t m = std::min(n, bounds[itrk+1]-pos);
+                trackdata.insert(trackdata.end(), data.begin()+i*sectorsize, data.begin()+m*sectorsize);
+                i = m;
+
+                if (pos+i==bounds[itrk+1]) // end of the track
+                {
+                    ok = submit(++itrk, trackdata);
+                    trackdata.clear();
+                    if (itrk<ntracks) trackdata.reserve((bounds[itrk+1]-bounds[itrk])*sectorsize);
+                }
+            }
+            pos += n;
+
+            // Read next batch of sectors
+            if (ok) n = source.ReadSectors(data.data(), batchsize); /* returns non-zero until end of CD */
+        }
+
+        // disc ended short of the expected length: save what is read of the last track
+        if (!n && ok && !trackdata.empty()) submit(itrk+1, trackdata);
+    }
+    catch (...)
+    {
+        // stop the encoders and rethrow the exception
+        finish(true);
+        throw;
+    }
+
+    // if operation is canceled (or failed), drop the queued tracks
+    finish(n!=0);
+    canceled = n && !error;
+
+    // forward the encoder error (if any)
+    if (error) std::rethrow_exception(error);
+}
+
+void CCdRipper::EncodeTrack_(const size_t track, const vector<int16_t> &data, const uintptr_t sign)
+{
+    std::unique_ptr<ISink> sink(track_factory((*track_namer)(track_cuesheet, track)));
+    if (!sink) throw(std::runtime_error("Failed to create the track sink."));
+
+    sink->Lock(sign);
+    try
+    {
+        sink->Reserve(data.size());
+        sink->WritePreamble(sign);
+        sink->WriteFrame(data.data(), data.size(), sign);
+        sink->WritePostamble(sign);
+    }
+    catch (...)
+    {
+        sink->Unlock(sign);
+        throw;
+    }
+    sink->Unlock(sign);
+}
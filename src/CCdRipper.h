@@ -1,10 +1,54 @@
 #pragma once
 
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
 #include "ISourceCdda.h"
 #include "ISink.h"
+#include "SCueSheet.h"
 
 #include "CThreadManBase.h"
 
+class CSectorRingBuffer;
+class CFileNameGenerator;
+
+/**
+ * @brief Function to create a sink for a track file. The returned sink is
+ *        owned (and deleted) by CCdRipper.
+ * @param[in] file path generated for the track
+ * @return newly allocated sink
+ */
+typedef std::function<ISink*(const std::string &path)> TrackSinkFactory;
+
+/**
+ * @brief The CCdRipper class
+ *
+ * CCdRipper is a thread managing class, of which thread reads the audio
+ * sectors off an ISourceCdda object and writes them to one or more ISink
+ * objects.
+ *
+ * By default, the CCdRipper thread reads the CD into a preallocated ring
+ * of sectors (see SetBufferSize()), and each sink is fed from the ring by
+ * its own writer thread. The sinks share the ring slots (no copy per sink),
+ * so the drive runs at full speed while multiple encoders work in parallel.
+ * Setting the buffer size to zero reverts to reading and writing in
+ * lock-step on the CCdRipper thread.
+ *
+ * In either mode, the sectors are read with ISourceCdda::ReadSectors() and
+ * passed to ISink::WriteFrame() in batches of multiple sectors (see
+ * SetBatchSize()) to reduce the per-sector call overhead.
+ *
+ * In the per-track mode (see SetTrackMode()), the CCdRipper thread also
+ * splits the sectors into tracks at the index-1 times of the cuesheet (the
+ * pregap of a track is appended to the previous track, and the hidden track
+ * before the first index 1 is not saved). Each completed track is handed to
+ * a pool of encoder threads, which create the track's sink, write the whole
+ * track, and close it, while the drive keeps on reading the next tracks. The
+ * sinks given to the constructor (if any) are still fed the entire disc
+ * (e.g., CSinkChecksum), on the CCdRipper thread.
+ */
 class CCdRipper : public CThreadManBase
 {
 public:
@@ -12,6 +56,44 @@ public:
     CCdRipper(ISourceCdda& source, const ISinkRefVector &sinks);
     virtual ~CCdRipper();
 
+    /**
+     * @brief Enable the per-track mode, in which each track is saved to its
+     *        own file.
+     * @param[in] cuesheet with track index 1 times and total time populated
+     *            along with the metadata for file naming
+     * @param[in] file name generator
+     * @param[in] function to create the sink for each track file
+     * @param[in] number of encoder threads (0 to use the number of cores)
+     * @throw runtime_error if thread is already running
+     * @throw invalid_argument if cuesheet has no track or factory is empty
+     */
+    void SetTrackMode(const SCueSheet &cuesheet, const CFileNameGenerator &namer,
+                      const TrackSinkFactory &factory, const unsigned nencoders=0);
+
+    /**
+     * @brief Disable the per-track mode
+     * @throw runtime_error if thread is already running
+     */
+    void ClearTrackMode();
+
+    /**
+     * @brief Set the size of the sector ring buffer between the reader
+     *        and the sinks
+     * @param[in] number of sectors in the ring. If 0, the sectors are read
+     *            and written synchronously on a single thread.
+     * @throw runtime_error if thread is already running
+     */
+    void SetBufferSize(const size_t nsectors);
+
+    /**
+     * @brief Set the number of sectors read from the source and written to
+     *        the sinks at once (default: 75, or 1 second of audio)
+     * @param[in] number of sectors per read/write (must be positive)
+     * @throw runtime_error if thread is already running
+     * @throw invalid_argument if nsectors is zero
+     */
+    void SetBatchSize(const size_t nsectors);
+
     /**
      * @brief Returns the status of last thread run
      * @return true if its thread was externally stopped prematurely during
@@ -28,5 +110,55 @@ protected:
 private:
     ISourceCdda &source;
     ISinkRefVector sinks;
+    size_t ringsize; // number of sectors in the ring buffer (0 to disable)
+    size_t batchsize; // number of sectors per read/write
     bool canceled;
+
+    // per-track mode
+    SCueSheet track_cuesheet; // track boundaries & metadata
+    std::unique_ptr<CFileNameGenerator> track_namer; // track file name generator
+    TrackSinkFactory track_factory; // track sink factory (empty if disabled)
+    unsigned nencoders; // number of encoder threads
+
+    /**
+     * @brief Rip on a single thread, writing each batch as it is read
+     * @param[in] sink lock signature
+     */
+    void RipDirect_(const uintptr_t sign);
+
+    /**
+     * @brief Rip with the calling thread filling the ring buffer and a
+     *        writer thread per sink draining it
+     * @param[in] sink lock signature
+     */
+    void RipBuffered_(const uintptr_t sign);
+
+    /**
+     * @brief Fills the ring buffer until end of CD or stop request.
+     * @param[in] ring buffer to be filled
+     */
+    void ReadSectors_(CSectorRingBuffer &ring);
+
+    /**
+     * @brief Writer thread function. Drains the ring buffer into a sink.
+     * @param[in] ring buffer to be drained
+     * @param[in] index of the sink, also used as the ring reader index
+     * @param[in] sink lock signature
+     */
+    void WriteSectors_(CSectorRingBuffer &ring, const size_t reader, const uintptr_t sign);
+
+    /**
+     * @brief Rip with the calling thread splitting the disc into tracks and
+     *        the encoder threads saving each track to its own sink
+     * @param[in] sink lock signature
+     */
+    void RipTracks_(const uintptr_t sign);
+
+    /**
+     * @brief Encoder thread task. Creates the track sink & writes the track.
+     * @param[in] track number (1-based)
+     * @param[in] track audio data
+     * @param[in] sink lock signature
+     */
+    void EncodeTrack_(const size_t track, const std::vector<int16_t> &data, const uintptr_t sign);
 };
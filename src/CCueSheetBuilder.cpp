@@ -1,7 +1,11 @@
 #include "CCueSheetBuilder.h"
 
 #include <stdexcept>
+#include <exception>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "CDbMusicBrainz.h"
 
@@ -39,12 +43,25 @@ CCueSheetBuilder::~CCueSheetBuilder() {}
  * @throw runtime_error if thread is already running
  */
 void CCueSheetBuilder::SetCdInfo(const CSourceCdda &cdrom, std::string upc)
+{
+    SetCdInfo(cdrom, cdrom.GetCueSheet(), upc);
+}
+
+/**
+ * @brief Set CD information prior to Start() from a cuesheet already
+ *        read off the drive (to stay off a drive which is being ripped)
+ * @param[in] cdrom object
+ * @param[in] cuesheet returned by cdrom.GetCueSheet()
+ * @param[in] UPC barcode string (optional)
+ * @throw runtime_error if thread is already running
+ */
+void CCueSheetBuilder::SetCdInfo(const CSourceCdda &cdrom, const SCueSheet &cdinfo, std::string upc)
 {
     if (Running()) throw(std::runtime_error("CCueSheetBuilder thread is already running."));
 
     cdrom_path = cdrom.GetDevicePath();
-    cdrom_len = cdrom.GetLength();
-    cuesheet = cdrom.GetCueSheet();
+    cdrom_len = cdinfo.TotalTime;
+    cuesheet = cdinfo;
     cdrom_upc = upc;
 }
 
@@ -122,6 +139,19 @@ void CCueSheetBuilder::RequireUpcMatch(const bool reqmatch)
     upc_match = reqmatch;
 }
 
+/**
+ * @brief Set the function to receive the results as they become
+ *        available
+ * @param[in] callback function (empty to remove)
+ * @throw runtime_error if thread is already running
+ */
+void CCueSheetBuilder::SetCallback(const CueSheetCallback &func)
+{
+    if (Running()) throw(std::runtime_error("CCueSheetBuilder thread is already running."));
+
+    callback = func;
+}
+
 // //////////////////////////////////////////////////////////////////////////////////////
 // OUTPUT related functions
 
@@ -196,58 +226,124 @@ void CCueSheetBuilder::ThreadMain()
 
     std::vector<DatabaseElem>::iterator it;
     CDbMusicBrainz *mbdb = NULL;
+    std::vector<DatabaseElem*> sources; // databases the cuesheet is populated from (step 5)
 
     canceled = false;
     matched = false;
 
-    // Step 1: Query based on CD info alone
-    cout << "[CCueSheetBuilder thread] step 1\n";
-    for (it=databases.begin(); it!=databases.end(); it++)
+    // Steps 1 & 2: Query the databases concurrently. The databases which can
+    // be queried with CD info alone start right away, while those linked from
+    // MusicBrainz (and not matched by CD info) start as soon as the MusicBrainz
+    // query completes.
+    cout << "[CCueSheetBuilder thread] steps 1 & 2\n";
     {
-        if (stop_request) goto cancel;
+        // if musicbrainz database is included, save the pointer to it
+        for (it=databases.begin(); !mbdb && it!=databases.end(); it++)
+        {
+            IDatabase &db = (*it).eg;
+            if (db.GetDatabaseType() == DatabaseType::MUSICBRAINZ && db.AllowQueryCD())
+                mbdb = &static_cast<CDbMusicBrainz&>(db);
+        }
+
+        std::mutex mutex_mbdb;
+        std::condition_variable cv_mbdb;
+        bool mbdb_done = !mbdb;
+        bool mbdb_failed = false; // true if the MusicBrainz query threw
+
+        size_t ndbs = databases.size();
+        std::vector<std::exception_ptr> errors(ndbs);
 
-        IDatabase &db = (*it).eg;
+        // deliver the preliminary cuesheet as soon as the databases answer
+        std::mutex mutex_preview;
+        std::vector<bool> answered(ndbs, false);
+        bool previewed = !callback;
+        auto report = [&](const size_t i)
+        {
+            std::lock_guard<std::mutex> lck(mutex_preview);
+            answered[i] = true;
+            if (!previewed && !stop_request) previewed = Preview_(answered, errors);
+        };
 
-        if (db.AllowQueryCD())  // if queryable, query
+        auto query = [&](const size_t i)
         {
-            // run query
-            db.Query(cuesheet, cdrom_upc);
-            if (matched) matched = db.NumberOfMatches();
+            IDatabase &db = databases[i].eg;
+            bool is_mbdb = mbdb && &db==static_cast<IDatabase*>(mbdb);
 
-            cout << "[CCueSheetBuilder thread] Found " << db.NumberOfMatches()
-                 << " matches in " << to_string(db.GetDatabaseType()) << "\n";
+            // Step 1: Query based on CD info alone
+            try
+            {
+                if (db.AllowQueryCD())  // if queryable, query
+                {
+                    db.Query(cuesheet, cdrom_upc);
 
-            // if musicbrainz database, save the pointer to it
-            if (db.GetDatabaseType() == DatabaseType::MUSICBRAINZ)
-                mbdb = &static_cast<CDbMusicBrainz&>(db);
+                    cout << "[CCueSheetBuilder thread] Found " << db.NumberOfMatches()
+                         << " matches in " << to_string(db.GetDatabaseType()) << "\n";
+                }
+                else // if not queryable, clear the previous match
+                {
+                    db.Clear();
+                }
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
 
-        }
-        else // if not queryable, check if it can use MusicBrainz
-        {
-            // clear the previous match
-            db.Clear();
-        }
-    }
+            // release the databases waiting on MusicBrainz
+            if (is_mbdb)
+            {
+                std::lock_guard<std::mutex> lck(mutex_mbdb);
+                mbdb_done = true;
+                mbdb_failed = (bool)errors[i];
+                cv_mbdb.notify_all();
+                return;
+            }
 
-    // ----------------------------------------------------------------------------
+            // Step 2: Query based off of MusicBrainz search if possible
+            if (errors[i] || !mbdb || db.NumberOfMatches() || !db.MayBeLinkedFromMusicBrainz())
+                return;
 
-    // Step 2: Query based off of MusicBrainz search if possible
-    cout << "[CCueSheetBuilder thread] step 2\n";
-    if (mbdb) // MusicBrainz DB is included
-    {
-        for (it=databases.begin(); it!=databases.end(); it++)
-        {
-            if (stop_request) goto cancel;
+            {
+                std::unique_lock<std::mutex> lck(mutex_mbdb);
+                while (!mbdb_done) cv_mbdb.wait(lck);
 
-            IDatabase &db = (*it).eg;
+                // no MusicBrainz release to follow the links from
+                if (mbdb_failed) return;
+            }
+            if (stop_request) return;
 
-            // if previous query not succss & queriable off MBDB, query
-            if (!db.NumberOfMatches() && db.MayBeLinkedFromMusicBrainz())
+            try
             {
                 db.Query(*mbdb, cdrom_upc);
-                if (db.NumberOfMatches()) matched = true;
             }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> queries;
+        queries.reserve(ndbs);
+        for (size_t i=0; i<ndbs; i++)
+        {
+            queries.emplace_back([&,i]()
+            {
+                query(i);
+                report(i);
+            });
         }
+
+        for (size_t i=0; i<ndbs; i++) queries[i].join();
+
+        // forward the first error (if any)
+        for (size_t i=0; i<ndbs; i++)
+            if (errors[i]) std::rethrow_exception(errors[i]);
+
+        if (stop_request) goto cancel;
+
+        // merge the outcomes
+        for (it=databases.begin(); !matched && it!=databases.end(); it++)
+            matched = (*it).eg.NumberOfMatches()>0;
     }
 
     // ----------------------------------------------------------------------------
@@ -283,6 +379,8 @@ void CCueSheetBuilder::ThreadMain()
     // for the matching UPC if UPC found
     if (upc.size())
     {
+        std::vector<DatabaseElem*> searches; // DBs to be searched by UPC
+
         for (; it!=databases.end(); it++)
         {
             if (stop_request) goto cancel;
@@ -297,10 +395,33 @@ void CCueSheetBuilder::ThreadMain()
                 if (upc.compare(this_upc)==0) recid = rid;
             }
 
-            // If none exists and DB spports UPC search, search now
-            if (recid<0 && db.AllowSearchByUPC() && db.Search(upc))
-                recid = 0; // pick the first match
+            // If none exists and DB spports UPC search, search later
+            if (recid<0 && db.AllowSearchByUPC()) searches.push_back(&(*it));
         }
+
+        // Search the databases concurrently
+        std::vector<std::exception_ptr> errors(searches.size());
+        std::vector<std::thread> threads;
+        threads.reserve(searches.size());
+        for (size_t i=0; i<searches.size(); i++)
+        {
+            threads.emplace_back([&,i]()
+            {
+                try
+                {
+                    if (searches[i]->eg.Search(upc))
+                        searches[i]->recid = 0; // pick the first match
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+
+        for (size_t i=0; i<threads.size(); i++) threads[i].join();
+        for (size_t i=0; i<errors.size(); i++)
+            if (errors[i]) std::rethrow_exception(errors[i]);
     }
 
     // ----------------------------------------------------------------------------
@@ -330,7 +451,8 @@ void CCueSheetBuilder::ThreadMain()
                 // if contains UPC-matched result, retrieve the match
                 if (recid>=0)
                 {
-                    ProcessDatabase_((*it).eg, recid);
+                    ProcessDatabase_((*it).eg, recid, cuesheet);
+                    sources.push_back(&(*it));
                     matched = true;
                 }
             }
@@ -353,7 +475,8 @@ void CCueSheetBuilder::ThreadMain()
                 // if contains a UPC-unmatched result, marge the data to the cuesheet
                 if (db.NumberOfMatches() && (any_recid || recid>=0))
                 {
-                    ProcessDatabase_(db,(recid<0)?0:recid);
+                    ProcessDatabase_(db,(recid<0)?0:recid, cuesheet);
+                    sources.push_back(&(*it));
                     matched = true;
                 }
             }
@@ -367,6 +490,21 @@ void CCueSheetBuilder::ThreadMain()
                                        [](const std::string& s) { return s.empty(); }),
                         cuesheet.Rems.end());
 
+    if (matched && callback) callback(CueSheetUpdate::CUESHEET, cuesheet, UByteVector());
+
+    // Step 7: Grab the cover images
+    cout << "[CCueSheetBuilder thread] step 7 - Grabbing cover images\n";
+    for (size_t i=0; i<sources.size() && (front.empty() || back.empty()); i++)
+    {
+        if (stop_request) goto cancel;
+
+        bool nofront = front.empty(), noback = back.empty();
+        ProcessImages_(sources[i]->eg);
+
+        if (callback && nofront && front.size()) callback(CueSheetUpdate::FRONT_COVER, cuesheet, front);
+        if (callback && noback && back.size()) callback(CueSheetUpdate::BACK_COVER, cuesheet, back);
+    }
+
     // all completed
     return;
 
@@ -376,14 +514,57 @@ cancel:
     return;
 }
 
+/**
+ * @brief Build and deliver the preliminary cuesheet from the first
+ *        database in the priority order with an acceptable match, once
+ *        all the databases before it have answered
+ * @param[in] flags of the databases which have answered
+ * @param[in] errors of the databases which have answered
+ * @return true if delivered
+ */
+bool CCueSheetBuilder::Preview_(const std::vector<bool> &answered, const std::vector<std::exception_ptr> &errors) const
+{
+    for (size_t i=0; i<databases.size(); i++)
+    {
+        // a database of higher priority may yet answer
+        if (!answered[i]) return false;
+
+        IDatabase &db = databases[i].eg;
+        if (errors[i] || !db.IsReleaseDb()) continue;
+
+        // pick the first match (with the UPC if required)
+        int recid = -1;
+        for (int rid=0; recid<0 && rid<db.NumberOfMatches(); rid++)
+        {
+            if (!upc_match || cdrom_upc.empty() || cdrom_upc.compare(db.AlbumUPC(rid))==0)
+                recid = rid;
+        }
+
+        if (recid>=0)
+        {
+            SCueSheet cs(cuesheet);
+            for (size_t j=0; j<remfields.size(); j++) cs.Rems.emplace_back("");
+            ProcessDatabase_(db, recid, cs);
+            cs.Rems.erase(std::remove_if(cs.Rems.begin(),
+                                         cs.Rems.end(),
+                                         [](const std::string& s) { return s.empty(); }),
+                          cs.Rems.end());
+
+            callback(CueSheetUpdate::PRELIMINARY, cs, UByteVector());
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief Internal function to be called by ThreadMain to build the
  *        cuesheet from database.
  * @param[in] source database with at least one match
  * @param[in] record index of the matched
- * @return true if database contains a match and db_marge_method==0
+ * @param[inout] cuesheet to fill
  */
-void CCueSheetBuilder::ProcessDatabase_(IDatabase &db, const int recid)
+void CCueSheetBuilder::ProcessDatabase_(IDatabase &db, const int recid, SCueSheet &cuesheet) const
 {
     if (db.IsReleaseDb()) // marge the data to the cuesheet
     {
@@ -467,6 +648,15 @@ void CCueSheetBuilder::ProcessDatabase_(IDatabase &db, const int recid)
         }
     }
 
+}
+
+/**
+ * @brief Internal function to be called by ThreadMain to grab the cover
+ *        images from database (if not already found)
+ * @param[in] source database
+ */
+void CCueSheetBuilder::ProcessImages_(IDatabase &db)
+{
     if (db.IsImageDb()) // grab the cover image if available
     {
         IImageDatabase &idb = dynamic_cast<IImageDatabase&>(db);
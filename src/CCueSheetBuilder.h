@@ -1,5 +1,8 @@
 #pragma once
 
+#include <functional>
+#include <exception>
+
 #include "CThreadManBase.h"
 #include "IDatabase.h"
 #include "IReleaseDatabase.h"
@@ -11,6 +14,27 @@
 
 struct DatabaseElem;
 
+/**
+ * @brief Kinds of the progressive results of CCueSheetBuilder
+ */
+enum class CueSheetUpdate
+{
+    PRELIMINARY,    /// first acceptable cuesheet, from the first database (in priority order) with a match
+    CUESHEET,       /// cuesheet combined from all the databases
+    FRONT_COVER,    /// front cover image
+    BACK_COVER,     /// back cover image
+};
+
+/**
+ * @brief Function to receive the progressive results of CCueSheetBuilder.
+ *        Called on the builder's threads, so it must return promptly and
+ *        must not throw.
+ * @param[in] kind of the update
+ * @param[in] cuesheet populated so far
+ * @param[in] cover image data (FRONT_COVER and BACK_COVER only, else empty)
+ */
+typedef std::function<void(const CueSheetUpdate update, const SCueSheet &cuesheet, const UByteVector &cover)> CueSheetCallback;
+
 /**
  * @brief The CCueSheetBuilder class
  *
@@ -43,11 +67,20 @@ struct DatabaseElem;
  *
  * RequireUpcMatch() - If UPC is given, only accept results with the matching UPC
  * AllowCombining()  - Combine results from multiple databases
+ * SetCallback()     - Receive the results as they become available
  *
  * Once CD info and databases are set, call Start() to begin gathering
  * the information. WaitTillDone() maybe called by the calling thread
  * (or any other threads for that matter).
  *
+ * Without waiting for the thread, the callback receives the results
+ * progressively: a PRELIMINARY cuesheet as soon as the first database (in
+ * the priority order) with an acceptable match has answered, the CUESHEET
+ * combined from all the databases, then the cover images as they are
+ * downloaded. So the CD may be ripped while the databases are looked up,
+ * and the latest cuesheet applied to the output (e.g., ISink::SetCueSheet())
+ * before it is finalized.
+ *
  * If multiple matches are found in a database, only the first match
  * will be considered. The matches across databases are combined in the
  * priority order. Each cuesheet field is filled with the retrieved
@@ -87,6 +120,16 @@ public:
      */
     void SetCdInfo(const CSourceCdda &cdrom, std::string upc="");
 
+    /**
+     * @brief Set CD information prior to Start() from a cuesheet already
+     *        read off the drive (to stay off a drive which is being ripped)
+     * @param[in] cdrom object
+     * @param[in] cuesheet returned by cdrom.GetCueSheet()
+     * @param[in] UPC barcode string (optional)
+     * @throw runtime_error if thread is already running
+     */
+    void SetCdInfo(const CSourceCdda &cdrom, const SCueSheet &cdinfo, std::string upc="");
+
     /**
      * @brief Add an Album REM field
      * @param[in] REM field to be included
@@ -139,6 +182,14 @@ public:
      */
     void RequireUpcMatch(const bool reqmatch);
 
+    /**
+     * @brief Set the function to receive the results as they become
+     *        available
+     * @param[in] callback function (empty to remove)
+     * @throw runtime_error if thread is already running
+     */
+    void SetCallback(const CueSheetCallback &func);
+
     //-----------------------------------------------------
     // POST-THREAD functions
 
@@ -209,11 +260,31 @@ private:
     UByteVector front;
     UByteVector back;
 
+    CueSheetCallback callback; // receives the progressive results (optional)
+
     /**
      * @brief Internal function to be called by ThreadMain to build the
      *        cuesheet from database.
      * @param[in] source database
      * @param[in] record index of the matched
+     * @param[inout] cuesheet to fill
+     */
+    void ProcessDatabase_(IDatabase &db, const int recid, SCueSheet &cs) const;
+
+    /**
+     * @brief Internal function to be called by ThreadMain to grab the cover
+     *        images from database (if not already found)
+     * @param[in] source database
+     */
+    void ProcessImages_(IDatabase &db);
+
+    /**
+     * @brief Build and deliver the preliminary cuesheet from the first
+     *        database in the priority order with an acceptable match, once
+     *        all the databases before it have answered
+     * @param[in] flags of the databases which have answered
+     * @param[in] errors of the databases which have answered
+     * @return true if delivered
      */
-    void ProcessDatabase_(IDatabase &db, const int recid);
+    bool Preview_(const std::vector<bool> &answered, const std::vector<std::exception_ptr> &errors) const;
 };
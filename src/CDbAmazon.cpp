@@ -15,6 +15,8 @@ const std::string CDbAmazon::base_url = "http://lon.gr/ata/";
 CDbAmazon::CDbAmazon(const std::string &cname,const std::string &cversion, const std::string &asin)
     : CUtilUrl(cname,cversion), CoverArtSize(2)
 {
+    SetPriority_(HttpPriority::BACKGROUND); // cover art lookups go behind the disc lookups
+
     // if ASIN is given, immediately perform a single item query
     if (asin.size()) Query(asin);
 }
@@ -27,6 +29,8 @@ CDbAmazon::CDbAmazon(const std::string &cname,const std::string &cversion, const
 CDbAmazon::CDbAmazon(const CUtilUrl &base, const std::string &asin)
     : CUtilUrl(base), CoverArtSize(2)
 {
+    SetPriority_(HttpPriority::BACKGROUND); // cover art lookups go behind the disc lookups
+
     // if ASIN is given, immediately perform a single item query
     if (asin.size()) Query(asin);
 }
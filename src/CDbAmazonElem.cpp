@@ -9,7 +9,7 @@
 #include "utils.h"
 
 CDbAmazonElem::CDbAmazonElem(const std::string &newasin, const std::string &data)
-    : CUtilXmlTree(data), asin(newasin)
+    : CUtilXmlTree(data, true), asin(newasin)
 {
     // change the root to release element
     if (root)
@@ -28,6 +28,7 @@ void CDbAmazonElem::LoadData(const std::string &newasin, const std::string &rawd
 {
     // call the base class function first
     CUtilXmlTree::LoadData(rawdata);
+    BuildIndex();
 
     // change the root to release element
     if (root && !FindElement("Document",root) && root)
@@ -25,6 +25,9 @@ using std::string;
 using std::runtime_error;
 using std::to_string;
 
+/* number of master version pages fetched concurrently */
+#define VERSION_PAGE_WINDOW 4
+
 const std::string CDbDiscogs::base_url("https://api.discogs.com/");
 
 // ---------------------------------------------------------------
@@ -37,6 +40,10 @@ const std::string CDbDiscogs::base_url("https://api.discogs.com/");
 CDbDiscogs::CDbDiscogs(const std::string &cname,const std::string &cversion)
     : CUtilUrl(cname,cversion)
 {
+    // authenticated requests are limited to 60 per minute (the server
+    // reports the remaining quota, which CUtilUrl applies as well)
+    SetRateLimit_(HostName_(base_url), 1.0);
+
     Authorize_();
 }
 
@@ -108,8 +115,9 @@ int CDbDiscogs::Query(CDbMusicBrainz &mbdb, const std::string upc)
                 // query the master release
                 if (((upc.size() && upc.compare(release.AlbumUPC())!=0)
                      || (upc.empty() && preferred_country.size() && preferred_country.compare(release.Country())!=0))
-                    && release.FindInt("master_id",id))
+                    && release.master_id)
                 {
+                    id = release.master_id;
                     ismaster = true;
                     cout << "[Discogs::Query] Linked to a master release: " << id << "\n";
                 }
@@ -127,7 +135,7 @@ int CDbDiscogs::Query(CDbMusicBrainz &mbdb, const std::string upc)
                 // get best matching release from the associated releases
                 CDbDiscogsElem release = QueryMaster_(id, upc, lastmaster);
 
-                if (release.data) // if release is not empty
+                if (release.ReleaseId().size()) // if release is not empty
                 {
                     // keep the record
                     Releases.emplace_back("");
@@ -215,13 +223,21 @@ CDbDiscogsElem CDbDiscogs::QueryMaster_(const int id, const std::string upc, int
                 // go through the first page
                 bool notfound = SelectFromMasterVersions_(release, versions, upc);
 
-                // go over additional pages if available
-                for (json_int_t p = 2; notfound && p<=pages; p++)
+                // go over additional pages if available: fetch the next few
+                // pages concurrently (within the host's rate limit) and go
+                // through them in order, stop fetching once selected
+                for (json_int_t p = 2; notfound && p<=pages; p += VERSION_PAGE_WINDOW)
                 {
-                    PerformHttpTransfer_(url+"?page="+std::to_string(p)); // received data is stored in rawdata
-                    CUtilJson versions(rawdata);
-
-                    notfound = SelectFromMasterVersions_(release, versions, upc);
+                    std::vector<std::string> urls, data;
+                    for (json_int_t q = p; q<=pages && q<p+VERSION_PAGE_WINDOW; q++)
+                        urls.push_back(url+"?page="+std::to_string(q));
+                    PerformHttpTransfers_(urls, data);
+
+                    for (size_t i = 0; notfound && i<data.size(); i++)
+                    {
+                        CUtilJson versions(data[i]);
+                        notfound = SelectFromMasterVersions_(release, versions, upc);
+                    }
                 }
             }
         }
@@ -299,7 +315,7 @@ bool CDbDiscogs::SelectFromMasterVersions_(CDbDiscogsElem &elem, const CUtilJson
             /* UPC given & matched or Country given & matched or neither given*/
 
             // Overwrite the last Releases element with it
-            if (upc_match || (upc.empty() && !elem.data))
+            if (upc_match || (upc.empty() && elem.ReleaseId().empty()))
             {
                 cout << "[Discogs::MasterVersionQuery] Release data swapped." << endl;
                 elem.Swap(release);
@@ -14,19 +14,22 @@
 #include "utils.h"
 
 CDbDiscogsElem::CDbDiscogsElem(const std::string &rawdata, const int d, const int offset)
-    : CUtilJson(rawdata), disc(d), track_offset(offset)
+    : disc(d), track_offset(offset), master_id(0)
 {
-    SetDiscSize_();
-    AnalyzeArtists_();
+    CUtilJson json(rawdata);
+    if (json.data) Extract_(json.data);
+
+    number_of_tracks = release.tracks.size();
 }
 
 CDbDiscogsElem::CDbDiscogsElem(const std::string &rawdata, const int d, const std::vector<int> &tracklengths)
-    : CUtilJson(rawdata), disc(d)
+    : disc(d), master_id(0)
 {
+    CUtilJson json(rawdata);
+    if (json.data) Extract_(json.data);
+
     if (!SetDiscOffset_(tracklengths))
         throw(std::runtime_error("Release without valid track information."));
-
-    AnalyzeArtists_();
 }
 
 /**
@@ -35,22 +38,110 @@ CDbDiscogsElem::CDbDiscogsElem(const std::string &rawdata, const int d, const st
  */
 void CDbDiscogsElem::Swap(CDbDiscogsElem &other)
 {
-    CUtilJson::Swap(other);
     std::swap(disc,other.disc);
+    std::swap(track_offset,other.track_offset);
+    std::swap(number_of_tracks,other.number_of_tracks);
+    std::swap(master_id,other.master_id);
+    release.Swap(other.release);
 }
 
 /**
- * @brief Fill number_of_tracks
+ * @brief Extract the release data from the JSON object
+ * @param[in] release JSON object
  */
-void CDbDiscogsElem::SetDiscSize_()
+void CDbDiscogsElem::Extract_(const json_t *data)
 {
-    // gather track info
-    number_of_tracks = 0;
-    TraverseTracks_([&] (const json_t *t, const json_t *p, size_t pidx, const json_t *h, size_t hidx)
+    json_t *array;
+    json_int_t val;
+    std::string str;
+
+    if (CUtilJson::FindInt(data,"id",val)) release.id = release.Intern(std::to_string(val));
+    if (!CUtilJson::FindInt(data,"master_id",master_id)) master_id = 0;
+
+    release.title = release.Intern(Title_(data));
+
+    // genre: the first of the genres
+    if (CUtilJson::FindArray(data,"genres",array) && json_string_value(json_array_get(array,0)))
+        release.genre = release.Intern(json_string_value(json_array_get(array,0)));
+
+    // release date, or year if not given
+    if (CUtilJson::FindString(data,"released",str)) release.date = release.Intern(str);
+    else if (CUtilJson::FindInt(data,"year",val)) release.date = release.Intern(std::to_string(val));
+
+    if (CUtilJson::FindString(data,"country",str)) release.country = release.Intern(str);
+
+    // number of discs from the first format entry
+    try
+    {
+        if (CUtilJson::FindArray(data,"formats",array)
+                && CUtilJson::FindString(json_array_get(array,0),"qty",str))
+            release.total_discs = std::stoi(str);
+    }
+    catch (...) {} // if exception thrown, ignore and keep 1
+
+    // label & catalog number of the first label entry
+    if (CUtilJson::FindArray(data,"labels",array))
+    {
+        json_t *label = json_array_get(array,0);
+        if (CUtilJson::FindString(label,"name",str)) release.label = release.Intern(str);
+        if (CUtilJson::FindString(label,"catno",str)) release.catno = release.Intern(str);
+    }
+
+    // identifiers (<type, value> links)
+    if (CUtilJson::FindArray(data,"identifiers",array))
+    {
+        json_t *id;
+        std::string type;
+        for(size_t index = 0; index < json_array_size(array) && (id = json_array_get(array, index)); index++)
+        {
+            if (CUtilJson::FindString(id,"type",type) && CUtilJson::FindString(id,"value",str) && str.size())
+            {
+                SDbRelease::SLink link = { release.Intern(type), release.Intern(str) };
+                release.links.push_back(link);
+            }
+        }
+    }
+
+    str = Identifier("Barcode");
+    if (str.size()) cleanup_upc(str);
+    release.barcode = release.Intern(str);
+
+    Performer_(data, release.performers);
+    Composer_(data, release.composers);
+
+    // flatten the tracklist
+    TraverseTracks_(data, [&] (const json_t *t, const json_t *p, size_t pidx, const json_t *h, size_t hidx)
     {
-        number_of_tracks++;
+        release.tracks.emplace_back();
+        SDbRelease::STrack &track = release.tracks.back();
+        track.number = release.tracks.size();
+
+        if (CUtilJson::FindString(t,"position",str)) track.position = release.Intern(str);
+        track.title = release.Intern(TrackTitle_(t, p, pidx));
+
+        // duration in [[hh:]mm:]ss
+        std::string duration;
+        if (CUtilJson::FindString(t,"duration",duration))
+        {
+            char *endstr;
+            const char *str0 = duration.c_str();
+            int T = strtol(str0, &endstr, 10);
+            while (endstr!=str0 && endstr && *endstr==':')
+            {
+                str0 = ++endstr;
+                T *= 60;
+                T += strtol(str0, &endstr, 10);
+            }
+            if (!*endstr) track.length = T*1000; // unknown if extrenous characters at the end
+        }
+
+        Performer_(t, track.performers);
+        Composer_(t, track.composers);
+
         return true;
     } );
+
+    release.Compact();
 }
 
 /**
@@ -64,30 +155,9 @@ bool CDbDiscogsElem::SetDiscOffset_(const std::vector<int> &cdtracks)
 {
     // gather track info
     std::vector<int> alltracks;
-    alltracks.reserve(128);
-    TraverseTracks_([&] (const json_t *t, const json_t *p, size_t pidx, const json_t *h, size_t hidx)
-    {
-        // lambda function to be executed by TraverseTracks_
-        std::string duration;
-
-        if (FindString(t,"duration",duration))
-        {
-            char *str;
-            const char *str0 = duration.c_str();
-            int T = strtol(str0, &str, 10);
-            while (str!=str0 && str && *str==':')
-            {
-                str0 = ++str;
-                T *= 60;
-                T += strtol(str0, &str, 10);
-            }
-            if (*str) return false; // extrenous characters at the end
-
-            // add the duration to the vector
-            alltracks.push_back(T);
-        }
-        return true;
-    } );
+    alltracks.reserve(release.tracks.size());
+    for (std::vector<SDbRelease::STrack>::const_iterator it = release.tracks.begin(); it!=release.tracks.end(); it++)
+        if ((*it).length>=0) alltracks.push_back((*it).length/1000);
 
     // compare discogs track info to CD's
     number_of_tracks = cdtracks.size();
@@ -131,10 +201,7 @@ bool CDbDiscogsElem::SetDiscOffset_(const std::vector<int> &cdtracks)
             // Any preceding non-digits are skipped and first number is taken as the disc #.
             // If no number of found or the first # is less than 2, disc# is probably not
             // displayed in the field. If so, disc variable remain unchanged.
-            std::string position;
-            const json_t* track = FindTrack_(1);
-            CUtilJson::FindString(track,"position",position);
-            const char* str = position.c_str();
+            const char* str = release.String(FindTrack_(1).position);
             while (*str && !isdigit(*str)) str++;
             if (*str)
             {
@@ -149,6 +216,7 @@ bool CDbDiscogsElem::SetDiscOffset_(const std::vector<int> &cdtracks)
 
 /**
  * @brief Traverses tracklist array and calls Callback() for every track-type element
+ * @param[in] release JSON object
  * @param[in] Callback function
  *
  * Callback (lambda) function:
@@ -163,17 +231,17 @@ bool CDbDiscogsElem::SetDiscOffset_(const std::vector<int> &cdtracks)
  *   const int &hidx: track index (only counting the main tracks) w.r.t. heading.
  *                    Unknonwn if heading is NULL,
  */
-void CDbDiscogsElem::TraverseTracks_(
+void CDbDiscogsElem::TraverseTracks_(const json_t *data,
             std::function<bool (const json_t *track,
                                 const json_t *parent, size_t pidx,
-                                const json_t *heading, size_t hidx)> Callback) const
+                                const json_t *heading, size_t hidx)> Callback)
 {
     // start the traversal of tracklist
     json_t *tracks, *track, *heading=NULL;
     bool gotonext = true;
 
     // get the tracklist array
-    if (!FindArray("tracklist", tracks)) return;
+    if (!CUtilJson::FindArray(data, "tracklist", tracks)) return;
 
     // for each track of the tracklist
     for(size_t index = 0;
@@ -184,14 +252,14 @@ void CDbDiscogsElem::TraverseTracks_(
         std::string type;
         size_t subindex, headindex;
 
-        if (FindString(track,"type_",type))
+        if (CUtilJson::FindString(track,"type_",type))
         {
             if (type.compare("track")==0) // found a track
             {
                 // call the callback function
                 gotonext = Callback(track,NULL,subindex,heading,index-headindex);
             }
-            else if (type.compare("index")==0 && FindArray(track,"sub_tracks",subtracks)) // contain sub_tracks
+            else if (type.compare("index")==0 && CUtilJson::FindArray(track,"sub_tracks",subtracks)) // contain sub_tracks
             {
                 // call the callback function on each subtrack
                 for(subindex = 0;
@@ -209,44 +277,21 @@ void CDbDiscogsElem::TraverseTracks_(
 }
 
 /**
- * @brief Find JSON object for the specified track
- * @param[inout] track number between 1 and 99 -> 0
- * @return pointer to a track JSON object
+ * @brief Find the specified track
+ * @param[in] track number on the CD
+ * @return reference to the track
+ * @throw runtime_error if track number is invalid
  */
-const json_t* CDbDiscogsElem::FindTrack_(const size_t tracknum, const json_t **index, size_t *suboffset, const json_t **heading, size_t *headoffset) const
+const SDbRelease::STrack &CDbDiscogsElem::FindTrack_(const size_t tracknum) const
 {
     if (!tracknum)
         throw(std::runtime_error("Invalid tracknum, must be positive."));
 
-    const json_t *track;  // return value
-    size_t num = tracknum;
-    size_t offset = track_offset;
-
-    // if calling function requesting the pointer to index track, initialize to NULL
-    if (index) *index = NULL;
-
-    // traverse the tracklist looking for the requested track
-    TraverseTracks_([&] (const json_t *t, const json_t *p, size_t pidx, const json_t *h, size_t hidx)
-    {
-        if (offset) offset--;
-        else num--;
-
-        if (!num) // found the track
-        {
-            track = t;
-            if (index) *index = p;
-            if (suboffset) *suboffset = pidx;
-            if (heading) *heading = h;
-            if (headoffset) *headoffset = hidx;
-        }
-
-        return num;
-    } );
-
-    if (num || !track)
+    size_t index = track_offset+tracknum-1;
+    if (index>=release.tracks.size())
         throw(std::runtime_error("Track not found."));
 
-    return track;
+    return release.tracks[index];
 }
 
 /**
@@ -259,7 +304,7 @@ size_t CDbDiscogsElem::NumberOfSubTracks_(const json_t *track)
     json_t *subtracks;
     size_t rval = 0;
 
-    if (FindArray(track,"sub_tracks",subtracks))
+    if (CUtilJson::FindArray(track,"sub_tracks",subtracks))
         rval = json_array_size(subtracks);
 
     return rval;
@@ -273,13 +318,7 @@ size_t CDbDiscogsElem::NumberOfSubTracks_(const json_t *track)
  */
 std::string CDbDiscogsElem::ReleaseId() const
 {
-    std::string rval;
-    json_int_t rvalint;
-
-    if (FindInt(data,"id",rvalint))
-        rval = std::to_string(rvalint);
-
-    return rval;
+    return release.String(release.id);
 }
 
 /** Get album title
@@ -288,7 +327,7 @@ std::string CDbDiscogsElem::ReleaseId() const
  */
 std::string CDbDiscogsElem::AlbumTitle() const
 {
-    return Title_(data);
+    return release.String(release.title);
 }
 
 /** Get album artist
@@ -297,7 +336,7 @@ std::string CDbDiscogsElem::AlbumTitle() const
  */
 SCueArtists CDbDiscogsElem::AlbumArtist() const
 {
-    return Performer_(data);
+    return release.Artists(release.performers);
 }
 
 /** Get album composer
@@ -306,7 +345,7 @@ SCueArtists CDbDiscogsElem::AlbumArtist() const
  */
 SCueArtists CDbDiscogsElem::AlbumComposer() const
 {
-    return Composer_(data);
+    return release.Artists(release.composers);
 }
 
 /** Get genre
@@ -315,10 +354,7 @@ SCueArtists CDbDiscogsElem::AlbumComposer() const
  */
 std::string CDbDiscogsElem::Genre() const
 {
-    json_t *genres;
-    if (!FindArray(data,"genres",genres)) return "";
-    return json_string_value(json_array_get(genres,0));
-
+    return release.String(release.genre);
 }
 
 /** Get release date
@@ -327,14 +363,7 @@ std::string CDbDiscogsElem::Genre() const
  */
 std::string CDbDiscogsElem::Date() const
 {
-    json_int_t yr;
-    std::string str;
-
-    if (!FindString(data,"released",str)
-            && FindInt(data,"year",yr))
-        str = std::to_string(yr);
-
-    return str;
+    return release.String(release.date);
 }
 
 /** Get release country
@@ -343,9 +372,7 @@ std::string CDbDiscogsElem::Date() const
  */
 std::string CDbDiscogsElem::Country() const
 {
-    std::string str;
-    FindString(data,"country",str);
-    return str;
+    return release.String(release.country);
 }
 
 /**
@@ -363,19 +390,7 @@ int CDbDiscogsElem::DiscNumber() const
  */
 int CDbDiscogsElem::TotalDiscs() const
 {
-    int rval = 1;
-    json_t *formats;
-
-    try
-    {
-        std::string qty;
-        if (FindArray("formats",formats)
-                && FindString(json_array_get(formats,0),"qty",qty))
-            rval = std::stoi(qty);
-    }
-    catch (...) {} // if exception thrown, ignore and return 1
-
-    return rval;
+    return release.total_discs;
 }
 
 /** Get label name
@@ -384,16 +399,7 @@ int CDbDiscogsElem::TotalDiscs() const
  */
 std::string CDbDiscogsElem::AlbumLabel() const
 {
-    json_t *labels;
-    std::string labelstr;
-
-    if (FindArray("labels",labels))
-    {
-        labels = json_array_get(labels,0); // get the first label entry
-        FindString(labels,"name",labelstr);
-    }
-
-    return labelstr;
+    return release.String(release.label);
 }
 
 /** Get catalog number
@@ -402,16 +408,7 @@ std::string CDbDiscogsElem::AlbumLabel() const
  */
 std::string CDbDiscogsElem::AlbumCatNo() const
 {
-    json_t *labels;
-    std::string catno;
-
-    if (FindArray("labels",labels))
-    {
-        labels = json_array_get(labels,0); // get the first label entry
-        FindString(labels,"catno",catno);
-    }
-
-    return catno;
+    return release.String(release.catno);
 }
 
 /** Get album UPC
@@ -420,9 +417,7 @@ std::string CDbDiscogsElem::AlbumCatNo() const
  */
 std::string CDbDiscogsElem::AlbumUPC() const
 {
-    std::string upc = Identifier("Barcode");
-    if (upc.size()) cleanup_upc(upc);
-    return upc;
+    return release.String(release.barcode);
 }
 
 /** Get number of tracks
@@ -455,49 +450,7 @@ int CDbDiscogsElem::NumberOfTracks() const
  */
 std::string CDbDiscogsElem::TrackTitle(int tracknum) const
 {
-    std::string rval;
-    std::string movt_num;
-
-    // initialize tracks
-    const json_t *parent;
-    size_t pidx;
-    bool showtitle=true;
-    const json_t *track = FindTrack_(tracknum, &parent, &pidx);
-
-    // For a work with multiple movements, Discogs uses sub_tracks for its
-    // movement tracks (not always followed though...)
-    if (parent!=NULL)
-    {
-        rval = Title_(parent);
-        rval += ": ";
-
-        // only show the movement titles if there are more than 1 movement
-        showtitle = NumberOfSubTracks_(parent)>1;
-        if (showtitle) movt_num = itoroman(++pidx);
-    }
-
-    if (showtitle)
-    {
-        // add the main title of the (sub)track
-        std::string track_title = Title_(track);
-
-        // add movement # only if it's not already included in the track title
-        if (movt_num.size())
-        {
-            bool excluded = track_title.compare(0,movt_num.size(),movt_num)!=0;
-            if (excluded)
-            {
-                std::string movt_arabic = std::to_string(pidx);
-                if (track_title.compare(0,movt_arabic.size(),movt_arabic)!=0)
-                    rval += movt_num + ". ";
-            }
-        }
-
-        // append the track title
-        rval += track_title;
-    }
-
-    return rval;
+    return release.String(FindTrack_(tracknum).title);
 }
 
 /** Get track artist
@@ -508,13 +461,7 @@ std::string CDbDiscogsElem::TrackTitle(int tracknum) const
  */
 SCueArtists CDbDiscogsElem::TrackArtist(int tracknum) const
 {
-    std::string rval;
-
-    // initialize tracks
-    const json_t *parent;
-    const json_t *track = FindTrack_(tracknum, &parent);
-
-    return Performer_(track);
+    return release.Artists(FindTrack_(tracknum).performers);
 }
 
 /** Get track composer
@@ -525,11 +472,7 @@ SCueArtists CDbDiscogsElem::TrackArtist(int tracknum) const
  */
 SCueArtists CDbDiscogsElem::TrackComposer(int tracknum) const
 {
-    // initialize tracks
-    const json_t *parent;
-    const json_t *track = FindTrack_(tracknum, &parent);
-
-    return Composer_(track);
+    return release.Artists(FindTrack_(tracknum).composers);
 }
 
 /** Get track ISRC
@@ -544,134 +487,155 @@ std::string CDbDiscogsElem::TrackISRC(int tracknum) const
 }
 
 std::string CDbDiscogsElem::Identifier(const std::string type) const
+{
+    return release.Link(type);
+}
+
+std::string CDbDiscogsElem::Title_(const json_t* data) // maybe release or track json_t
+{
+    std::string titlestr;
+    CUtilJson::FindString(data, "title", titlestr);
+    return titlestr;
+}
+
+/**
+ * @brief Compose the title of a track
+ * @param[in] pointer to the track JSON object
+ * @param[in] pointer to the parent index track JSON object or NULL
+ * @param[in] sub_track index if parent is not NULL
+ * @return the title of the track
+ */
+std::string CDbDiscogsElem::TrackTitle_(const json_t* track, const json_t* parent, size_t pidx)
 {
     std::string rval;
-    json_t *idarray;
-    if (FindArray("identifiers",idarray))
+    std::string movt_num;
+    bool showtitle=true;
+
+    // For a work with multiple movements, Discogs uses sub_tracks for its
+    // movement tracks (not always followed though...)
+    if (parent!=NULL)
     {
+        rval = Title_(parent);
+        rval += ": ";
 
-        // Look for the entry with requested type
-        json_t *id;
-        for(size_t index = 0;
-            rval.empty() && index < json_array_size(idarray) && (id = json_array_get(idarray, index));
-            index++)
+        // only show the movement titles if there are more than 1 movement
+        showtitle = NumberOfSubTracks_(parent)>1;
+        if (showtitle) movt_num = itoroman(++pidx);
+    }
+
+    if (showtitle)
+    {
+        // add the main title of the (sub)track
+        std::string track_title = Title_(track);
+
+        // add movement # only if it's not already included in the track title
+        if (movt_num.size())
         {
-            // if Identifier type does not match, go to next
-            if (CompareString(id, "type", type)==0)
-                FindString(id,"value",rval);
+            bool excluded = track_title.compare(0,movt_num.size(),movt_num)!=0;
+            if (excluded)
+            {
+                std::string movt_arabic = std::to_string(pidx);
+                if (track_title.compare(0,movt_arabic.size(),movt_arabic)!=0)
+                    rval += movt_num + ". ";
+            }
         }
+
+        // append the track title
+        rval += track_title;
     }
 
     return rval;
 }
 
-std::string CDbDiscogsElem::Title_(const json_t* data) // maybe release or track json_t
+/**
+ * @brief Add a credit for an artist JSON object
+ * @param[in] artist JSON object (an element of artists or extraartists arrays)
+ * @param[inout] join string, updated with the artist's if given
+ * @param[inout] credit range to append to
+ * @return false if the artist has no name
+ */
+bool CDbDiscogsElem::AddCredit_(const json_t* artist, std::string &joinstr, SDbRelease::SRange &range)
 {
-    std::string titlestr;
-    FindString(data, "title", titlestr);
-    return titlestr;
+    std::string str;
+    if (!((CUtilJson::FindString(artist,"anv",str) && str.size()) // get album specific alternate name first
+          || (CUtilJson::FindString(artist,"name",str) && str.size()))) // if not given, use the Discogs' name
+        return false;
+
+    // look for the next join string
+    CUtilJson::FindString(artist, "join", joinstr);
+
+    release.AddCredit(range, release.Artist(std::to_string(ArtistId_(artist))), str, joinstr);
+    return true;
 }
 
-SCueArtists CDbDiscogsElem::Performer_(const json_t* data) // maybe release or track json_t
+/**
+ * @brief Add the performer credits (excluding composers) of album or track
+ * @param[in] pointer to album or track JSON object
+ * @param[out] credit range to fill
+ */
+void CDbDiscogsElem::Performer_(const json_t* data, SDbRelease::SRange &range) // maybe release or track json_t
 {
-    SCueArtists rval;
-    std::string joinstr, str;
+    std::string joinstr;
     json_t *artists;
 
     // Get credits to check for composer
     json_t *credits;
-    if (!FindArray(data, "extraartists",credits)) credits = NULL;
+    if (!CUtilJson::FindArray(data, "extraartists",credits)) credits = NULL;
 
     // Look for artist entries
-    if (FindArray(data, "artists", artists))
+    if (CUtilJson::FindArray(data, "artists", artists))
     {
         json_t *artist;
         size_t num_artists = json_array_size(artists);
         for (size_t i = 0; i<num_artists && (artist = json_array_get(artists,i)); i++)
         {
             // if non-composer and given a valid name
-            if (!IsComposer_(artist, credits)
-                    && ((FindString(artist,"anv",str) && str.size()) // get album specific alternate name first
-                        || (FindString(artist,"name",str) && str.size()))) // if not given, use the Discogs' name
-            {
-                if (joinstr.size()) rval.back().joiner = joinstr;
-
-                rval.emplace_back();
-                rval.back().name = str;
-
-                // look for the next join string and append it to the artist string
-                FindString(artist, "join", joinstr);
-            }
+            if (!IsComposer_(artist, credits)) AddCredit_(artist, joinstr, range);
         }
     }
-
-    return rval;
 }
 
-SCueArtists CDbDiscogsElem::Composer_(const json_t* data) const// maybe release or track json_t
+/**
+ * @brief Add the composer credits of album or track
+ * @param[in] pointer to album or track JSON object
+ * @param[out] credit range to fill
+ */
+void CDbDiscogsElem::Composer_(const json_t* data, SDbRelease::SRange &range) // maybe release or track json_t
 {
-    SCueArtists rval;
-    std::string joinstr, str;
+    std::string joinstr;
     json_t *artists;
     json_t *artist;
 
     // Get credits to check for composer
     json_t *credits;
-    if (!FindArray(data, "extraartists",credits)) credits = NULL;
+    if (!CUtilJson::FindArray(data, "extraartists",credits)) credits = NULL;
 
     // Look for artist entries
-    if (FindArray(data, "artists", artists))
+    if (CUtilJson::FindArray(data, "artists", artists))
     {
         size_t num_artists = json_array_size(artists);
         for (size_t i = 0; i<num_artists && (artist = json_array_get(artists,i)); i++)
         {
-            // if non-composer and given a valid name
-            if (IsComposer_(artist, credits)
-                    && ((FindString(artist,"anv",str) && str.size()) // get album specific alternate name first
-                        || (FindString(artist,"name",str) && str.size()))) // if not given, use the Discogs' name
-            {
-                if (joinstr.size()) rval.back().joiner = joinstr;
-
-                rval.emplace_back();
-                rval.back().name = str;
-
-                // look for the next join string and append it to the artist string
-                FindString(artist,"join", joinstr);
-            }
+            // if composer and given a valid name
+            if (IsComposer_(artist, credits)) AddCredit_(artist, joinstr, range);
         }
     }
 
     // if composer not given in main artists list, look in the credits
-    if (rval.empty())
+    if (!range.count)
     {
-        std::cout << "Composer not found in artists, checking extraartists\n";
-
         bool notfound = true;
         size_t num_artists = json_array_size(credits);
         for (size_t i = 0; notfound && i<num_artists && (artist = json_array_get(credits,i)); i++)
         {
-            PrintJSON(artist);
-
-            // if composer and given a valid name
-            if (IsComposer_(artist, credits, {"Composed By"}) // only look for "Composed By"
-                    && ((FindString(artist,"anv",str) && str.size()) // get album specific alternate name first
-                        || (FindString(artist,"name",str) && str.size()))) // if not given, use the Discogs' name
+            // if composer and given a valid name (only look for "Composed By")
+            if (IsComposer_(artist, credits, {"Composed By"}))
             {
-                notfound = false;
-                rval.emplace_back();
-                rval.back().name = str;
-                // if album credits, make sure not depending on position
+                joinstr.clear(); // a single composer
+                notfound = !AddCredit_(artist, joinstr, range);
             }
         }
     }
-
-    // if track composer still not found, look in the album credits
-    if (rval.empty() && credits!=album_credits)
-    {
-        // TODO
-    }
-
-    return rval;
 }
 
 bool CDbDiscogsElem::IsComposer_(const json_t* artist, const json_t* extraartists, const std::vector<std::string> &keywords)
@@ -680,11 +644,11 @@ bool CDbDiscogsElem::IsComposer_(const json_t* artist, const json_t* extraartist
 
     // get artist's role (check in the given artist JSON object first, then in the extraartists JSON array)
     std::string role;
-    FindString(artist,"role",role);
+    CUtilJson::FindString(artist,"role",role);
     if (role.empty())
     {
         artist = FindArtist_(ArtistId_(artist),extraartists);
-        if (artist) FindString(artist,"role",role);
+        if (artist) CUtilJson::FindString(artist,"role",role);
     }
 
     // if role is found, look for must creator
@@ -699,8 +663,6 @@ bool CDbDiscogsElem::IsComposer_(const json_t* artist, const json_t* extraartist
                 // make sure it is a standalone word
                 if (pos==0 || isspace(role[pos-1]))
                 {
-                    std::cout << "   verified a space before " << *it << "\n";
-
                     pos += (*it).size();
                     rval = pos >= role.size() || isspace(role[pos]);
                 }
@@ -738,57 +700,6 @@ json_t *CDbDiscogsElem::FindArtist_(const json_int_t id, const json_t* artists)
 json_int_t CDbDiscogsElem::ArtistId_(const json_t* artist)
 {
     json_int_t rval = -1;
-    FindInt(artist,"id",rval);
+    CUtilJson::FindInt(artist,"id",rval);
     return rval;
 }
-
-/**
- * @brief Analyze Artists lists to fill various_performers, various_composers, and album_credits
- */
-void CDbDiscogsElem::AnalyzeArtists_()
-{
-    various_performers = false;    // false if album has unique set of performing artists
-    various_composers = false;     // false if album has a single composer
-    album_credits = NULL;      // fixed link to the release's extraartists
-
-    // if element has no data, nothing to do
-    if (!data) return;
-
-    // Get and store the extraartist JSON array for later use
-    FindArray(data, "extraartists", album_credits);
-
-    // Look for artist entries
-    json_t *artists;
-    if (FindArray(data, "artists", artists) && json_array_size(artists)>0)
-    {
-        std::string name;
-        json_t *artist = json_array_get(artists,0);
-        FindString(artist,"name",name);
-
-        // Look for name == "Various"
-        various_performers = name.compare("Various")==0;
-
-        if (various_performers) // If various artist, possibly various_composers as well
-        {
-            various_composers = true;
-        }
-        else // specific artists given, check if they are composers (or any kind of music creaters)
-        {
-            // check if more than one composers are listed
-            int num_artists = json_array_size(artists);
-            int num_composers = IsComposer_(artist, album_credits);
-            for (int i=1;
-                 i<num_artists && (artist = json_array_get(artists,i));
-                 i++)
-            {
-                if (IsComposer_(artist, album_credits)) num_composers++;
-            }
-
-            // if more than a composer listed, multiple composers in the album
-            if (num_composers>1) various_composers = true;
-
-            // if only composer names are given
-            if (num_artists==num_composers) various_performers = true;
-        }
-    }
-}
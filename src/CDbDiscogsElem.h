@@ -6,8 +6,17 @@
 
 #include "CUtilJson.h"
 #include "SCueSheet.h"
-
-class CDbDiscogsElem : protected CUtilJson
+#include "SDbRelease.h"
+
+/** Discogs release record
+ *
+ *  CDbDiscogsElem extracts the fields it reports from a release JSON
+ *  response into a compact SDbRelease record when constructed: all the
+ *  tracks of the release are flattened (with the index track titles
+ *  prefixed to their sub_tracks) and their artists are split into the
+ *  performers and the composers. The JSON data is not kept.
+ */
+class CDbDiscogsElem
 {
     friend class CDbDiscogs;
 public:
@@ -150,13 +159,18 @@ private:
     int disc; // in the case of multi-disc set, indicate the disc # (zero-based)
     int track_offset; // starting track of the CD (always 0 if single disc release)
     int number_of_tracks; // number of tracks on the CD (-1 to use all tracks of the release)
+    json_int_t master_id; // master release ID (0 if none)
+    SDbRelease release; // release data with all the tracks of the release
 
-    bool various_performers;    // false if album has unique set of performing artists
-    bool various_composers;     // false if album has a single composer
-    json_t *album_credits;      // fixed link to the release's extraartists
+    /**
+     * @brief Extract the release data from the JSON object
+     * @param[in] release JSON object
+     */
+    void Extract_(const json_t *data);
 
     /**
      * @brief Traverses tracklist array and calls Callback() for every track-type element
+     * @param[in] release JSON object
      * @param[in] Callback function
      *
      * Callback (lambda) function:
@@ -169,19 +183,18 @@ private:
      *   heading: Pointer to the last seen JSON "heading track" object. NULL if there has been none.
      *   hidx: track index (only counting the main tracks) w.r.t. heading. Unknonwn if heading is NULL,
      */
-    void TraverseTracks_(
+    static void TraverseTracks_(const json_t *data,
             std::function<bool (const json_t *track,
                                 const json_t *parent, size_t pidx,
-                                const json_t *heading, size_t hidx)> Callback) const;
+                                const json_t *heading, size_t hidx)> Callback);
 
     /**
-     * @brief Find JSON object for the specified track
-     * @param[in] track number counting over multiple discs
-     * @param[out] if not NULL and track is found in sub_tracks listing, returns its parent index track JSON object
-     * @return pointer to a track JSON object
+     * @brief Find the specified track
+     * @param[in] track number on the CD
+     * @return reference to the track
+     * @throw runtime_error if track number is invalid
      */
-    const json_t* FindTrack_(const size_t trackno, const json_t **index=NULL, size_t *suboffset=NULL,
-                             const json_t **header=NULL, size_t *headoffset=NULL) const;
+    const SDbRelease::STrack &FindTrack_(const size_t trackno) const;
 
     /**
      * @brief Determine track offset for multi-disc release
@@ -193,11 +206,6 @@ private:
      */
     bool SetDiscOffset_(const std::vector<int> &tracklengths);
 
-    /**
-     * @brief Fill number_of_tracks
-     */
-    void SetDiscSize_();
-
     /**
      * @brief return the total number of sub_tracks listed under an index track
      * @param[in] pointer to the index track JSON object
@@ -213,25 +221,36 @@ private:
     static std::string Title_(const json_t* data); // maybe release or track json_t
 
     /**
-     * @brief Get a string of performer names associated with album or track. It excludes
-     *        composer names
+     * @brief Compose the title of a track
+     * @param[in] pointer to the track JSON object
+     * @param[in] pointer to the parent index track JSON object or NULL
+     * @param[in] sub_track index if parent is not NULL
+     * @return the title of the track
+     */
+    static std::string TrackTitle_(const json_t* track, const json_t* parent, size_t pidx);
+
+    /**
+     * @brief Add the performer credits (excluding composers) of album or track
      * @param[in] pointer to album or track JSON object
-     * @return string of performers
+     * @param[out] credit range to fill
      */
-    static SCueArtists Performer_(const json_t* data); // maybe release or track json_t
+    void Performer_(const json_t* data, SDbRelease::SRange &range); // maybe release or track json_t
 
     /**
-     * @brief Get a string of performer names associated with album or track. It excludes
-     *        composer names
+     * @brief Add the composer credits of album or track
      * @param[in] pointer to album or track JSON object
-     * @return composer
+     * @param[out] credit range to fill
      */
-    SCueArtists Composer_(const json_t* data) const; // maybe release or track json_t
+    void Composer_(const json_t* data, SDbRelease::SRange &range); // maybe release or track json_t
 
     /**
-     * @brief Analyze Artists lists to fill various_performers, various_composers, and album_credits
+     * @brief Add a credit for an artist JSON object
+     * @param[in] artist JSON object (an element of artists or extraartists arrays)
+     * @param[inout] join string, updated with the artist's if given
+     * @param[inout] credit range to append to
+     * @return false if the artist has no name
      */
-    void AnalyzeArtists_();
+    bool AddCredit_(const json_t* artist, std::string &joinstr, SDbRelease::SRange &range);
 
     static bool IsComposer_(const json_t* artist, const json_t* extraartists,
                             const std::vector<std::string> &keywords
@@ -33,7 +33,12 @@ const std::string CDbLastFm::base_url("http://ws.audioscrobbler.com/2.0/");
  */
 CDbLastFm::CDbLastFm(const std::string &key, const std::string &cname,const std::string &cversion)
     : CUtilUrl(cname,cversion), apikey(key), CoverArtSize(3)
-{}
+{
+    // Last.fm allows 5 requests per second on average; cover art lookups go
+    // behind the disc lookups
+    SetRateLimit_(HostName_(base_url), 5.0, 5.0);
+    SetPriority_(HttpPriority::BACKGROUND);
+}
 
 CDbLastFm::~CDbLastFm() {}
 
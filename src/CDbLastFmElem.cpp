@@ -10,11 +10,33 @@
 
 #include <iostream>
 
+#include "CUtilJson.h"
 #include "utils.h"
 
-CDbLastFmElem::CDbLastFmElem(const std::string &data)
-    : CUtilJson(data)
+CDbLastFmElem::CDbLastFmElem(const std::string &rawdata)
 {
+    CUtilJson json(rawdata);
+    if (!json.data) return;
+
+    std::string str;
+    if (json.FindString("id",str)) release.id = release.Intern(str);
+
+    // image links: <size, URL>
+    json_t *imarray, *imobject;
+    size_t index;
+    if (json.FindArray("image",imarray))
+    {
+        json_array_foreach(imarray, index, imobject)
+        {
+            if (!CUtilJson::FindString(imobject,"#text",str)) continue;
+
+            SDbRelease::SLink link = { 0, release.Intern(str) };
+            if (CUtilJson::FindString(imobject,"size",str)) link.type = release.Intern(str);
+            release.links.push_back(link);
+        }
+    }
+
+    release.Compact();
 }
 
 
@@ -24,9 +46,7 @@ CDbLastFmElem::CDbLastFmElem(const std::string &data)
  */
 void CDbLastFmElem::Swap(CDbLastFmElem &other)
 {
-    json_t *tempdata = data;
-    data = other.data;
-    other.data = tempdata;
+    release.Swap(other.release);
 }
 
 /** Return a unique release ID string
@@ -35,9 +55,7 @@ void CDbLastFmElem::Swap(CDbLastFmElem &other)
  */
 std::string CDbLastFmElem::ReleaseId() const
 {
-    std::string rval;
-    FindString("id",rval);
-    return rval;
+    return release.String(release.id);
 }
 
 /**
@@ -46,26 +64,8 @@ std::string CDbLastFmElem::ReleaseId() const
  */
 bool CDbLastFmElem::HasImage() const
 {
-    bool rval = false;
-
-    // must have image array object
-    json_t *imarray, *imobject;
-    size_t index;
-    std::string url;
-    if (FindArray("image",imarray))
-    {
-        // go through each image object (assume image array contains its immages in increasing size)
-        json_array_foreach(imarray, index, imobject)
-        {
-            // if any image exists, return valid
-            if (FindString(imobject,"#text",url))
-            {
-                rval = true;
-                break;
-            }
-        }
-    }
-    return rval;
+    // if any image exists, return valid
+    return release.links.size();
 }
 
 std::string CDbLastFmElem::ImageURL(int size) const
@@ -79,32 +79,26 @@ std::string CDbLastFmElem::ImageURL(int size) const
     //<image size="extralarge">…252px…</image>
     //<image size="mega">…500px…</image>
 
-    json_t *imarray, *imobject;
     std::string url, sizestr;
-    size_t index;
 
-    // must have image array object
-    if (FindArray("image",imarray))
+    // prepare size string
+    switch (size)
     {
-        // prepare size string
-        switch (size)
-        {
-        case 0: sizestr = "small"; break;
-        case 1: sizestr = "medium"; break;
-        case 2: sizestr = "large"; break;
-        case 3: sizestr = "extralarge"; break;
-        default: sizestr = "mega";
-        }
+    case 0: sizestr = "small"; break;
+    case 1: sizestr = "medium"; break;
+    case 2: sizestr = "large"; break;
+    case 3: sizestr = "extralarge"; break;
+    default: sizestr = "mega";
+    }
 
-        // go through each image object (assume image array contains its immages in increasing size)
-        json_array_foreach(imarray, index, imobject)
-        {
-            // grab the URL
-            if (!FindString(imobject,"#text",url)) continue;
+    // go through each image (assume images are listed in increasing size)
+    for (std::vector<SDbRelease::SLink>::const_iterator it = release.links.begin(); it!=release.links.end(); it++)
+    {
+        // grab the URL
+        url = release.String((*it).target);
 
-            // check the image type
-            if (CompareString(imobject,"size",sizestr)==0) break;
-        }
+        // check the image type
+        if (sizestr.compare(release.String((*it).type))==0) break;
     }
 
     return url;
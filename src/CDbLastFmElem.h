@@ -1,8 +1,16 @@
 #pragma once
 
-#include "CUtilJson.h"
+#include <string>
 
-class CDbLastFmElem : protected CUtilJson
+#include "SDbRelease.h"
+
+/** Last.fm album record
+ *
+ *  CDbLastFmElem extracts the album ID and the image URLs (as <size, URL>
+ *  links) from an album.getinfo JSON response into a compact SDbRelease
+ *  record. The JSON data is not kept.
+ */
+class CDbLastFmElem
 {
     friend class CDbLastFm;
 public:
@@ -35,4 +43,5 @@ public:
     std::string ImageURL(int CoverArtSize) const;
 
 private:
+    SDbRelease release;
 };
@@ -5,16 +5,22 @@
 #include "CDbMusicBrainz.h"
 
 #include <climits>
+#include <cstdlib>
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <algorithm>
 
 #include "SCueSheet.h"
 
 #include "CUtilXmlTree.h"
+#include "CUtilXmlStream.h"
 #include "CDbMusicBrainzElem.h"
 #include "CDbMusicBrainzElemCAA.h"
+#include "CDbMusicBrainzIndex.h"
 
 #include "CDbAmazonElem.h"
 #include "CDbAmazon.h"
@@ -29,7 +35,13 @@ using std::string;
 using std::runtime_error;
 using std::to_string;
 
-const std::string CDbMusicBrainz::base_url = "http://musicbrainz.org/ws/2/";
+/* number of artists resolved per artist search request */
+#define ARTIST_SEARCH_BATCH 25
+
+const std::string CDbMusicBrainz::base_url = "https://musicbrainz.org/ws/2/";
+const std::string CDbMusicBrainz::caa_url = "https://coverartarchive.org/release/";
+std::mutex CDbMusicBrainz::mutex_artists;
+CDbMusicBrainz::ArtistCache CDbMusicBrainz::artists;
 
 /** Constructor->l785
  *
@@ -38,7 +50,10 @@ const std::string CDbMusicBrainz::base_url = "http://musicbrainz.org/ws/2/";
  */
 CDbMusicBrainz::CDbMusicBrainz(const std::string &cname,const std::string &cversion)
     : CUtilUrl(cname,cversion), amazon(nullptr), CoverArtSize(2)
-{}
+{
+    // MusicBrainz web service allows 1 request per second on average
+    SetRateLimit_(HostName_(base_url), 1.0);
+}
 
 CDbMusicBrainz::~CDbMusicBrainz()
 {
@@ -78,89 +93,183 @@ int CDbMusicBrainz::Query(const SCueSheet &cuesheet, const std::string cdrom_upc
     // Clear the discs
     Clear();
 
-    cout << "[CDbMusicBrainz::Query] 1. Querying with disc TOC...";
+    // compute the disc ID (throws error if cuesheet is invalid)
+    discid = musicbrainz_discid(1, DiscToc_(cuesheet), cuesheet.TotalTime+150);
 
-    // must build disc based on cuesheet (throws error if fails to compute discid)
-    CUtilXmlTree discdata = GetNewDiscData_(cuesheet);
+    // Collect the releases to look up, from the offline index if the disc is known
+    vector<string> ids, docs;
+    vector<int> discs;
+    SMusicBrainzIndexReleases indexed;
+    bool offline = index && index->Lookup(discid, indexed);
+    if (offline)
+    {
+        cout << "[CDbMusicBrainz::Query] 1. Found disc " << discid << " in the offline index" << endl;
 
-    const xmlNode *release_node;
-    std::string url;
-    if (discdata.FindArray("release-list",release_node))
+        for (SMusicBrainzIndexReleases::iterator it = indexed.begin(); it!=indexed.end(); it++)
+        {
+            ids.push_back((*it).id);
+            discs.push_back((*it).disc);
+            docs.push_back((*it).data);
+            CacheArtists_((*it).artists);
+        }
+    }
+    else
     {
-        cout << "[CDbMusicBrainz::Query] 2. Getting more information of each release... " << endl;
+        cout << "[CDbMusicBrainz::Query] 1. Querying with disc TOC...";
 
-        bool upc_match = false;
-        std::string id, barcode;
+        CUtilXmlTree discdata = GetNewDiscData_(cuesheet);
 
-        // Create new MBQueries element & populate
-        for (; !upc_match && release_node; release_node = release_node->next)
+        const xmlNode *release_node;
+        if (discdata.FindArray("release-list",release_node))
         {
-            cout << "[CDbMusicBrainz::Query] Processing Release " << Releases.size() << "... " << endl;
+            bool upc_match = false;
+            std::string id, barcode;
 
-            // retrieve the release ID (if failed, skip the release)
-            if (!discdata.FindElementAttribute(release_node,"id",id)) continue;
+            for (; !upc_match && release_node; release_node = release_node->next)
+            {
+                cout << "[CDbMusicBrainz::Query] Processing Release " << ids.size() << "... " << endl;
 
-            cout << "[CDbMusicBrainz::Query]    ID: " << id  << endl;
+                // retrieve the release ID (if failed, skip the release)
+                if (!discdata.FindElementAttribute(release_node,"id",id)) continue;
 
-            // match disc
-            int disc = DiscID_(release_node, cuesheet.Tracks.size(), cuesheet.TotalTime);
+                cout << "[CDbMusicBrainz::Query]    ID: " << id  << endl;
 
-            cout << "[CDbMusicBrainz::Query]    Disc#: " << disc  << endl;
+                // match disc
+                int disc = DiscID_(release_node, cuesheet.Tracks.size(), cuesheet.TotalTime);
 
-            // Check the UPC
-            if (cdrom_upc.size() && discdata.FindString(release_node,"barcode",barcode))
-            {
-                if (barcode.size())
-                {
-                    // remove non-digits from barcode string before comparison
-                    cleanup_upc(barcode);
-                    upc_match = (cdrom_upc.compare(barcode)==0);
+                cout << "[CDbMusicBrainz::Query]    Disc#: " << disc  << endl;
 
-                    // If UPC matched, discard all previous entries
-                    if (upc_match) Releases.clear();
+                // Check the UPC
+                if (cdrom_upc.size() && discdata.FindString(release_node,"barcode",barcode))
+                {
+                    if (barcode.size())
+                    {
+                        // remove non-digits from barcode string before comparison
+                        cleanup_upc(barcode);
+                        upc_match = (cdrom_upc.compare(barcode)==0);
+
+                        // If UPC matched, discard all previous entries
+                        if (upc_match)
+                        {
+                            ids.clear();
+                            discs.clear();
+                        }
+                    }
                 }
-            }
-
-            // Build release lookup URL
-            url.clear();
-            url = base_url + "release/" + id + "?inc=labels+artists+recordings+artist-credits+release-groups+url-rels";
 
-            cout << "[CDbMusicBrainz::Query]    URL: " << url << endl;
-
-            // Get release data & create new entry
-            PerformHttpTransfer_(url); // received data is stored in rawdata
+                ids.push_back(id);
+                discs.push_back(disc);
+            }
+            docs.resize(ids.size());
+        }
+    }
 
-            // Parse the downloaded XML data
-            Releases.emplace_back(rawdata, disc);
+    size_t nreleases = ids.size();
+    if (nreleases)
+    {
+        cout << "[CDbMusicBrainz::Query] 2. Getting more information of each release... " << endl;
 
-            // Get the locale-specific names
-            GetLocalArtistNames(Releases.back());
+        // Build release (if not indexed) lookup URLs along with the coverart
+        // lookup URL of the top candidate, so all are fetched together
+        // (coverartarchive.org redirects to the image server). The other
+        // coverarts are looked up only if requested (see GetCAA_()), as is
+        // the top candidate's if all the releases are indexed, so that an
+        // indexed disc makes no request at all.
+        vector<string> urls, data;
+        vector<size_t> missing;
+        urls.reserve(nreleases+1);
+        for (size_t i=0; i<nreleases; i++)
+        {
+            if (docs[i].size()) continue;
+            urls.push_back(base_url + "release/" + ids[i] + "?inc=labels+artists+recordings+artist-credits+release-groups+url-rels");
+            missing.push_back(i);
+        }
+        if (missing.size()) urls.push_back(caa_url + ids[0]);
+
+        cout << "[CDbMusicBrainz::Query] Retrieving " << missing.size() << " releases"
+             << (missing.size() ? " & 1 cover art" : "") << endl;
+
+        // Parse the indexed XML data, and the downloaded XML data on the fly
+        // (the documents are also kept only if to be indexed)
+        Releases.reserve(nreleases);
+        for (size_t i=0; i<nreleases; i++)
+            Releases.emplace_back(docs[i], discs[i]);
+
+        vector<std::unique_ptr<CUtilXmlStream>> parsers;
+        vector<HttpStreamFunc> funcs;
+        parsers.reserve(missing.size());
+        funcs.reserve(missing.size());
+        for (size_t i=0; i<missing.size(); i++)
+        {
+            parsers.push_back(Releases[missing[i]].NewParser());
+            CUtilXmlStream *parser = parsers.back().get();
+            string *doc = index ? &docs[missing[i]] : NULL;
+            funcs.emplace_back([parser,doc](const char *ptr, const size_t size)
+            {
+                parser->Feed(ptr, size);
+                if (doc) doc->append(ptr, size);
+            });
+        }
 
+        // an indexed disc resolves without the network: only the releases
+        // missing their documents fail if offline
+        bool online = true;
+        try
+        {
+            if (urls.size()) PerformHttpTransfers_(urls, data, true, funcs);
+            for (size_t i=0; i<parsers.size(); i++) parsers[i]->Finish();
+        }
+        catch (...)
+        {
+            if (!offline) throw;
+            online = false;
         }
+        parsers.clear();
 
-        cout << "[CDbMusicBrainz::Query] Searching for cover arts]" << endl;
+        // drop the releases failed to be retrieved
+        if (!online)
+        {
+            for (size_t i=missing.size(); i>0; i--)
+                Releases.erase(Releases.begin()+missing[i-1]);
+        }
 
-        // Populate CoverArts vector
-        CoverArts.reserve(Releases.size());
-        for (vector<CDbMusicBrainzElem>::iterator it = Releases.begin();
-             it != Releases.end();
-             it ++)
+        // Parse the downloaded JSON data of the top candidate's coverart
+        CoverArts.resize(Releases.size());
+        if (online && missing.size())
         {
-            // Build coverart lookup URL
-            std::string url = "http://coverartarchive.org//release/" + it->ReleaseId();
+            try
+            {
+                CoverArts[0].reset(new CDbMusicBrainzElemCAA(data[missing.size()]));
+            }
+            catch(...) // invalid data -> no coverart
+            {
+                CoverArts[0].reset(new CDbMusicBrainzElemCAA(""));
+            }
+        }
 
-            // Get release data & create new entry
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-            PerformHttpTransfer_(url); // received data is stored in rawdata
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L);
+        // Get the locale-specific names (of an indexed disc, from the cache
+        // filled from the index above)
+        try
+        {
+            GetLocalArtistNames(Releases);
+        }
+        catch (...)
+        {
+            if (!offline) throw;
+        }
 
-            // Parse the downloaded JSON data
-            try
+        // Record the disc in the offline index, or update it if the artist
+        // names had to be resolved online
+        if (index && online)
+        {
+            SMusicBrainzIndexReleases releases;
+            bool update = !missing.empty();
+            for (size_t i=0; i<nreleases; i++)
             {
-                CoverArts.emplace_back(rawdata);    // if rawdata invalid, would not affect the container
+                releases.emplace_back(ids[i], discs[i], docs[i], EncodeArtists_(Releases[i]));
+                if (offline && releases.back().artists!=indexed[i].artists) update = true;
             }
-            catch(...)
-            {}
+            if (update) index->Insert(discid, releases);
         }
     }
 
@@ -170,6 +279,45 @@ int CDbMusicBrainz::Query(const SCueSheet &cuesheet, const std::string cdrom_upc
     return Releases.size();
 }
 
+/**
+ * @brief Set the offline index of disc lookups. Query() looks up the disc
+ *        in the index before accessing the MusicBrainz server, and records
+ *        each disc found online in the index.
+ * @param[in] index (may be shared among CDbMusicBrainz objects), or null to
+ *            disable
+ */
+void CDbMusicBrainz::SetOfflineIndex(const std::shared_ptr<CDbMusicBrainzIndex> &idx)
+{
+    index = idx;
+}
+
+/**
+ * @brief Get the track offsets of the disc
+ * @param[in] cuesheet representing the disc
+ * @return track offsets in sectors, including the 150-sector lead-in
+ * @throw runtime_error if a track is missing index 1
+ */
+std::vector<size_t> CDbMusicBrainz::DiscToc_(const SCueSheet &cuesheet)
+{
+    vector<size_t> offsets;
+    offsets.reserve(cuesheet.Tracks.size());
+
+    SCueTrackDeque::const_iterator itTrack;
+    for (itTrack=cuesheet.Tracks.begin(); itTrack!=cuesheet.Tracks.end(); itTrack++)
+    {
+        const SCueTrack &track = *itTrack;
+        SCueTrackIndexDeque::const_iterator itIndex;
+        for (itIndex=track.Indexes.begin(); itIndex!=track.Indexes.end() && (*itIndex).number<1; itIndex++);
+
+        if (itIndex==track.Indexes.end() || (*itIndex).number>1)
+            throw (std::runtime_error("Invalid cuesheet: A track is missing Index 1."));
+
+        offsets.push_back((*itIndex).time+150);
+    }
+
+    return offsets;
+}
+
 /** Initialize a new disc and fill it with disc info
  *  from the supplied cuesheet and length. Previously created disc
  *  data are discarded. After disc and its tracks are initialized,
@@ -183,26 +331,19 @@ CUtilXmlTree CDbMusicBrainz::GetNewDiscData_(const SCueSheet &cuesheet)
 {
     // Build discid lookup URL
     std::ostringstream url;
-    url << base_url << "discid/-?toc=1+" << cuesheet.Tracks.size() << "+" << cuesheet.TotalTime+150;
+    url << base_url << "discid/" << discid << "?toc=1+" << cuesheet.Tracks.size() << "+" << cuesheet.TotalTime+150;
 
-    // add duration of each track
-    SCueTrackDeque::const_iterator itTrack;
-    for (itTrack=cuesheet.Tracks.begin(); itTrack!=cuesheet.Tracks.end(); itTrack++)
-    {
-        const SCueTrack &track = *itTrack;
-        SCueTrackIndexDeque::const_iterator itIndex;
-        for (itIndex=track.Indexes.begin(); itIndex!=track.Indexes.end() && (*itIndex).number<1; itIndex++);
-
-        if ((*itIndex).number>1) throw (std::runtime_error("Invalid cuesheet: A track is missing Index 1."));
-
-        url << "+" << (*itIndex).time+150;
-    }
+    // add offset of each track
+    vector<size_t> offsets = DiscToc_(cuesheet);
+    for (vector<size_t>::iterator it=offsets.begin(); it!=offsets.end(); it++)
+        url << "+" << *it;
 
     // Get release data & create new entry
     PerformHttpTransfer_(url.str()); // received data is stored in rawdata
 
-    // Parse the downloaded XML data
-    CUtilXmlTree discdata(rawdata);
+    // Parse the downloaded XML data (indexed, as the medium and track lists
+    // of every release are searched)
+    CUtilXmlTree discdata(rawdata, true);
 
     return discdata;
 }
@@ -271,16 +412,17 @@ void CDbMusicBrainz::Clear()
 {
     // clear the list of matched releases and their coverart info
     Releases.clear();
+    CoverArts.clear();
+    discid.clear();
 }
 
-/** Return the CDDB discid
+/** Return the MusicBrainz discid
  *
- *  @return CDDB discid if Query() has been completed successfully. Otherwise
- *          zero.
+ *  @return MusicBrainz discid if Query() has been called. Otherwise empty.
  */
 std::string CDbMusicBrainz::GetDiscId() const
 {
-    return "";
+    return discid;
 }
 
 /** Returns the number of matches (records) returned from the last Query() call.
@@ -619,7 +761,7 @@ bool CDbMusicBrainz::Front(const int recnum) const
  */
 bool CDbMusicBrainz::Back(const int recnum) const
 {
-    if (recnum<0||recnum>(int)CoverArts.size())
+    if (recnum<0||recnum>=(int)Releases.size())
         throw(runtime_error("Invalid Record Index requested."));
 
     return Releases[recnum].Back();
@@ -655,19 +797,11 @@ std::string CDbMusicBrainz::FrontURL(const int recnum) const
     string rval;
 
     // check recnum validity
-    if (recnum<0||recnum>(int)CoverArts.size())
+    if (recnum<0||recnum>=(int)Releases.size())
         throw(runtime_error("Invalid Record Index requested."));
 
-    // get release
-    std::string id = Releases[recnum].ReleaseId();
-
-    // loop CoverArts to look for the data
-    for (std::vector<CDbMusicBrainzElemCAA>::const_iterator it = CoverArts.begin();
-         rval.empty() && it!=CoverArts.end();
-         it++)
-    {
-        if (id.compare((*it).ReleaseId())==0) rval = (*it).FrontURL(CoverArtSize);
-    }
+    // look up the Cover Art Archive only if the release has the cover
+    if (Releases[recnum].Front()) rval = GetCAA_(recnum).FrontURL(CoverArtSize);
 
     // if coverart not available on CAA, check if Amazon link is given
     if (rval.empty() && amazon)
@@ -689,21 +823,48 @@ std::string CDbMusicBrainz::BackURL(const int recnum) const
     string rval;
 
     // check recnum validity
-    if (recnum<0||recnum>(int)CoverArts.size())
+    if (recnum<0||recnum>=(int)Releases.size())
         throw(runtime_error("Invalid Record Index requested."));
 
-    // get release
-    std::string id = Releases[recnum].ReleaseId();
+    // look up the Cover Art Archive only if the release has the cover
+    if (Releases[recnum].Back()) rval = GetCAA_(recnum).BackURL(CoverArtSize);
+
+    return rval;
+}
+
+/**
+ * @brief Get the Cover Art Archive listing of a release. The listing is
+ *        downloaded on the first request (only the top candidate's is
+ *        prefetched by Query()) and kept until the next query.
+ * @param[in] record index
+ * @return the listing (empty if the release has no cover art or the
+ *         download failed)
+ */
+const CDbMusicBrainzElemCAA &CDbMusicBrainz::GetCAA_(const int recnum) const
+{
+    std::lock_guard<std::mutex> lck(mutex_coverart);
 
-    // loop CoverArts to look for the data
-    for (std::vector<CDbMusicBrainzElemCAA>::const_iterator it = CoverArts.begin();
-         rval.empty() && it!=CoverArts.end();
-         it++)
+    std::unique_ptr<CDbMusicBrainzElemCAA> &coverart = CoverArts[recnum];
+    if (!coverart)
     {
-        if (id.compare((*it).ReleaseId())==0) rval = (*it).BackURL(CoverArtSize);
+        string data;
+        try
+        {
+            // (the listing is a cache of the database, so it is fetched in
+            // const accessors)
+            vector<string> docs;
+            const_cast<CDbMusicBrainz*>(this)->PerformHttpTransfers_(
+                        vector<string>(1, caa_url + Releases[recnum].ReleaseId()), docs, true);
+            data.swap(docs[0]);
+            coverart.reset(new CDbMusicBrainzElemCAA(data));
+        }
+        catch(...) // failed to download or invalid data -> no coverart
+        {
+            coverart.reset(new CDbMusicBrainzElemCAA(""));
+        }
     }
 
-    return rval;
+    return *coverart;
 }
 
 /**
@@ -731,11 +892,14 @@ std::string CDbMusicBrainz::RelationUrl(const std::string &type, const int recnu
         url.clear();
         url = base_url + "release-group/" + id + "?inc=url-rels";
 
-        // Get release data & create new entry
+        // Get release data & create new entry (linked databases may call
+        // this function concurrently)
+        std::unique_lock<std::mutex> lck(mutex_relation);
         PerformHttpTransfer_(url); // received data is stored in rawdata
 
         // Parse the downloaded XML data
         CUtilXmlTree rgroupdata(rawdata);
+        lck.unlock();
 
         // look through all relation
         string rval;
@@ -789,73 +953,224 @@ void CDbMusicBrainz::SetPreferredLocale(const std::string &code)
     PreferredLocale = code;
 
     // Update the locale-specific names
-    std::vector<CDbMusicBrainzElem>::iterator it;
-    for (it=Releases.begin(); it!=Releases.end(); it++)
-        GetLocalArtistNames(*it);
+    GetLocalArtistNames(Releases);
 }
 
 /**
- * @brief Populate locale-specific artist names. If already done, immediately returns
+ * @brief Populate locale-specific artist names of releases. The unique
+ *        artists of all the releases not found in the process-wide
+ *        artist cache are resolved in batches via the artist search (and
+ *        individually if missing from the search index).
  * @param[in] release data
  */
-void CDbMusicBrainz::GetLocalArtistNames(CDbMusicBrainzElem &release)
+void CDbMusicBrainz::GetLocalArtistNames(std::vector<CDbMusicBrainzElem> &releases)
 {
-    CDbMusicBrainzElem::ArtistDbInfoVector infovec = release.GetArtistDbInfo();
+    typedef std::map<string, SCueArtistNoJoiner> ArtistInfoMap;
 
-    // if Preferred Locale code is set, and names have not been retrieved, do so now
-    std::string url, name;
-    CDbMusicBrainzElem::ArtistDbInfoVector::iterator it;
-    for (it = infovec.begin(); it !=infovec.end(); it++) // for each artist
+    // gather the unique artists of all the releases
+    vector<CDbMusicBrainzElem::ArtistDbInfoVector> infovecs;
+    infovecs.reserve(releases.size());
+    ArtistInfoMap lookups;
+    for (size_t i=0; i<releases.size(); i++)
     {
-        bool primary = false;
-        const xmlNode *artist, *alias;
+        infovecs.push_back(releases[i].GetArtistDbInfo());
 
-        url = base_url + "artist/" + it->id + "?inc=aliases";
-        name.clear();
+        CDbMusicBrainzElem::ArtistDbInfoVector::iterator it;
+        for (it = infovecs.back().begin(); it !=infovecs.back().end(); it++) // for each artist
+            lookups.emplace(it->id, SCueArtistNoJoiner());
+    }
 
-        // Get release data & create new entry
-        PerformHttpTransfer_(url); // received data is stored in rawdata
+    // pick the artists already resolved (by any object)
+    vector<string> missing;
+    {
+        std::lock_guard<std::mutex> lck(mutex_artists);
+        for (ArtistInfoMap::iterator it = lookups.begin(); it!=lookups.end(); it++)
+        {
+            ArtistCache::const_iterator cached = artists.find(PreferredLocale + "/" + (*it).first);
+            if (cached!=artists.end()) (*it).second = (*cached).second;
+            else missing.push_back((*it).first);
+        }
+    }
 
-        // Parse the downloaded XML data
-        CUtilXmlTree artistdata(rawdata);
+    if (missing.size())
+    {
+        // search the missing artists, ARTIST_SEARCH_BATCH per request
+        vector<string> urls, docs;
+        for (size_t i=0; i<missing.size(); i+=ARTIST_SEARCH_BATCH)
+        {
+            size_t n = std::min(missing.size()-i, (size_t)ARTIST_SEARCH_BATCH);
+            string url = base_url + "artist/?limit=" + to_string(n) + "&query=arid:(" + missing[i];
+            for (size_t j=1; j<n; j++) url += "%20OR%20" + missing[i+j];
+            urls.push_back(url + ")");
+        }
+        PerformHttpTransfers_(urls, docs);
 
-        if (artistdata.FindElement("artist", artist))
+        ArtistInfoMap found;
+        for (size_t i=0; i<docs.size(); i++) ParseArtistSearch_(docs[i], found);
+
+        // look up those missing from the search index (e.g., just added)
+        urls.clear();
+        vector<string> ids;
+        for (size_t i=0; i<missing.size(); i++)
+        {
+            if (found.count(missing[i])) continue;
+            ids.push_back(missing[i]);
+            urls.push_back(base_url + "artist/" + missing[i] + "?inc=aliases");
+        }
+        if (urls.size())
         {
-            // Get the artist type
-            std::string type;
-            if (artistdata.FindElementAttribute(artist,"type",type))
+            PerformHttpTransfers_(urls, docs);
+            for (size_t i=0; i<urls.size(); i++)
             {
-                if (type.compare("Person")==0) it->type = SCueArtistType::PERSON;
-                else if (type.compare("Group")==0 || type.compare("Orchestra")==0 || type.compare("Choir")==0)
-                    it->type = SCueArtistType::GROUP;
+                SCueArtistNoJoiner info;
+                if (ParseArtistData_(docs[i], info)) found[ids[i]] = info;
             }
+        }
 
-            // Get artist name in preferred locale if available
-            if (PreferredLocale.size())
-            {
-                // get down to "alias-list"
-                for(artistdata.FindArray(artist,"alias-list",alias);
-                    !primary && alias; alias = alias->next)
-                {
-                    // look for the matched-locale Artist name alias
-                    if (artistdata.CompareElementAttribute(alias,"type","Artist name")==0
-                            && artistdata.CompareElementAttribute(alias,"locale",PreferredLocale)==0)
-                    {
-                        // check if it is the primary alias
-                        primary = artistdata.CompareElementAttribute(alias,"primary","primary")==0;
+        // record the resolved artists
+        std::lock_guard<std::mutex> lck(mutex_artists);
+        for (ArtistInfoMap::iterator it = found.begin(); it!=found.end(); it++)
+        {
+            lookups[(*it).first] = (*it).second;
+            artists[PreferredLocale + "/" + (*it).first] = (*it).second;
+        }
+    }
 
-                        // grab its first child node, assuming it to be text node
-                        if (primary || name.empty())
-                            name = (char*)alias->children->content;
-                    }
+    // update the releases
+    for (size_t i=0; i<releases.size(); i++)
+    {
+        CDbMusicBrainzElem::ArtistDbInfoVector::iterator it;
+        for (it = infovecs[i].begin(); it !=infovecs[i].end(); it++)
+        {
+            const SCueArtistNoJoiner &info = lookups[it->id];
+            if (info.type!=SCueArtistType::UNKNOWN) it->type = info.type;
+            if (info.name.size()) it->name = info.name;
+        }
 
-                    // if locale-specific name found, update the AliasMap
-                    if (name.size()) it->name = name;
-                }
-            }
+        // set release's internal flag
+        releases[i].SetArtistDbInfo(infovecs[i]);
+    }
+}
+
+/**
+ * @brief Encode the artist names of a release resolved in the preferred
+ *        locale, to be recorded in the offline index: a line of
+ *        "<locale>/<MBID>", type & name (tab-separated) per artist
+ * @param[in] release data
+ * @return encoded artist names
+ */
+std::string CDbMusicBrainz::EncodeArtists_(CDbMusicBrainzElem &release) const
+{
+    CDbMusicBrainzElem::ArtistDbInfoVector info = release.GetArtistDbInfo();
+
+    string rval;
+    std::lock_guard<std::mutex> lck(mutex_artists);
+    for (CDbMusicBrainzElem::ArtistDbInfoVector::iterator it = info.begin(); it!=info.end(); it++)
+    {
+        string key = PreferredLocale + "/" + it->id;
+        ArtistCache::const_iterator cached = artists.find(key);
+        if (cached==artists.end() || rval.find(key+"\t")!=string::npos) continue;
+        rval += key + "\t" + to_string((int)(*cached).second.type) + "\t" + (*cached).second.name + "\n";
+    }
+    return rval;
+}
+
+/**
+ * @brief Put the artist names recorded in the offline index (see
+ *        EncodeArtists_()) into the process-wide artist cache
+ * @param[in] encoded artist names
+ */
+void CDbMusicBrainz::CacheArtists_(const std::string &data)
+{
+    std::istringstream is(data);
+    string key, type, name;
+    std::lock_guard<std::mutex> lck(mutex_artists);
+    while (std::getline(is, key, '\t') && std::getline(is, type, '\t') && std::getline(is, name))
+        artists[key] = SCueArtistNoJoiner(name, (SCueArtistType)atoi(type.c_str()));
+}
+
+/**
+ * @brief Parse artist lookup data
+ * @param[in] downloaded artist XML data
+ * @param[out] artist type and name in preferred locale (if found)
+ * @return true if the artist is found in the data
+ */
+bool CDbMusicBrainz::ParseArtistData_(const std::string &data, SCueArtistNoJoiner &info) const
+{
+    const xmlNode *artist;
+
+    // Parse the downloaded XML data
+    CUtilXmlTree artistdata(data);
+
+    bool rval = artistdata.FindElement("artist", artist);
+    if (rval) ParseArtist_(artist, info);
+    return rval;
+}
+
+/**
+ * @brief Parse artist search data
+ * @param[in] downloaded artist search XML data
+ * @param[out] type and name in preferred locale of the found artists, keyed by MBID
+ */
+void CDbMusicBrainz::ParseArtistSearch_(const std::string &data, std::map<std::string, SCueArtistNoJoiner> &infos) const
+{
+    const xmlNode *artist;
+    string id;
+
+    // Parse the downloaded XML data
+    CUtilXmlTree searchdata(data);
+
+    if (searchdata.FindArray("artist-list", artist))
+    {
+        for (; artist; artist = artist->next)
+        {
+            if (artist->type==XML_ELEMENT_NODE && searchdata.FindElementAttribute(artist,"id",id))
+                ParseArtist_(artist, infos[id]);
         }
     }
+}
 
-    // set release's internal flag
-    release.SetArtistDbInfo(infovec);
+/**
+ * @brief Parse an artist element (of lookup or search data)
+ * @param[in] artist element
+ * @param[out] artist type and name in preferred locale (if found)
+ */
+void CDbMusicBrainz::ParseArtist_(const xmlNode *artist, SCueArtistNoJoiner &info) const
+{
+    bool primary = false;
+    const xmlNode *alias;
+    std::string name;
+
+    // Get the artist type
+    std::string type;
+    if (CUtilXmlTree::FindElementAttribute(artist,"type",type))
+    {
+        if (type.compare("Person")==0) info.type = SCueArtistType::PERSON;
+        else if (type.compare("Group")==0 || type.compare("Orchestra")==0 || type.compare("Choir")==0)
+            info.type = SCueArtistType::GROUP;
+    }
+
+    // Get artist name in preferred locale if available
+    if (PreferredLocale.size())
+    {
+        // get down to "alias-list"
+        for(CUtilXmlTree::FindArray(artist,"alias-list",alias);
+            !primary && alias; alias = alias->next)
+        {
+            // look for the matched-locale Artist name alias
+            if (CUtilXmlTree::CompareElementAttribute(alias,"type","Artist name")==0
+                    && CUtilXmlTree::CompareElementAttribute(alias,"locale",PreferredLocale)==0)
+            {
+                // check if it is the primary alias
+                primary = CUtilXmlTree::CompareElementAttribute(alias,"primary","primary")==0;
+
+                // grab its first child node, assuming it to be text node
+                if (primary || name.empty())
+                    name = (char*)alias->children->content;
+            }
+        }
+
+        // if locale-specific name found, update the name
+        if (name.size()) info.name = name;
+    }
 }
@@ -2,6 +2,10 @@
 
 #include <vector>
 #include <string>
+#include <mutex>
+#include <memory>
+#include <map>
+#include <unordered_map>
 
 #include <libxml/tree.h>
 
@@ -14,6 +18,7 @@ class CDbMusicBrainzElem;
 class CDbMusicBrainzElemCAA;
 class CUtilXmlTree;
 class CDbAmazon;
+class CDbMusicBrainzIndex;
 
 /** Class to access MusicBrainz online CD and coverart databases service.
  */
@@ -126,9 +131,9 @@ public:
 
     ///////////////////////////////////////////////////////////////////////////
 
-    /** Return the discid string
+    /** Return the MusicBrainz discid string
    *
-   *  @return discid string.
+   *  @return discid string (empty if Query() has not been called).
    */
     virtual std::string GetDiscId() const;
 
@@ -398,15 +403,33 @@ public:
      */
     void SetPreferredLocale(const std::string &code);
 
+    /**
+     * @brief Set the offline index of disc lookups. Query() looks up the disc
+     *        in the index before accessing the MusicBrainz server, and records
+     *        each disc found online in the index.
+     * @param[in] index (may be shared among CDbMusicBrainz objects), or null to
+     *            disable
+     */
+    void SetOfflineIndex(const std::shared_ptr<CDbMusicBrainzIndex> &index);
+
 private:
     static const std::string base_url;
+    static const std::string caa_url; // Cover Art Archive release listing
     std::vector<CDbMusicBrainzElem> Releases;
-    std::vector<CDbMusicBrainzElemCAA> CoverArts;
+    mutable std::vector<std::unique_ptr<CDbMusicBrainzElemCAA>> CoverArts; // per release, fetched on demand (null until then)
+    mutable std::mutex mutex_coverart; // serializes GetCAA_() lookups
     std::string PreferredLocale;    // for artist names
     CDbAmazon *amazon;
+    std::mutex mutex_relation; // serializes RelationUrl() lookups
+    std::string discid; // MusicBrainz disc ID of the last query
+    std::shared_ptr<CDbMusicBrainzIndex> index; // offline disc index (optional)
 
     int CoverArtSize; // 0-full, 1-large thumbnail (500px), 2-small thumbnail (250px)
 
+    typedef std::unordered_map<std::string, SCueArtistNoJoiner> ArtistCache;
+    static std::mutex mutex_artists;
+    static ArtistCache artists; // process-wide artist info, keyed by "<locale>/<MBID>"
+
     /** Initialize a new disc and fill it with disc info
      *  from the supplied cuesheet and length. Previously created disc
      *  data are discarded. After disc and its tracks are initialized,
@@ -417,6 +440,14 @@ private:
      */
     CUtilXmlTree GetNewDiscData_(const SCueSheet &cuesheet);
 
+    /**
+     * @brief Get the track offsets of the disc
+     * @param[in] cuesheet representing the disc
+     * @return track offsets in sectors, including the 150-sector lead-in
+     * @throw runtime_error if a track is missing index 1
+     */
+    static std::vector<size_t> DiscToc_(const SCueSheet &cuesheet);
+
     /**
      * @brief Check medium-list in a discid release to identify the disc if multi-disc set
      * @param[in] pointer to an XML node for a release
@@ -425,16 +456,59 @@ private:
      */
     int DiscID_(const xmlNode *release_node, const int trackcount, const size_t totaltime);
 
-    /** Retrieve the front cover data.
-     *
-     *  @param[out] image data buffer.
-     *  @param[in]  record index (default=0)
+    /**
+     * @brief Get the Cover Art Archive listing of a release. The listing is
+     *        downloaded on the first request (only the top candidate's is
+     *        prefetched by Query()) and kept until the next query.
+     * @param[in] record index
+     * @return the listing (empty if the release has no cover art or the
+     *         download failed)
+     */
+    const CDbMusicBrainzElemCAA &GetCAA_(const int recnum) const;
+
+    /**
+     * @brief Populate locale-specific artist names of releases. The unique
+     *        artists of all the releases not found in the process-wide
+     *        artist cache are resolved in batches via the artist search (and
+     *        individually if missing from the search index).
+     * @param[in] release data
      */
-    bool GetCAA_(const int recnum, CDbMusicBrainzElemCAA &coverart) const;
+    void GetLocalArtistNames(std::vector<CDbMusicBrainzElem> &releases);
 
     /**
-     * @brief Populate locale-specific artist names. If already done, immediately returns
+     * @brief Encode the artist names of a release resolved in the preferred
+     *        locale, to be recorded in the offline index
      * @param[in] release data
+     * @return encoded artist names
+     */
+    std::string EncodeArtists_(CDbMusicBrainzElem &release) const;
+
+    /**
+     * @brief Put the artist names recorded in the offline index (see
+     *        EncodeArtists_()) into the process-wide artist cache
+     * @param[in] encoded artist names
+     */
+    static void CacheArtists_(const std::string &data);
+
+    /**
+     * @brief Parse artist lookup data
+     * @param[in] downloaded artist XML data
+     * @param[out] artist type and name in preferred locale (if found)
+     * @return true if the artist is found in the data
+     */
+    bool ParseArtistData_(const std::string &data, SCueArtistNoJoiner &info) const;
+
+    /**
+     * @brief Parse artist search data
+     * @param[in] downloaded artist search XML data
+     * @param[out] type and name in preferred locale of the found artists, keyed by MBID
+     */
+    void ParseArtistSearch_(const std::string &data, std::map<std::string, SCueArtistNoJoiner> &infos) const;
+
+    /**
+     * @brief Parse an artist element (of lookup or search data)
+     * @param[in] artist element
+     * @param[out] artist type and name in preferred locale (if found)
      */
-    void GetLocalArtistNames(CDbMusicBrainzElem &release);
+    void ParseArtist_(const xmlNode *artist, SCueArtistNoJoiner &info) const;
 };
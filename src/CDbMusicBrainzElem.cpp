@@ -6,6 +6,7 @@
 #include <climits>
 #include <cctype>
 #include <algorithm>
+#include <unordered_map>
 //#include <ctime>
 //#include <sstream>
 //#include <iomanip>
@@ -19,17 +20,368 @@ using std::endl;
 
 #include "utils.h"
 
-CDbMusicBrainzElem::CDbMusicBrainzElem(const std::string &rawdata, const int d)
-    : CUtilXmlTree(rawdata), disc(d), artists_info_set(false)
+using std::string;
+
+/** Streaming extractor of a release lookup response
+ */
+class CDbMusicBrainzElem::Parser : public CUtilXmlStream
 {
-    // change the root to release element
-    if (root)
+    struct Credit
     {
-        if (!FindObject("release",root) && root)
-            throw(std::runtime_error("MusicBrainz release lookup resulted in an invalid result."));
+        std::string id;         // artist MBID
+        std::string name;       // artist name
+        std::string joinphrase; // joining string to the next artist
+    };
+    typedef std::vector<Credit> CreditVector;
 
-        AnalyzeArtists_();
+    struct Track
+    {
+        int position;
+        int length;             // in milliseconds (-1 if unknown)
+        std::string title;      // track title (or recording title if not given)
+        std::string isrc;       // first ISRC of the recording
+        bool has_recording;
+        CreditVector artists;   // track artist credits
+        CreditVector recording_artists; // recording artist credits
+
+        Track() : position(-1), length(-1), has_recording(false) {}
+    };
+
+public:
+    Parser(CDbMusicBrainzElem &e) : elem(e), found(false), nlabels(0), nmedia(0),
+        medium_position(-1), medium_ntracks(-1), url_list(false), url_list_done(false), credits(NULL) {}
+
+protected:
+    virtual void StartElement_(const std::string &name);
+    virtual void EndElement_(const std::string &name, const std::string &text);
+    virtual void EndDocument_();
+
+private:
+    CDbMusicBrainzElem &elem;
+    bool found;             // release element found
+    int nlabels;            // number of label-info elements so far
+    int nmedia;             // number of medium elements so far
+    int medium_position;    // position of the current medium
+    int medium_ntracks;     // track count of the current medium
+    std::vector<Track> medium_tracks; // tracks of the current medium
+    bool url_list;          // in the (first) url relation-list
+    bool url_list_done;     // the url relation-list has been parsed
+    CreditVector *credits;  // artist credits being parsed (NULL if none)
+    std::string credits_path; // path of the artist-credit element being parsed
+    std::string url_type;   // type of the url relation being parsed
+
+    CreditVector release_artists;
+    std::vector<Track> tracks; // tracks of the disc
+    std::unordered_map<std::string,bool> composers; // <MBID, true if composer>
+
+    /**
+     * @brief Collect all the artists appear in the album and identify if they are a composer
+     */
+    void AnalyzeArtists_();
+
+    /**
+     * @brief Add the composer or non-composer credits to a range of the release record
+     */
+    void AddCredits_(const CreditVector &artist_credits, const bool reqcomposer, SDbRelease::SRange &range);
+
+    static int ToInt_(const std::string &text, const int defval);
+};
+
+static const string R = "/metadata/release";
+static const string LI = R+"/label-info-list/label-info";
+static const string M = R+"/medium-list/medium";
+static const string T = M+"/track-list/track";
+static const string REC = T+"/recording";
+
+int CDbMusicBrainzElem::Parser::ToInt_(const std::string &text, const int defval)
+{
+    try
+    {
+        size_t endpos;
+        int val = std::stoi(text, &endpos);
+        return (endpos==text.size()) ? val : defval;
+    }
+    catch(...) // conversion failed -> not an integer
+    {
+        return defval;
+    }
+}
+
+void CDbMusicBrainzElem::Parser::StartElement_(const std::string &name)
+{
+    const string &path = Path_();
+    string attr;
+
+    if (credits) // in an artist-credit
+    {
+        if (path.compare(credits_path.size(), string::npos, "/name-credit")==0)
+        {
+            credits->emplace_back();
+            Attribute_("joinphrase", credits->back().joinphrase);
+        }
+        else if (path.compare(credits_path.size(), string::npos, "/name-credit/artist")==0 && credits->size())
+        {
+            Attribute_("id", credits->back().id);
+        }
     }
+    else if (name.compare("artist-credit")==0)
+    {
+        string parent = path.substr(0, path.size()-name.size()-1);
+        if (parent==R) credits = &release_artists;
+        else if (parent==T && medium_tracks.size()) credits = &medium_tracks.back().artists;
+        else if (parent==REC && medium_tracks.size()) credits = &medium_tracks.back().recording_artists;
+        if (credits) credits_path = path;
+    }
+    else if (path==R)
+    {
+        found = true;
+        if (Attribute_("id", attr)) elem.release.id = elem.release.Intern(attr);
+    }
+    else if (path==T)
+    {
+        medium_tracks.emplace_back();
+    }
+    else if (path==REC)
+    {
+        if (medium_tracks.size()) medium_tracks.back().has_recording = true;
+    }
+    else if (path==REC+"/isrc-list/isrc")
+    {
+        if (medium_tracks.size() && medium_tracks.back().isrc.empty())
+            Attribute_("id", medium_tracks.back().isrc);
+    }
+    else if (path==M)
+    {
+        nmedia++;
+        medium_position = -1;
+        medium_ntracks = -1;
+        medium_tracks.clear();
+    }
+    else if (path==M+"/track-list")
+    {
+        if (Attribute_("count", attr)) medium_ntracks = ToInt_(attr, -1);
+    }
+    else if (path==R+"/medium-list")
+    {
+        if (Attribute_("count", attr)) elem.release.total_discs = ToInt_(attr, -1);
+    }
+    else if (path==LI)
+    {
+        nlabels++;
+    }
+    else if (path==R+"/release-group")
+    {
+        if (Attribute_("id", attr)) elem.release.group = elem.release.Intern(attr);
+    }
+    else if (path==R+"/relation-list")
+    {
+        // only the first list of url relations
+        url_list = !url_list_done && Attribute_("target-type", attr) && attr.compare("url")==0;
+    }
+    else if (url_list && path==R+"/relation-list/relation")
+    {
+        url_type.clear();
+        Attribute_("type", url_type);
+    }
+}
+
+void CDbMusicBrainzElem::Parser::EndElement_(const std::string &name, const std::string &text)
+{
+    const string &path = Path_();
+
+    if (credits)
+    {
+        if (path==credits_path) credits = NULL;
+        else if (path.compare(credits_path.size(), string::npos, "/name-credit/artist/name")==0 && credits->size())
+            credits->back().name = text;
+    }
+    else if (path.compare(0, T.size(), T)==0 && medium_tracks.size()) // in a track
+    {
+        Track &track = medium_tracks.back();
+        if (path==T+"/position") track.position = ToInt_(text, -1);
+        else if (path==T+"/title") track.title = text;
+        else if (path==T+"/length") track.length = ToInt_(text, -1);
+        else if (path==REC+"/title" && track.title.empty()) track.title = text;
+        else if (path==REC+"/length" && track.length<0) track.length = ToInt_(text, -1);
+    }
+    else if (path==M+"/position")
+    {
+        medium_position = ToInt_(text, -1);
+    }
+    else if (path==M)
+    {
+        // keep only the tracks of the disc
+        if (medium_position==elem.disc && tracks.empty())
+        {
+            tracks.swap(medium_tracks);
+            elem.total_tracks = medium_ntracks<0 ? tracks.size() : medium_ntracks;
+        }
+        medium_tracks.clear();
+    }
+    else if (path==R+"/medium-list")
+    {
+        if (elem.release.total_discs<0) elem.release.total_discs = nmedia;
+    }
+    else if (path==R+"/title") elem.release.title = elem.release.Intern(text);
+    else if (path==R+"/date") elem.release.date = elem.release.Intern(text);
+    else if (path==R+"/country") elem.release.country = elem.release.Intern(text);
+    else if (path==R+"/barcode") elem.release.barcode = elem.release.Intern(text);
+    else if (path==R+"/asin") elem.release.asin = elem.release.Intern(text);
+    else if (path==R+"/cover-art-archive/front") elem.front = text.compare("true")==0;
+    else if (path==R+"/cover-art-archive/back") elem.back = text.compare("true")==0;
+    else if (nlabels==1 && path==LI+"/catalog-number") elem.release.catno = elem.release.Intern(text);
+    else if (nlabels==1 && path==LI+"/label/name") elem.release.label = elem.release.Intern(text);
+    else if (url_list && path==R+"/relation-list/relation/target")
+    {
+        SDbRelease::SLink link = { elem.release.Intern(url_type), elem.release.Intern(text) };
+        elem.release.links.push_back(link);
+    }
+    else if (url_list && path==R+"/relation-list")
+    {
+        url_list = false;
+        url_list_done = true;
+    }
+}
+
+void CDbMusicBrainzElem::Parser::EndDocument_()
+{
+    if (!found)
+        throw(std::runtime_error("MusicBrainz release lookup resulted in an invalid result."));
+
+    SDbRelease &release = elem.release;
+    if (release.total_discs<0) release.total_discs = 1; // no medium-list
+
+    AnalyzeArtists_();
+
+    // move the credits & tracks into the release record
+    AddCredits_(release_artists, false, release.performers);
+    AddCredits_(release_artists, true, release.composers);
+
+    release.tracks.reserve(tracks.size());
+    for (std::vector<Track>::const_iterator it = tracks.begin(); it!=tracks.end(); it++)
+    {
+        const Track &track = *it;
+        release.tracks.emplace_back();
+        SDbRelease::STrack &rec = release.tracks.back();
+
+        rec.number = track.position;
+        rec.length = track.length;
+        rec.title = release.Intern(track.title);
+        rec.isrc = release.Intern(track.isrc);
+
+        // only if Recording artists are not available, use track artists
+        AddCredits_(track.has_recording ? track.recording_artists : track.artists, false, rec.performers);
+
+        AddCredits_(track.artists, true, rec.composers);
+        if (!rec.composers.count && track.has_recording)
+            AddCredits_(track.recording_artists, true, rec.composers);
+    }
+
+    release.Compact();
+}
+
+/**
+ * @brief Collect all the artists appear in the album and identify if they are a composer
+ */
+void CDbMusicBrainzElem::Parser::AnalyzeArtists_()
+{
+    std::vector<std::string> track_artists;
+    std::vector<std::string>::iterator it;
+    std::pair<std::unordered_map<std::string,bool>::iterator,bool> ret;
+    CreditVector::const_iterator credit;
+
+    // first look in album's artist-credit
+    for (credit = release_artists.begin(); credit!=release_artists.end(); credit++)
+    {
+        // Add ID to the artist map as non-composer
+        if ((*credit).id.size()) composers.emplace((*credit).id,false);
+    }
+
+    // now look in track & recording's artist-credits
+    for (std::vector<Track>::const_iterator track = tracks.begin(); track!=tracks.end(); track++)
+    {
+        // get track artists and temporarily store it in a vector
+        track_artists.clear();
+        for (credit = (*track).artists.begin(); credit!=(*track).artists.end(); credit++)
+        {
+            if ((*credit).id.size()) track_artists.push_back((*credit).id);
+        }
+
+        // now get the recording artists
+        if ((*track).has_recording)
+        {
+            for (credit = (*track).recording_artists.begin(); credit!=(*track).recording_artists.end(); credit++)
+            {
+                const std::string &id = (*credit).id;
+                if (id.empty()) continue;
+
+                // add the recording artist as non-composer
+                composers.emplace(id,false);
+
+                // check if track artist is also a recording artist -> non-composer
+                it = std::find(track_artists.begin(), track_artists.end(), id);
+                if (it!=track_artists.end()) track_artists.erase(it);
+            }
+
+            // remaining track artists are treated as composer
+            for (it=track_artists.begin(); it!=track_artists.end(); it++)
+            {
+                ret = composers.emplace(*it,true);
+                if (!ret.second) // data aready exists, mark it composer
+                    ret.first->second = true;
+            }
+        }
+        else // if no recording given, assume non-composer
+        {
+            for (it=track_artists.begin(); it!=track_artists.end(); it++)
+                composers.emplace(*it,false);
+        }
+    }
+}
+
+/**
+ * @brief Add the composer or non-composer credits to a range of the release record
+ */
+void CDbMusicBrainzElem::Parser::AddCredits_(const CreditVector &artist_credits, const bool reqcomposer, SDbRelease::SRange &range)
+{
+    for (CreditVector::const_iterator credit = artist_credits.begin(); credit!=artist_credits.end(); credit++)
+    {
+        if ((*credit).id.empty()) continue;
+
+        // check for composer/non-composer condition
+        if (composers.at((*credit).id)==reqcomposer)
+            elem.release.AddCredit(range, elem.release.Artist((*credit).id), (*credit).name, (*credit).joinphrase);
+    }
+}
+
+/**
+ * @brief Constructor
+ * @param[in] release lookup XML data (if empty, to be filled by NewParser())
+ * @param[in] disc number in the release
+ * @throw runtime_error if invalid XML string is passed in.
+ */
+CDbMusicBrainzElem::CDbMusicBrainzElem(const std::string &rawdata, const int d)
+    : disc(d), total_tracks(0), front(false), back(false)
+{
+    LoadData(rawdata);
+}
+
+/**
+ * @brief Create a streaming parser, which fills this object from the
+ *        release lookup XML data fed to it. The object is complete
+ *        after the parser's Finish() returns; it must not be moved or
+ *        destroyed while the parser is in use.
+ * @return new parser
+ */
+std::unique_ptr<CUtilXmlStream> CDbMusicBrainzElem::NewParser()
+{
+    // clear existing data
+    int d = disc;
+    ClearData();
+    disc = d;
+    release.total_discs = -1; // to be counted if medium-list lacks count
+
+    return std::unique_ptr<CUtilXmlStream>(new Parser(*this));
 }
 
 /**
@@ -38,9 +390,11 @@ CDbMusicBrainzElem::CDbMusicBrainzElem(const std::string &rawdata, const int d)
  */
 void CDbMusicBrainzElem::Swap(CDbMusicBrainzElem &other)
 {
-    CUtilXmlTree::Swap(other);
     std::swap(disc,other.disc);
-    artists.swap(other.artists);
+    release.Swap(other.release);
+    std::swap(total_tracks,other.total_tracks);
+    std::swap(front,other.front);
+    std::swap(back,other.back);
 }
 
 /**
@@ -50,27 +404,22 @@ void CDbMusicBrainzElem::Swap(CDbMusicBrainzElem &other)
  */
 void CDbMusicBrainzElem::LoadData(const std::string &rawdata)
 {
-    // call the base class function first
-    CUtilXmlTree::LoadData(rawdata);
-
-    // change the root to release element
-    if (root)
+    if (rawdata.size())
     {
-        if (!FindObject("release",root) && root)
-        throw(std::runtime_error("MusicBrainz release lookup resulted in an invalid result."));
-
-        AnalyzeArtists_();
-        artists_info_set = false;
+        std::unique_ptr<CUtilXmlStream> parser = NewParser();
+        parser->Parse(rawdata);
     }
 }
 
 /**
- * @brief Clear existing XML data
+ * @brief Clear existing release data
  */
 void CDbMusicBrainzElem::ClearData()
 {
     disc = 0;
-    artists.clear();
+    release.Clear();
+    total_tracks = 0;
+    front = back = false;
 }
 
 // -----------------------------------------------------------------------------------------
@@ -81,9 +430,7 @@ void CDbMusicBrainzElem::ClearData()
  */
 std::string CDbMusicBrainzElem::ReleaseId() const
 {
-    std::string rval;
-    FindElementAttribute(root,"id",rval);
-    return rval;
+    return release.String(release.id);
 }
 
 /** Get album title
@@ -92,9 +439,7 @@ std::string CDbMusicBrainzElem::ReleaseId() const
  */
 std::string CDbMusicBrainzElem::AlbumTitle() const
 {
-    std::string rval;
-    FindString("title",rval);
-    return rval;
+    return release.String(release.title);
 }
 
 /** Get album artist
@@ -103,7 +448,7 @@ std::string CDbMusicBrainzElem::AlbumTitle() const
  */
 SCueArtists CDbMusicBrainzElem::AlbumArtist() const
 {
-    return Artists_(root,false);
+    return release.Artists(release.performers);
 }
 
 /** Get album composer
@@ -112,7 +457,7 @@ SCueArtists CDbMusicBrainzElem::AlbumArtist() const
  */
 SCueArtists CDbMusicBrainzElem::AlbumComposer() const
 {
-    return Artists_(root,true);
+    return release.Artists(release.composers);
 }
 
 /** Get release date
@@ -121,9 +466,7 @@ SCueArtists CDbMusicBrainzElem::AlbumComposer() const
  */
 std::string CDbMusicBrainzElem::Date() const
 {
-    std::string str;
-    FindString("date",str);
-    return str;
+    return release.String(release.date);
 }
 
 /** Get release country
@@ -132,9 +475,7 @@ std::string CDbMusicBrainzElem::Date() const
  */
 std::string CDbMusicBrainzElem::Country() const
 {
-    std::string str;
-    FindString("country",str);
-    return str;
+    return release.String(release.country);
 }
 
 /**
@@ -152,11 +493,7 @@ int CDbMusicBrainzElem::DiscNumber() const
  */
 int CDbMusicBrainzElem::TotalDiscs() const
 {
-    int rval = 1;
-    const xmlNode *medium;
-    FindArray("medium-list", medium, &rval);
-
-    return rval;
+    return release.total_discs;
 }
 
 /** Get label name
@@ -165,14 +502,7 @@ int CDbMusicBrainzElem::TotalDiscs() const
  */
 std::string CDbMusicBrainzElem::AlbumLabel() const
 {
-    std::string rval;
-
-    const xmlNode *labelinfo, *label;
-    if (FindArray("label-info-list",labelinfo) && labelinfo
-            && FindObject(labelinfo,"label",label) && label)
-        FindString(label, "name",rval);
-
-    return rval;
+    return release.String(release.label);
 }
 
 /** Get catalog number
@@ -181,13 +511,7 @@ std::string CDbMusicBrainzElem::AlbumLabel() const
  */
 std::string CDbMusicBrainzElem::AlbumCatNo() const
 {
-    std::string rval;
-
-    const xmlNode *labelinfo;
-    if (FindArray("label-info-list",labelinfo) && labelinfo)
-        FindString(labelinfo, "catalog-number",rval);
-
-    return rval;
+    return release.String(release.catno);
 }
 
 /** Get album UPC
@@ -196,9 +520,7 @@ std::string CDbMusicBrainzElem::AlbumCatNo() const
  */
 std::string CDbMusicBrainzElem::AlbumUPC() const
 {
-    std::string str;
-    FindString("barcode",str);
-    return str;
+    return release.String(release.barcode);
 }
 
 /** Get Amazon Standard Identification Number
@@ -207,44 +529,26 @@ std::string CDbMusicBrainzElem::AlbumUPC() const
  */
 std::string CDbMusicBrainzElem::AlbumASIN() const
 {
-    std::string str;
-    FindString("asin",str);
-    return str;
+    return release.String(release.asin);
 }
 
 /**
- * @brief Find XML object for the medium associated with the CD
- * @return pointer to a medium XML object
+ * @brief Find the specified track
+ * @param[in] track number
+ * @return pointer to the track or NULL if not found
  */
-const xmlNode* CDbMusicBrainzElem::GetMedium_() const
+const SDbRelease::STrack* CDbMusicBrainzElem::GetTrack_(const size_t tracknum) const
 {
-    int pos;
-    const xmlNode *medium = NULL;
-    for(FindArray("medium-list",medium);
-        medium && FindInt(medium,"position",pos) && pos!=disc;
-        medium = medium->next);
-    return medium;
-}
+    const std::vector<SDbRelease::STrack> &tracks = release.tracks;
 
-/**
- * @brief Find JSON object for the specified track
- * @param[in] track number counting over multiple discs
- * @param[out] if not NULL and track is found in sub_tracks listing, returns its parent index track JSON object
- * @return pointer to a track JSON object
- */
-const xmlNode* CDbMusicBrainzElem::GetTrack_(const size_t tracknum) const
-{
-    const xmlNode *medium = GetMedium_();
-    const xmlNode *track = NULL;
-    if (medium && FindArray(medium,"track-list",track))
-    {
-        int pos;
-        while (track && FindInt(track,"position",pos) && pos!=(int)tracknum)
-            track = track->next;
-    }
-    return track;
-}
+    // tracks are usually in order
+    if (tracknum>0 && tracknum<=tracks.size() && tracks[tracknum-1].number==(int)tracknum)
+        return &tracks[tracknum-1];
 
+    for (std::vector<SDbRelease::STrack>::const_iterator it = tracks.begin(); it!=tracks.end(); it++)
+        if ((*it).number==(int)tracknum) return &*it;
+    return NULL;
+}
 
 /** Get number of tracks
  *
@@ -253,11 +557,7 @@ const xmlNode* CDbMusicBrainzElem::GetTrack_(const size_t tracknum) const
  */
 int CDbMusicBrainzElem::NumberOfTracks() const
 {
-    int rval;
-    const xmlNode* medium = GetMedium_();
-    const xmlNode *track;
-    if (medium) FindArray(medium,"track-list",track,&rval);
-    return rval;
+    return total_tracks;
 }
 
 /** @brief Get track title
@@ -280,15 +580,8 @@ int CDbMusicBrainzElem::NumberOfTracks() const
  */
 std::string CDbMusicBrainzElem::TrackTitle(int tracknum) const
 {
-    std::string rval;
-    const xmlNode *track = GetTrack_(tracknum);
-    const xmlNode *recording;
-
-    // look on the track first, if not found, check in its recording
-    if (track && !FindString(track,"title",rval) && FindObject(track,"recording",recording))
-        FindString(recording,"title",rval);
-
-    return rval;
+    const SDbRelease::STrack *track = GetTrack_(tracknum);
+    return track ? release.String(track->title) : std::string();
 }
 
 /** Get track artist
@@ -299,16 +592,8 @@ std::string CDbMusicBrainzElem::TrackTitle(int tracknum) const
  */
 SCueArtists CDbMusicBrainzElem::TrackArtist(int tracknum) const
 {
-    SCueArtists rval;
-    const xmlNode *track = GetTrack_(tracknum);
-    const xmlNode *recording;
-
-    if (FindObject(track,"recording",recording))
-        rval = Artists_(recording, false);
-    else    // only if Recording artists are not available, look up track artists
-        rval = Artists_(track,false);
-
-    return rval;
+    const SDbRelease::STrack *track = GetTrack_(tracknum);
+    return track ? release.Artists(track->performers) : SCueArtists();
 }
 
 /** Get track composer
@@ -319,16 +604,8 @@ SCueArtists CDbMusicBrainzElem::TrackArtist(int tracknum) const
  */
 SCueArtists CDbMusicBrainzElem::TrackComposer(int tracknum) const
 {
-    SCueArtists rval;
-
-    const xmlNode *track = GetTrack_(tracknum);
-    const xmlNode *recording;
-
-    rval = Artists_(track,true);
-    if (rval.empty() && FindObject(track,"recording",recording))
-        rval = Artists_(recording, true);
-
-    return rval;
+    const SDbRelease::STrack *track = GetTrack_(tracknum);
+    return track ? release.Artists(track->composers) : SCueArtists();
 }
 
 /** Get track ISRC
@@ -339,15 +616,8 @@ SCueArtists CDbMusicBrainzElem::TrackComposer(int tracknum) const
  */
 std::string CDbMusicBrainzElem::TrackISRC(int tracknum) const
 {
-    std::string rval;
-    const xmlNode *recording, *isrc;
-    const xmlNode *track = GetTrack_(tracknum);
-
-    if (track && FindObject(track,"recording",recording) &&
-            FindArray(recording,"isrc-list",isrc) && isrc)
-        FindElementAttribute(isrc,"id",rval);
-
-    return rval;
+    const SDbRelease::STrack *track = GetTrack_(tracknum);
+    return track ? release.String(track->isrc) : std::string();
 }
 
 /** Get a vector of track lengths
@@ -359,26 +629,20 @@ std::string CDbMusicBrainzElem::TrackISRC(int tracknum) const
  */
 std::vector<int> CDbMusicBrainzElem::TrackLengths() const
 {
-    std::vector<int> tracklengths;
-
-    const xmlNode *medium;
-    const xmlNode *track = NULL;
-    int len, pos, count;
-
-    medium = GetMedium_();
-    if (!FindArray(medium, "track-list", track, &count))
+    const std::vector<SDbRelease::STrack> &tracks = release.tracks;
+    if (tracks.empty())
         throw(std::runtime_error("Failed to obtain the track list."));
 
-    // preallocate the vector to the expected size
-    tracklengths.reserve(count);
-
-    for (; track; track = track->next)
+    std::vector<int> tracklengths(tracks.size());
+    for (size_t i = 0; i<tracks.size(); i++)
     {
-        if (!FindInt(track,"lnegth",len))
+        const SDbRelease::STrack &track = tracks[i];
+        if (track.length<0)
             throw(std::runtime_error("Failed to obtain a track length."));
 
-        if (FindInt(track,"position",pos)) tracklengths[pos-1] = len;
-        else tracklengths.push_back(len);
+        // place by position if valid, MusicBrainz length in milliseconds
+        size_t pos = (track.number>0 && track.number<=(int)tracks.size()) ? track.number-1 : i;
+        tracklengths[pos] = (track.length+500)/1000;
     }
 
     return tracklengths;
@@ -391,29 +655,7 @@ std::vector<int> CDbMusicBrainzElem::TrackLengths() const
  */
 std::string CDbMusicBrainzElem::RelationUrl(const std::string &type) const
 {
-    std::string rval;
-    bool relation_notfound=true, target_notfound = true;
-    const xmlNode *list, *relation;
-    std::string target;
-
-    // look through all relation
-    if (FindObject("relation-list", list))
-    {
-        do
-        {
-            if (FindElementAttribute(list,"target-type",target) && target.compare("url")==0)
-            {
-                relation_notfound = false;
-                for (relation = list->children;
-                     relation && (target_notfound = CompareElementAttribute(relation,"type",type)!=0);
-                     relation = relation->next);
-
-                if (!target_notfound) FindString(relation,"target",rval);
-            }
-        } while (relation_notfound && FindNextElement(list, "relation-list", list));
-    }
-
-    return rval;
+    return release.Link(type);
 }
 
 /**
@@ -422,10 +664,7 @@ std::string CDbMusicBrainzElem::RelationUrl(const std::string &type) const
  */
 std::string CDbMusicBrainzElem::ReleaseGroupId() const
 {
-    std::string rval;
-    const xmlNode *rgroup;
-    FindObject("release-group", rgroup, &rval);
-    return rval;
+    return release.String(release.group);
 }
 
 //-----------------------------------------------------------------------------
@@ -436,12 +675,7 @@ std::string CDbMusicBrainzElem::ReleaseGroupId() const
  */
 bool CDbMusicBrainzElem::Front() const
 {
-    bool rval = false;
-    const xmlNode *node;
-    int val;
-    if (FindObject("cover-art-archive",node) && FindInt(node,"front",val))
-        rval = val;
-    return rval;
+    return front;
 }
 
 /** Check if the query returned a back cover
@@ -450,183 +684,11 @@ bool CDbMusicBrainzElem::Front() const
  */
 bool CDbMusicBrainzElem::Back() const
 {
-    bool rval = false;
-    const xmlNode *node;
-    int val;
-
-    if (FindObject("cover-art-archive",node) && FindInt(node,"back",val))
-        rval = val;
-    return rval;
+    return back;
 }
 
 //-----------------------------------------------------------------------------
 
-/**
- * @brief Generate artist map to identify if they are composer
- */
-void CDbMusicBrainzElem::AnalyzeArtists_()
-{
-    std::string id;
-    const xmlNode *medium, *track, *recording, *credit, *dummy;
-    std::vector<std::string> track_artists;
-    std::vector<std::string>::iterator it;
-    std::pair<ArtistMap::iterator,bool> ret;
-
-    // first look in album's artist-credit
-    for (FindArray("artist-credit",credit); credit; credit = credit->next)
-    {
-        // Add ID to the artist map as non-composer
-        if (FindObject(credit, "artist", dummy, &id))
-            artists.emplace(id,false);
-    }
-
-    // now look in track & recording's artist-credits
-    medium = GetMedium_();
-    for (FindArray(medium,"track-list",track); track; track=track->next)
-    {
-        // get track artists and temporarily store it in a vector
-        track_artists.clear();
-        for (FindArray(track, "artist-credit", credit); credit; credit=credit->next)
-        {
-            // Add ID to the artist map as non-composer
-            if (FindObject(credit, "artist", dummy, &id))
-                track_artists.push_back(id);
-        }
-
-        // now get the recording artists
-        if (FindObject(track,"recording",recording))
-        {
-            for (FindArray(recording,"artist-credit", credit); credit; credit = credit->next)
-            {
-                if (FindObject(credit, "artist", dummy, &id))
-                {
-                    // add the recording artist as non-composer
-                    artists.emplace(id,false);
-
-                    // check if track artist is also a recording artist
-                    bool iscomposer = true;
-                    for (it=track_artists.begin(); iscomposer && it!=track_artists.end(); it++)
-                    {
-                        if (id.compare(*it)==0) // match found -> non-composer
-                        {
-                            // remove from track list
-                            track_artists.erase(it);
-                            iscomposer = false;
-                        }
-                    }
-                }
-            }
-
-            // remaining track artists are treated as composer
-            for (it=track_artists.begin(); it!=track_artists.end(); it++)
-            {
-                ret = artists.emplace(*it,true);
-                if (!ret.second) // data aready exists, mark it composer
-                    ret.first->second.iscomposer = true;
-            }
-        }
-        else // if no recording given, assume non-composer
-        {
-            for (it=track_artists.begin(); it!=track_artists.end(); it++)
-                artists.emplace(id,false);
-        }
-    }
-}
-
-SCueArtists CDbMusicBrainzElem::Artists_(const xmlNode *node, const bool reqcomposer) const // maybe release or track json_t
-{
-    SCueArtists rval;
-    std::string name, joinstr, id;
-
-    const xmlNode *credit, *artist;
-    bool iscomposer;
-
-    // first look in album's artist-credit
-    for (FindArray(node, "artist-credit", credit); credit; credit = credit->next)
-    {
-        // Add ID to the artist map as non-composer
-        if (FindObject(credit, "artist", artist, &id))
-        {
-            // check for composer/non-composer condition
-            ArtistInfo info = artists.at(id);
-            iscomposer = info.iscomposer; // composer
-            if (((iscomposer && reqcomposer) || (!(iscomposer || reqcomposer)))) // get the name
-            {
-                // if there is a joining string carried over from the previous artist, add now
-                if (joinstr.size()) rval.back().joiner = joinstr;
-
-                // if locale-specific name has been aquired, use it
-                if (artists_info_set) name = info.name; // locale-specific name given
-                else name.clear(); // use the artist's native name
-
-                if (name.size() || FindString(artist, "name", name))
-                {
-                    rval.emplace_back();
-                    rval.back().name = name;
-                    rval.back().type = info.type;
-                }
-
-                // save its joining string for the next artist
-                FindElementAttribute(credit,"joinphrase",joinstr);
-            }
-        }
-    }
-
-    return rval;
-}
-
-bool CDbMusicBrainzElem::FindObject(const xmlNode *parent, const std::string &name, const xmlNode *&node, std::string *id)
-{
-    // find a node with requested name
-    bool rval = FindElement(parent, name, node);
-
-    // if found and its ID URI is requested, try retrieving it (returns "" if does not exist)
-    if (rval && id) FindElementAttribute(node, "id", *id);
-
-    return rval;
-}
-
-bool CDbMusicBrainzElem::FindArray(const xmlNode *parent, const std::string &name, const xmlNode *&node, int *count, int *offset)
-{
-    // find a node with requested name
-    bool rval = CUtilXmlTree::FindArray(parent, name, node, NULL);
-
-    if (rval && (count||offset))   // found && array size requested
-    {
-
-        const xmlNode *array = node->parent;
-        std::string attr_val;
-
-        if (count)
-        {
-            FindElementAttribute(array, "count", attr_val);
-            try
-            {
-                *count = std::stoi(attr_val);
-            }
-            catch(...)  // if attribute does not exist or not integer, count the # of children
-            {
-                *count = xmlChildElementCount(const_cast<xmlNode*>(array));
-            }
-        }
-
-        if (offset)
-        {
-            FindElementAttribute(array, "offset", attr_val);
-            try
-            {
-                *offset = std::stoi(attr_val);
-            }
-            catch(...)  // if attribute does not exist or not integer, count the # of children
-            {
-                *offset = -1; // unknown
-            }
-        }
-    }
-
-    return rval;
-}
-
 /**
  * @brief Returns a pre-populated unordered map<id string, name string> with IDs filled
  * @return the map to be filled
@@ -635,11 +697,11 @@ CDbMusicBrainzElem::ArtistDbInfoVector CDbMusicBrainzElem::GetArtistDbInfo()
 {
     CDbMusicBrainzElem::ArtistDbInfoVector rval;
 
-    rval.reserve(artists.size());
-    for (ArtistMap::iterator it = artists.begin(); it != artists.end(); it++)
+    rval.reserve(release.artists.size());
+    for (std::vector<SDbRelease::SArtist>::iterator it = release.artists.begin(); it != release.artists.end(); it++)
     {
         rval.emplace_back();
-        rval.back().id = it->first;
+        rval.back().id = release.String(it->id);
     }
 
     return rval;
@@ -651,16 +713,14 @@ CDbMusicBrainzElem::ArtistDbInfoVector CDbMusicBrainzElem::GetArtistDbInfo()
  */
 void CDbMusicBrainzElem::SetArtistDbInfo(const CDbMusicBrainzElem::ArtistDbInfoVector &info)
 {
-    artists_info_set = true;
-
-    ArtistMap::iterator dst;
+    SDbRelease::SArtist *dst;
     for (ArtistDbInfoVector::const_iterator it = info.begin(); it != info.end(); it++)
     {
-        dst = artists.find(it->id);
-        if (dst!=artists.end())
+        dst = release.FindArtist(it->id);
+        if (dst)
         {
-            dst->second.name = it->name;
-            dst->second.type = it->type;
+            dst->name = release.Intern(it->name);
+            dst->type = it->type;
         }
     }
 }
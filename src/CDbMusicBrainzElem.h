@@ -1,36 +1,50 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
 #include <string>
+#include <memory>
 
-#include "CUtilXmlTree.h"
+#include "CUtilXmlStream.h"
 #include "SCueArtist.h"
+#include "SDbRelease.h"
 
 class CDbMusicBrainz;
 
-class CDbMusicBrainzElem : protected CUtilXmlTree
+/** MusicBrainz release record
+ *
+ *  CDbMusicBrainzElem holds only the fields of a release lookup response
+ *  (musicbrainz_mmd-2.0.rng) it reports, extracted by a streaming XML
+ *  parser into a compact SDbRelease record, and only the tracks of its
+ *  disc. The response can be parsed as it is downloaded (see NewParser()),
+ *  or from a string.
+ */
+class CDbMusicBrainzElem
 {
     struct ArtistDbInfo : SCueArtistNoJoiner { std::string id; };
     typedef std::vector<ArtistDbInfo> ArtistDbInfoVector;
 
-    struct ArtistInfo: SCueArtistNoJoiner
-    {
-        bool iscomposer;
-
-        ArtistInfo(bool iniscomposer=false,
-                   const std::string &inname="",
-                   const SCueArtistType intype=SCueArtistType::UNKNOWN) :
-            SCueArtistNoJoiner(inname,intype), iscomposer(iniscomposer) {}
-    };
-    typedef std::unordered_map<std::string,CDbMusicBrainzElem::ArtistInfo> ArtistMap; // <MBID, false-artist/performer, true-composer>
-    typedef std::pair<std::string,CDbMusicBrainzElem::ArtistInfo> ArtistPair; // <MBID, false-artist/performer, true-composer>
+    class Parser;
 
     friend class CDbMusicBrainz;
 public:
+    /**
+     * @brief Constructor
+     * @param[in] release lookup XML data (if empty, to be filled by NewParser())
+     * @param[in] disc number in the release
+     * @throw runtime_error if invalid XML string is passed in.
+     */
     CDbMusicBrainzElem(const std::string &data, const int disc=1);
     virtual ~CDbMusicBrainzElem() {}
 
+    /**
+     * @brief Create a streaming parser, which fills this object from the
+     *        release lookup XML data fed to it. The object is complete
+     *        after the parser's Finish() returns; it must not be moved or
+     *        destroyed while the parser is in use.
+     * @return new parser
+     */
+    std::unique_ptr<CUtilXmlStream> NewParser();
+
     /**
      * @brief Exchanges the content with another CDbMusicBrainzElem object
      * @param Another CDbMusicBrainzElem object
@@ -45,7 +59,7 @@ public:
     virtual void LoadData(const std::string &data);
 
     /**
-     * @brief Clear existing XML data
+     * @brief Clear existing release data
      */
     virtual void ClearData();
 
@@ -228,36 +242,16 @@ public:
      */
     void SetArtistDbInfo(const CDbMusicBrainzElem::ArtistDbInfoVector &info);
 
-protected:
-
-    bool FindObject(const std::string &key, const xmlNode *&node, std::string *id=nullptr) const { return FindObject(root, key, node, id); }
-    bool FindArray(const std::string &key, const xmlNode *&firstchild, int *count=nullptr, int *offset=nullptr) const { return FindArray(root, key, firstchild, count, offset); }
-    static bool FindObject(const xmlNode *parent, const std::string &key, const xmlNode *&node, std::string *id=nullptr);
-    static bool FindArray(const xmlNode *parent, const std::string &key, const xmlNode *&firstchild, int *count=nullptr, int *offset=nullptr);
-
 private:
     int disc; // in the case of multi-disc set, indicate the disc # (zero-based)
-    ArtistMap artists; // <MBID Artist Info + iscomposer bool>
-    bool artists_info_set;    // true if artist_aliases filled
-
-    /**
-     * @brief Collect all the artists appear in the album and identify if they are a composer
-     */
-    void AnalyzeArtists_();
+    SDbRelease release; // release data with the tracks of the disc
+    int total_tracks;       // number of tracks of the disc
+    bool front, back;       // cover art archive flags
 
     /**
-     * @brief Find XML object for the medium associated with the CD
-     * @return pointer to a medium XML object
+     * @brief Find the specified track
+     * @param[in] track number
+     * @return pointer to the track or NULL if not found
      */
-    const xmlNode* GetMedium_() const;
-
-    /**
-     * @brief Find JSON object for the specified track
-     * @param[in] track number counting over multiple discs
-     * @param[out] if not nullptr and track is found in sub_tracks listing, returns its parent index track JSON object
-     * @return pointer to a track JSON object
-     */
-    const xmlNode* GetTrack_(const size_t tracknum) const;
-
-    SCueArtists Artists_(const xmlNode *node, const bool reqcomposer) const; // maybe release or track or recording
+    const SDbRelease::STrack* GetTrack_(const size_t tracknum) const;
 };
@@ -0,0 +1,517 @@
+#include "CDbMusicBrainzIndex.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "utils.h"
+
+using std::string;
+using std::runtime_error;
+using std::mutex;
+using std::lock_guard;
+
+#define INDEX_MAGIC "MBIX"
+#define INDEX_VERSION 2
+#define INDEX_MIN_BUCKETS 4096
+
+struct CDbMusicBrainzIndex::SHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t nbuckets;  // number of hash buckets (power of 2)
+    uint64_t nentries;  // number of occupied buckets
+    uint64_t end;       // end of the used space (next record offset)
+};
+
+struct CDbMusicBrainzIndex::SBucket
+{
+    uint64_t hash;      // key hash
+    uint64_t offset;    // record offset (0 if empty)
+};
+
+// record: u32 keylen, u32 nreleases, key, then per release
+//         {u32 disc, u32 idlen, u32 datalen, u32 artistslen, id, data, artists}
+
+static void put_u32_(string &s, const uint32_t v)
+{
+    s.append((const char*)&v, sizeof(v));
+}
+
+static uint32_t get_u32_(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+/**
+ * @brief Constructor. Opens (or creates) the index file.
+ * @param[in] index file path
+ * @throw runtime_error if failed to open or invalid file
+ */
+CDbMusicBrainzIndex::CDbMusicBrainzIndex(const std::string &p)
+    : path(p), fd(-1), fd_lock(-1), map(NULL), mapsize(0)
+{
+    // lock a file of its own, as Rebuild_() replaces the index file
+    fd_lock = open((path+".lck").c_str(), O_RDWR|O_CREAT, 0644);
+    if (fd_lock<0)
+        throw(runtime_error("Could not open the MusicBrainz index file."));
+
+    try
+    {
+        SFileLock flck(fd_lock, LOCK_EX);
+        Open_();
+    }
+    catch (...)
+    {
+        close(fd_lock);
+        throw;
+    }
+}
+
+CDbMusicBrainzIndex::~CDbMusicBrainzIndex()
+{
+    {
+        SFileLock flck(fd_lock, LOCK_EX);
+        try
+        {
+            Sync_();
+
+            // drop the slack space left by the last growth
+            uint64_t end = Header_().end;
+            munmap(map, mapsize);
+            map = NULL;
+            if (ftruncate(fd, end)) {}
+        }
+        catch (...)
+        {
+        }
+        if (map) munmap(map, mapsize);
+        if (fd>=0) close(fd);
+    }
+    close(fd_lock);
+}
+
+CDbMusicBrainzIndex::SHeader &CDbMusicBrainzIndex::Header_() const
+{
+    return *(SHeader*)map;
+}
+
+CDbMusicBrainzIndex::SBucket *CDbMusicBrainzIndex::Buckets_() const
+{
+    return (SBucket*)(map+sizeof(SHeader));
+}
+
+/**
+ * @brief Look up a disc
+ * @param[in] disc key (MusicBrainz disc ID)
+ * @param[out] releases of the disc
+ * @return true if found
+ */
+bool CDbMusicBrainzIndex::Lookup(const std::string &key, SMusicBrainzIndexReleases &releases)
+{
+    lock_guard<mutex> lck(mutex_index);
+    SFileLock flck(fd_lock, ReadLock_());
+    Sync_();
+
+    // a bucket updated without its record reaching the disk (e.g., crash)
+    // may point to garbage: treat a bad record as a miss
+    const SBucket &bucket = FindBucket_(key, Hash_(key));
+    if (!bucket.offset || !RecordSize_(bucket.offset)) return false;
+
+    const unsigned char *p = map+bucket.offset;
+    uint32_t keylen = get_u32_(p);
+    uint32_t nreleases = get_u32_(p+4);
+    p += 8+keylen;
+
+    releases.clear();
+    releases.reserve(nreleases);
+    for (uint32_t i = 0; i<nreleases; i++)
+    {
+        uint32_t disc = get_u32_(p);
+        uint32_t idlen = get_u32_(p+4);
+        uint32_t datalen = get_u32_(p+8);
+        uint32_t artistslen = get_u32_(p+12);
+        p += 16;
+        releases.emplace_back(string((const char*)p, idlen), disc,
+                              string((const char*)p+idlen, datalen),
+                              string((const char*)p+idlen+datalen, artistslen));
+        p += idlen+datalen+artistslen;
+    }
+    return true;
+}
+
+/**
+ * @brief Add or replace a disc
+ * @param[in] disc key (MusicBrainz disc ID)
+ * @param[in] releases of the disc
+ * @throw runtime_error if failed to write the index file
+ */
+void CDbMusicBrainzIndex::Insert(const std::string &key, const SMusicBrainzIndexReleases &releases)
+{
+    lock_guard<mutex> lck(mutex_index);
+    SFileLock flck(fd_lock, LOCK_EX);
+    Sync_();
+
+    uint64_t hash = Hash_(key);
+    uint64_t offset = Append_(Encode_(key, releases)); // may remap
+
+    SBucket &bucket = FindBucket_(key, hash);
+    if (!bucket.offset) Header_().nentries++;
+    bucket.hash = hash;
+    bucket.offset = offset;
+
+    // keep the load factor at or below 50%
+    if (2*Header_().nentries>Header_().nbuckets)
+        Rebuild_(2*Header_().nbuckets);
+}
+
+/**
+ * @brief Bulk-load discs from a tab-separated text file, of which each
+ *        line lists a disc key, a release MBID, and (optionally) the
+ *        disc number in the release. Lines of the same key are
+ *        combined, and replace the existing entry.
+ * @param[in] text file path
+ * @return number of discs loaded
+ * @throw runtime_error if failed to read the file or to write the index
+ */
+size_t CDbMusicBrainzIndex::Import(const std::string &tsvpath)
+{
+    std::ifstream is(tsvpath.c_str());
+    if (!is)
+        throw(runtime_error("Could not open the MusicBrainz index import file."));
+
+    std::map<string, SMusicBrainzIndexReleases> discs;
+    string line;
+    while (std::getline(is, line))
+    {
+        std::istringstream ls(line);
+        string key, id;
+        int disc = 1;
+        if (!std::getline(ls, key, '\t') || !std::getline(ls, id, '\t')) continue;
+        if (key.empty() || id.empty()) continue;
+        if (!(ls >> disc) || disc<1) disc = 1;
+
+        discs[key].emplace_back(id, disc);
+    }
+    if (is.bad())
+        throw(runtime_error("Failed to read the MusicBrainz index import file."));
+
+    // size the hash table once for the whole load
+    {
+        lock_guard<mutex> lck(mutex_index);
+        SFileLock flck(fd_lock, LOCK_EX);
+        Sync_();
+        uint64_t nbuckets = Header_().nbuckets;
+        while (nbuckets<2*(Header_().nentries+discs.size())) nbuckets *= 2;
+        if (nbuckets!=Header_().nbuckets) Rebuild_(nbuckets);
+    }
+
+    for (std::map<string, SMusicBrainzIndexReleases>::iterator it = discs.begin(); it!=discs.end(); it++)
+        Insert((*it).first, (*it).second);
+
+    return discs.size();
+}
+
+/**
+ * @brief Get the number of discs in the index
+ * @return number of discs
+ */
+size_t CDbMusicBrainzIndex::NumberOfEntries()
+{
+    lock_guard<mutex> lck(mutex_index);
+    SFileLock flck(fd_lock, ReadLock_());
+    Sync_();
+    return Header_().nentries;
+}
+
+void CDbMusicBrainzIndex::Map_(const size_t size)
+{
+    if (map) munmap(map, mapsize);
+    map = NULL;
+    mapsize = 0;
+
+    void *p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p==MAP_FAILED)
+        throw(runtime_error("Could not map the MusicBrainz index file."));
+
+    map = (unsigned char*)p;
+    mapsize = size;
+}
+
+void CDbMusicBrainzIndex::Open_()
+{
+    fd = open(path.c_str(), O_RDWR|O_CREAT, 0644);
+    if (fd<0)
+        throw(runtime_error("Could not open the MusicBrainz index file."));
+
+    struct stat st;
+    if (fstat(fd, &st))
+    {
+        close(fd);
+        fd = -1;
+        throw(runtime_error("Could not open the MusicBrainz index file."));
+    }
+
+    try
+    {
+        if (st.st_size==0)
+        {
+            Create_(INDEX_MIN_BUCKETS);
+        }
+        else
+        {
+            if ((size_t)st.st_size<sizeof(SHeader))
+                throw(runtime_error("Invalid MusicBrainz index file."));
+            Map_(st.st_size);
+
+            // start an index of an older format over (records are not converted)
+            if (!memcmp(Header_().magic, INDEX_MAGIC, 4) && Header_().version<INDEX_VERSION)
+            {
+                if (ftruncate(fd, 0))
+                    throw(runtime_error("Failed to write the MusicBrainz index file."));
+                Create_(INDEX_MIN_BUCKETS);
+                return;
+            }
+
+            // the number of buckets must be a power of 2 for the hash mask
+            const SHeader &hdr = Header_();
+            if (memcmp(hdr.magic, INDEX_MAGIC, 4) || hdr.version!=INDEX_VERSION
+                    || !hdr.nbuckets || (hdr.nbuckets&(hdr.nbuckets-1))
+                    || hdr.nbuckets>(uint64_t)st.st_size/sizeof(SBucket)
+                    || hdr.nentries>=hdr.nbuckets
+                    || sizeof(SHeader)+hdr.nbuckets*sizeof(SBucket)>hdr.end
+                    || hdr.end>(uint64_t)st.st_size)
+                throw(runtime_error("Invalid MusicBrainz index file."));
+        }
+    }
+    catch (...)
+    {
+        if (map) munmap(map, mapsize);
+        map = NULL;
+        mapsize = 0;
+        close(fd);
+        fd = -1;
+        throw;
+    }
+}
+
+void CDbMusicBrainzIndex::Sync_()
+{
+    // reopen a file rebuilt by another process
+    if (fd<0 || file_replaced(path, fd))
+    {
+        if (map) munmap(map, mapsize);
+        map = NULL;
+        mapsize = 0;
+        if (fd>=0) close(fd);
+        fd = -1;
+        Open_();
+        return;
+    }
+
+    // remap a file grown (or trimmed) by another process
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size<sizeof(SHeader))
+        throw(runtime_error("Invalid MusicBrainz index file."));
+    if ((size_t)st.st_size!=mapsize) Map_(st.st_size);
+}
+
+int CDbMusicBrainzIndex::ReadLock_() const
+{
+    // a replaced file is reopened, which may create it
+    return file_replaced(path, fd) ? LOCK_EX : LOCK_SH;
+}
+
+void CDbMusicBrainzIndex::Create_(const uint64_t nbuckets)
+{
+    size_t size = sizeof(SHeader)+nbuckets*sizeof(SBucket);
+    if (ftruncate(fd, size)) // zero-filled, i.e., all buckets empty
+        throw(runtime_error("Failed to write the MusicBrainz index file."));
+    Map_(size);
+
+    SHeader &hdr = Header_();
+    memcpy(hdr.magic, INDEX_MAGIC, 4);
+    hdr.version = INDEX_VERSION;
+    hdr.nbuckets = nbuckets;
+    hdr.nentries = 0;
+    hdr.end = size;
+}
+
+CDbMusicBrainzIndex::SBucket &CDbMusicBrainzIndex::FindBucket_(const std::string &key, const uint64_t hash) const
+{
+    SBucket *buckets = Buckets_();
+    uint64_t mask = Header_().nbuckets-1;
+    for (uint64_t i = hash&mask;; i = (i+1)&mask) // never full (load <= 50%)
+    {
+        SBucket &bucket = buckets[i];
+        if (!bucket.offset || (bucket.hash==hash && MatchKey_(bucket.offset, key)))
+            return bucket;
+    }
+}
+
+bool CDbMusicBrainzIndex::MatchKey_(const uint64_t offset, const std::string &key) const
+{
+    const SHeader &hdr = Header_();
+    if (offset<sizeof(SHeader)+hdr.nbuckets*sizeof(SBucket) || offset>hdr.end
+            || hdr.end-offset<8+key.size())
+        return false;
+
+    const unsigned char *p = map+offset;
+    return get_u32_(p)==key.size() && !memcmp(p+8, key.data(), key.size());
+}
+
+uint64_t CDbMusicBrainzIndex::RecordSize_(const uint64_t offset) const
+{
+    const SHeader &hdr = Header_();
+    if (offset<sizeof(SHeader)+hdr.nbuckets*sizeof(SBucket) || offset>hdr.end
+            || hdr.end-offset<8)
+        return 0;
+
+    // every length must stay within the used space
+    const unsigned char *p = map+offset;
+    uint64_t avail = hdr.end-offset;
+    uint64_t len = 8+(uint64_t)get_u32_(p);
+    for (uint32_t n = get_u32_(p+4); n; n--)
+    {
+        if (len+16>avail) return 0;
+        len += 16+(uint64_t)get_u32_(p+len+4)+get_u32_(p+len+8)+get_u32_(p+len+12);
+    }
+    return len<=avail ? len : 0;
+}
+
+uint64_t CDbMusicBrainzIndex::Append_(const std::string &record)
+{
+    uint64_t offset = Header_().end;
+    uint64_t end = offset+record.size();
+
+    // grow the file by at least 1/8 at a time to limit the remaps
+    if (end>mapsize)
+    {
+        size_t size = std::max((size_t)end, mapsize+mapsize/8);
+        if (ftruncate(fd, size))
+            throw(runtime_error("Failed to write the MusicBrainz index file."));
+        Map_(size);
+    }
+
+    memcpy(map+offset, record.data(), record.size());
+    Header_().end = end;
+    return offset;
+}
+
+void CDbMusicBrainzIndex::Rebuild_(const uint64_t nbuckets)
+{
+    // copy the live records to a new file next to the current one
+    string tmppath = path+".tmp";
+    int newfd = open(tmppath.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if (newfd<0)
+        throw(runtime_error("Failed to write the MusicBrainz index file."));
+
+    int oldfd = fd;
+    unsigned char *oldmap = map;
+    size_t oldmapsize = mapsize;
+    const SBucket *oldbuckets = Buckets_();
+    uint64_t oldnbuckets = Header_().nbuckets;
+
+    // sizes of the live records (0 to drop a bad one)
+    std::vector<uint64_t> sizes(oldnbuckets, 0);
+    uint64_t total = 0;
+    for (uint64_t i = 0; i<oldnbuckets; i++)
+        if (oldbuckets[i].offset) total += sizes[i] = RecordSize_(oldbuckets[i].offset);
+
+    fd = newfd;
+    map = NULL;
+    mapsize = 0;
+    try
+    {
+        Create_(nbuckets);
+
+        // reserve the space for all the records at once
+        if (ftruncate(fd, Header_().end+total))
+            throw(runtime_error("Failed to write the MusicBrainz index file."));
+        Map_(Header_().end+total);
+
+        SBucket *buckets = Buckets_();
+        uint64_t mask = nbuckets-1;
+        for (uint64_t i = 0; i<oldnbuckets; i++)
+        {
+            const SBucket &old = oldbuckets[i];
+            uint64_t len = sizes[i];
+            if (!len) continue;
+
+            const unsigned char *p = oldmap+old.offset;
+
+            uint64_t offset = Header_().end;
+            memcpy(map+offset, p, len);
+            Header_().end += len;
+
+            // keys are unique, so only need to find an empty bucket
+            uint64_t j = old.hash&mask;
+            while (buckets[j].offset) j = (j+1)&mask;
+            buckets[j] = old;
+            buckets[j].offset = offset;
+            Header_().nentries++;
+        }
+
+        if (msync(map, mapsize, MS_SYNC) || rename(tmppath.c_str(), path.c_str()))
+            throw(runtime_error("Failed to write the MusicBrainz index file."));
+    }
+    catch (...)
+    {
+        // restore the current file
+        if (map) munmap(map, mapsize);
+        close(fd);
+        unlink(tmppath.c_str());
+        fd = oldfd;
+        map = oldmap;
+        mapsize = oldmapsize;
+        throw;
+    }
+
+    munmap(oldmap, oldmapsize);
+    close(oldfd);
+}
+
+std::string CDbMusicBrainzIndex::Encode_(const std::string &key, const SMusicBrainzIndexReleases &releases)
+{
+    string record;
+    put_u32_(record, key.size());
+    put_u32_(record, releases.size());
+    record += key;
+    for (SMusicBrainzIndexReleases::const_iterator it = releases.begin(); it!=releases.end(); it++)
+    {
+        put_u32_(record, (*it).disc);
+        put_u32_(record, (*it).id.size());
+        put_u32_(record, (*it).data.size());
+        put_u32_(record, (*it).artists.size());
+        record += (*it).id;
+        record += (*it).data;
+        record += (*it).artists;
+    }
+    return record;
+}
+
+uint64_t CDbMusicBrainzIndex::Hash_(const std::string &key)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (string::const_iterator it = key.begin(); it!=key.end(); it++)
+    {
+        h ^= (unsigned char)*it;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * @brief Release found in CDbMusicBrainzIndex
+ */
+struct SMusicBrainzIndexRelease
+{
+    std::string id;     // release MBID
+    int disc;           // disc number in the release
+    std::string data;   // release lookup XML document (empty if not known)
+    std::string artists; // resolved artist names, as encoded by the user (empty if not known)
+
+    SMusicBrainzIndexRelease(const std::string &i="", const int d=1, const std::string &x="",
+                             const std::string &a="")
+        : id(i), disc(d), data(x), artists(a) {}
+};
+typedef std::vector<SMusicBrainzIndexRelease> SMusicBrainzIndexReleases;
+
+/**
+ * @brief Offline index of MusicBrainz disc lookups
+ *
+ * CDbMusicBrainzIndex maps a disc key (MusicBrainz disc ID) to the releases
+ * of the disc, with their release lookup documents & artist names when
+ * known, so a known disc can be resolved without any network access. The index is populated
+ * by CDbMusicBrainz after each online lookup, or bulk-loaded with Import()
+ * from a list extracted from a MusicBrainz data dump (release documents
+ * are then retrieved online on first use).
+ *
+ * The index is a single file, memory-mapped for the lookups:
+ *
+ *   header  - magic, version, number of buckets & entries, used size
+ *   buckets - open-addressing hash table (linear probing) of
+ *             {key hash, record offset}; offset 0 marks an empty bucket
+ *   records - appended {key, releases} records
+ *
+ * Replacing an entry appends a new record; the space of the old record is
+ * reclaimed when the hash table is grown (at 50% load), which rewrites the
+ * file with the live records only.
+ *
+ * All member functions are thread-safe, and the file may be shared by
+ * several processes: the lookups hold a shared flock() on "<path>.lck", the
+ * updates an exclusive one, and each remaps (or reopens) the file when
+ * another process grew (or rebuilt) it.
+ */
+class CDbMusicBrainzIndex
+{
+public:
+    /**
+     * @brief Constructor. Opens (or creates) the index file.
+     * @param[in] index file path
+     * @throw runtime_error if failed to open or invalid file
+     */
+    CDbMusicBrainzIndex(const std::string &path);
+    virtual ~CDbMusicBrainzIndex();
+
+    /**
+     * @brief Look up a disc
+     * @param[in] disc key (MusicBrainz disc ID)
+     * @param[out] releases of the disc
+     * @return true if found
+     */
+    bool Lookup(const std::string &key, SMusicBrainzIndexReleases &releases);
+
+    /**
+     * @brief Add or replace a disc
+     * @param[in] disc key (MusicBrainz disc ID)
+     * @param[in] releases of the disc
+     * @throw runtime_error if failed to write the index file
+     */
+    void Insert(const std::string &key, const SMusicBrainzIndexReleases &releases);
+
+    /**
+     * @brief Bulk-load discs from a tab-separated text file, of which each
+     *        line lists a disc key, a release MBID, and (optionally) the
+     *        disc number in the release. Lines of the same key are
+     *        combined, and replace the existing entry.
+     * @param[in] text file path
+     * @return number of discs loaded
+     * @throw runtime_error if failed to read the file or to write the index
+     */
+    size_t Import(const std::string &path);
+
+    /**
+     * @brief Get the number of discs in the index
+     * @return number of discs
+     */
+    size_t NumberOfEntries();
+
+private:
+    struct SHeader;
+    struct SBucket;
+
+    std::mutex mutex_index;
+    std::string path;
+    int fd;
+    int fd_lock;        // lock file, as the index file is replaced by Rebuild_()
+    unsigned char *map; // mapped file
+    size_t mapsize;     // mapped size
+
+    SHeader &Header_() const;
+    SBucket *Buckets_() const;
+
+    /**
+     * @brief (Re)map the file with at least the given size
+     */
+    void Map_(const size_t size);
+
+    /**
+     * @brief Open & map the index file, creating it if empty (or of an
+     *        older format). The exclusive lock must be held to create.
+     */
+    void Open_();
+
+    /**
+     * @brief Catch up with the changes of other processes: reopen the file
+     *        if replaced, remap it if resized. A lock must be held.
+     */
+    void Sync_();
+
+    /**
+     * @brief Get the flock() operation for a read: shared, unless the file
+     *        is to be reopened
+     */
+    int ReadLock_() const;
+
+    /**
+     * @brief Create an empty index file
+     */
+    void Create_(const uint64_t nbuckets);
+
+    /**
+     * @brief Find the bucket of a key (or the empty bucket to put the key)
+     */
+    SBucket &FindBucket_(const std::string &key, const uint64_t hash) const;
+
+    /**
+     * @brief Compare the key of a record
+     */
+    bool MatchKey_(const uint64_t offset, const std::string &key) const;
+
+    /**
+     * @brief Get the size of a record, checking all its lengths against the
+     *        used space of the file
+     * @return record size in bytes, or 0 if the record is not valid
+     */
+    uint64_t RecordSize_(const uint64_t offset) const;
+
+    /**
+     * @brief Append a record, returns its offset
+     */
+    uint64_t Append_(const std::string &record);
+
+    /**
+     * @brief Rewrite the file with a larger hash table, dropping dead records
+     */
+    void Rebuild_(const uint64_t nbuckets);
+
+    static std::string Encode_(const std::string &key, const SMusicBrainzIndexReleases &releases);
+    static uint64_t Hash_(const std::string &key);
+};
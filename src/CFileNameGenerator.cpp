@@ -1,6 +1,7 @@
 #include "CFileNameGenerator.h"
 
 #include <algorithm>
+#include <stdexcept>
 #include <ctype.h>
 #include <boost/regex.hpp>
 #include <boost/regex/icu.hpp>
@@ -25,7 +26,28 @@ CFileNameGenerator::CFileNameGenerator(const std::string &base,
 std::string CFileNameGenerator::operator()(const SCueSheet &cuesheet) const
 {
     // add the extension
-    ParserOutput result = parser(cuesheet,0,"");
+    ParserOutput result = parser(cuesheet,nullptr,0,"");
+
+    std::string rval(basepath);
+    rval += result.str + to_ext(fmt);
+
+    return rval;
+}
+
+/**
+ * @brief generate a file name of a track from a cuesheet object
+ * @param[in] populated cuesheet
+ * @param[in] track number (1-based index of cuesheet.Tracks)
+ * @return generated file name string
+ * @throw std::out_of_range if invalid track number
+ */
+std::string CFileNameGenerator::operator()(const SCueSheet &cuesheet, const size_t track) const
+{
+    if (!track || track>cuesheet.Tracks.size())
+        throw(std::out_of_range("Invalid track number."));
+
+    // add the extension
+    ParserOutput result = parser(cuesheet,&cuesheet.Tracks[track-1],0,"");
 
     std::string rval(basepath);
     rval += result.str + to_ext(fmt);
@@ -42,6 +64,7 @@ std::string CFileNameGenerator::operator()(const SCueSheet &cuesheet) const
  */
 CFileNameGenerator::ParserOutput
 CFileNameGenerator::parser(const SCueSheet &cuesheet,
+                           const SCueTrack *track,
                            size_t pos0,
                            const std::string &termch) const
 {
@@ -68,7 +91,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
         {
         case '[': // conditional section
             // parse the conditional section
-            subexpr = parser(cuesheet,pos0,"]");
+            subexpr = parser(cuesheet,track,pos0,"]");
             if (subexpr.end==scheme.npos)
                 throw(std::invalid_argument("Invalid Filename Scheme: Closing bracket of a conditional section not found."));
 
@@ -112,13 +135,28 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                 // convert metadata aliases to cuesheet field names
                 if (word.compare("DISCNUMBER")==0) word = "DISC";
                 else if (word.compare("TOTALDISC")==0) word = "DISCS";
-                else if (word.compare("ALBUM")==0) word = "TITLE";
+                else if (word.compare("TRACK")==0) word = "TRACKNUMBER";
+                else if (word.compare("TOTALTRACK")==0) word = "TOTALTRACKS";
 
                 // get the cuesheet field values
-                if (word.compare("TITLE")==0)
+                if (word.compare("ALBUM")==0 || (!track && word.compare("TITLE")==0))
                 {
                     rval.str += cuesheet.Title;
                 }
+                else if (track && word.compare("TITLE")==0)
+                {
+                    rval.str += track->Title;
+                }
+                else if (track && word.compare("TRACKNUMBER")==0)
+                {
+                    // zero-padded to 2 digits
+                    if (track->number<10) rval.str += '0';
+                    rval.str += std::to_string(track->number);
+                }
+                else if (track && word.compare("TOTALTRACKS")==0)
+                {
+                    rval.str += std::to_string(cuesheet.Tracks.size());
+                }
                 else
                 {
                     // check for artist/performer/songwriter
@@ -128,9 +166,18 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                             || (iscomp=(word.compare(0,10,"SONGWRITER")==0)))
                     {
                         // get the artist name vector
+                        // (track's own artists take precedence in track mode)
                         SCueArtists names;
-                        if (isart||isperf) names = cuesheet.Performer;
-                        if (iscomp||(isart&&names.empty())) names = cuesheet.Songwriter;
+                        if (isart||isperf)
+                        {
+                            if (track) names = track->Performer;
+                            if (names.empty()) names = cuesheet.Performer;
+                        }
+                        if (iscomp||(isart&&names.empty()))
+                        {
+                            if (track) names = track->Songwriter;
+                            if (names.empty()) names = cuesheet.Songwriter;
+                        }
 
                         // get the artist option(s)
                         bool firstonly=false, lastname=false, firstinitial=false;
@@ -189,7 +236,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                     bool iftf;
 
                     // parse the conditional section
-                    subexpr = parser(cuesheet,pos+1,",");
+                    subexpr = parser(cuesheet,track,pos+1,",");
                     if (subexpr.end==scheme.npos)
                         throw(std::invalid_argument("Invalid Filename Scheme: IF COND not closed."));
                     iftf = subexpr.tf;
@@ -198,7 +245,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                     pos0 = subexpr.end + 1;
 
                     // get then clause
-                    subexpr = parser(cuesheet,pos0,",)");
+                    subexpr = parser(cuesheet,track,pos0,",)");
                     if (subexpr.end==scheme.npos)
                         throw(std::invalid_argument("Invalid Filename Scheme: IF THEN not closed."));
 
@@ -212,7 +259,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                     // if ELSE clause is available, process it
                     if (scheme[subexpr.end]==',') // else clause exists
                     {
-                        subexpr = parser(cuesheet,subexpr.end+1,")");
+                        subexpr = parser(cuesheet,track,subexpr.end+1,")");
                         if (subexpr.end==scheme.npos)
                             throw(std::invalid_argument("Invalid Filename Scheme: IF ELSE not closed."));
 
@@ -238,7 +285,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                     while (scheme[subexpr.end]!=')')
                     {
                         // parse the conditional section
-                        subexpr = parser(cuesheet,subexpr.end+1,",)");
+                        subexpr = parser(cuesheet,track,subexpr.end+1,",)");
                         if (subexpr.end==scheme.npos)
                             throw(std::invalid_argument("Invalid Filename Scheme: IF2/IF3 not closed."));
 
@@ -276,7 +323,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                     while (scheme[subexpr.end]!=')')
                     {
                         // parse the conditional section
-                        subexpr = parser(cuesheet,subexpr.end+1,",)");
+                        subexpr = parser(cuesheet,track,subexpr.end+1,",)");
                         if (subexpr.end==scheme.npos)
                             throw(std::invalid_argument("Invalid Filename Scheme: AND not closed."));
 
@@ -300,7 +347,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                     while (scheme[subexpr.end]!=')')
                     {
                         // parse the conditional section
-                        subexpr = parser(cuesheet,subexpr.end+1,",)");
+                        subexpr = parser(cuesheet,track,subexpr.end+1,",)");
                         if (subexpr.end==scheme.npos)
                             throw(std::invalid_argument("Invalid Filename Scheme: OR not closed."));
 
@@ -317,7 +364,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                         throw(std::invalid_argument("Invalid Filename Scheme: OR must have at least one argument."));
 
                     // parse the conditional section
-                    subexpr = parser(cuesheet,pos,")");
+                    subexpr = parser(cuesheet,track,pos,")");
                     if (subexpr.end==scheme.npos)
                         throw(std::invalid_argument("Invalid Filename Scheme: NOT is not properly closed."));
 
@@ -338,7 +385,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                     while (scheme[subexpr.end]!=')')
                     {
                         // parse the conditional section
-                        subexpr = parser(cuesheet,subexpr.end+1,",)");
+                        subexpr = parser(cuesheet,track,subexpr.end+1,",)");
                         if (subexpr.end==scheme.npos)
                             throw(std::invalid_argument("Invalid Filename Scheme: XOR not closed."));
 
@@ -361,12 +408,12 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                         throw(std::invalid_argument("Invalid Filename Scheme: STRCMP must have two arguments."));
 
                     // parse the first string
-                    subexpr = parser(cuesheet,pos,",");
+                    subexpr = parser(cuesheet,track,pos,",");
                     if (subexpr.end==scheme.npos)
                         throw(std::invalid_argument("Invalid Filename Scheme: STRCMP must have two arguments."));
 
                     // parse the second string
-                    subexpr2 = parser(cuesheet,subexpr.end+1,")");
+                    subexpr2 = parser(cuesheet,track,subexpr.end+1,")");
                     if (scheme[subexpr.end==scheme.npos]==')')
                         throw(std::invalid_argument("Invalid Filename Scheme: STRCMP must have two arguments."));
 
@@ -394,7 +441,7 @@ CFileNameGenerator::parser(const SCueSheet &cuesheet,
                         throw(std::invalid_argument("Invalid Filename Scheme: CAPS must have two arguments."));
 
                     // parse the conditional section
-                    subexpr = parser(cuesheet,pos,")");
+                    subexpr = parser(cuesheet,track,pos,")");
                     if (subexpr.end==scheme.npos)
                         throw(std::invalid_argument("Invalid Filename Scheme: CAPS must have two arguments."));
 
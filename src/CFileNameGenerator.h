@@ -21,7 +21,8 @@
  *
  * - %artist%
  *      Name of the artist of the album. Checks following metadata fields, in this order:
- *      "performer", "songwriter".
+ *      "performer", "songwriter". For a track file name, the track's artists are used
+ *      if available.
  * - %performer%
  *      Name of the performing artist of the album
  * - %songwriter%
@@ -33,6 +34,12 @@
  *      person and group names
  * - %album%
  *      Name of the album.
+ * - %title%
+ *      Name of the album, or of the track if generating a track file name.
+ * - %tracknumber%, %track%
+ *      Track number, zero-padded to 2 digits (track file names only)
+ * - %totaltracks%
+ *      Number of tracks on the disc (track file names only)
  * - %discnumber%, %disc%
  *      Index of disc. Available only when "discnumber"/"disc" field is present in track’s metadata.
  * - %totaldiscs%, %discs%
@@ -81,6 +88,15 @@ public:
      */
     std::string operator()(const SCueSheet &cuesheet) const;
 
+    /**
+     * @brief generate a file name of a track from a cuesheet object
+     * @param[in] populated cuesheet
+     * @param[in] track number (1-based index of cuesheet.Tracks)
+     * @return generated file name string
+     * @throw std::out_of_range if invalid track number
+     */
+    std::string operator()(const SCueSheet &cuesheet, const size_t track) const;
+
     /**
      * @brief Test the current configuration with a test cuesheet
      * @return generated file name string
@@ -101,11 +117,12 @@ private:
     /**
      * @brief (recursive) working function for operator()
      * @param[in] populated cuesheet
+     * @param[in] track to name (nullptr to name the album)
      * @param[in] starting position of scheme string
      * @param[in] a list of terminating characters
      * @return generated file name string
      */
-    ParserOutput parser(const SCueSheet &cuesheet, size_t pos0,
+    ParserOutput parser(const SCueSheet &cuesheet, const SCueTrack *track, size_t pos0,
                         const std::string &termch) const;
 
     /**
@@ -0,0 +1,144 @@
+#include "CSectorRingBuffer.h"
+
+#include <stdexcept>
+
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+using std::invalid_argument;
+
+/**
+ * @brief CSectorRingBuffer constructor
+ * @param[in] number of slots in the ring
+ * @param[in] number of 16-bit samples per slot
+ * @param[in] number of readers sharing the slots (default: 1)
+ * @throw std::invalid_argument if any argument is zero
+ */
+CSectorRingBuffer::CSectorRingBuffer(const size_t n, const size_t sz, const size_t nr)
+    : nslots(n), slotsize(sz), nreaders(nr), nwritten(0), nread(0), closed(false), aborted(false)
+{
+    if (!nslots || !slotsize || !nreaders)
+        throw(invalid_argument("CSectorRingBuffer requires non-zero number of slots, slot size, and number of readers."));
+
+    data.resize(nslots*slotsize);
+    lengths.resize(nslots,0);
+    refcounts.resize(nslots,0);
+    readcounts.resize(nreaders,0);
+}
+
+/**
+ * @brief CSectorRingBuffer destructor
+ */
+CSectorRingBuffer::~CSectorRingBuffer() {}
+
+/**
+ * @brief Get the next free slot. Blocks the calling thread while the
+ *        ring is full.
+ * @return pointer to the slot buffer or NULL if the ring has been aborted
+ */
+int16_t* CSectorRingBuffer::BeginWrite()
+{
+    unique_lock<mutex> lck(mutex_ring);
+
+    // wait till there is a free slot
+    while (!aborted && nwritten-nread==nslots) cv_notfull.wait(lck);
+
+    if (aborted) return NULL;
+    return data.data() + (nwritten%nslots)*slotsize;
+}
+
+/**
+ * @brief Publish the slot obtained by the last BeginWrite() call
+ * @param[in] number of samples written to the slot (<= GetSlotSize())
+ */
+void CSectorRingBuffer::EndWrite(const size_t nsamples)
+{
+    lock_guard<mutex> lck(mutex_ring);
+
+    size_t i = nwritten%nslots;
+    lengths[i] = nsamples;
+    refcounts[i] = nreaders;
+    nwritten++;
+    cv_notempty.notify_all();
+}
+
+/**
+ * @brief Signal the consumers that no more slot will be written
+ */
+void CSectorRingBuffer::Close()
+{
+    lock_guard<mutex> lck(mutex_ring);
+    closed = true;
+    cv_notempty.notify_all();
+}
+
+/**
+ * @brief Get the oldest slot not yet read by the reader. Blocks the
+ *        calling thread while there is none.
+ * @param[out] number of samples in the slot
+ * @param[in] reader index (0 to GetNumberOfReaders()-1)
+ * @return pointer to the slot buffer or NULL if the ring has been closed
+ *         and drained, or aborted.
+ */
+const int16_t* CSectorRingBuffer::BeginRead(size_t &nsamples, const size_t reader)
+{
+    unique_lock<mutex> lck(mutex_ring);
+
+    size_t &count = readcounts.at(reader);
+
+    // wait till there is a slot the reader has not seen
+    while (!aborted && !closed && nwritten==count) cv_notempty.wait(lck);
+
+    if (aborted || nwritten==count)
+    {
+        nsamples = 0;
+        return NULL;
+    }
+
+    size_t i = count%nslots;
+    nsamples = lengths[i];
+    return data.data() + i*slotsize;
+}
+
+/**
+ * @brief Release the slot obtained by the last BeginRead() call
+ * @param[in] reader index (0 to GetNumberOfReaders()-1)
+ */
+void CSectorRingBuffer::EndRead(const size_t reader)
+{
+    lock_guard<mutex> lck(mutex_ring);
+
+    size_t &count = readcounts.at(reader);
+    refcounts[count%nslots]--;
+    count++;
+
+    // hand back the oldest slots released by every reader
+    bool released = false;
+    while (nread<nwritten && !refcounts[nread%nslots])
+    {
+        nread++;
+        released = true;
+    }
+    if (released) cv_notfull.notify_one();
+}
+
+/**
+ * @brief Abort the data flow, unblocking both producer and consumer
+ */
+void CSectorRingBuffer::Abort()
+{
+    lock_guard<mutex> lck(mutex_ring);
+    aborted = true;
+    cv_notfull.notify_all();
+    cv_notempty.notify_all();
+}
+
+/**
+ * @brief Returns true if Abort() has been called
+ * @return true if aborted
+ */
+bool CSectorRingBuffer::Aborted()
+{
+    lock_guard<mutex> lck(mutex_ring);
+    return aborted;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @brief Bounded, preallocated ring of CD audio sector buffers
+ *
+ * CSectorRingBuffer decouples a producer thread (reading sectors off the
+ * drive) from one or more consumer threads (feeding the sinks). The ring
+ * holds a fixed number of slots, each large enough to store slotsize 16-bit
+ * samples. All the slots are allocated at construction, so no memory is
+ * allocated while ripping.
+ *
+ * Each published slot is shared by all the consumers (readers) without
+ * copying. A slot is reference-counted and is only handed back to the
+ * producer after every reader has released it, so the slowest reader sets
+ * the pace once the ring is full.
+ *
+ * Producer:
+ *   BeginWrite() - blocks while the ring is full and returns the next free
+ *                  slot (or NULL if aborted)
+ *   EndWrite()   - publishes the slot with the number of samples filled
+ *   Close()      - signals that no more data will be written
+ *
+ * Consumer (identified by its reader index):
+ *   BeginRead()  - blocks while there is no unread slot for the reader and
+ *                  returns the oldest unread slot (or NULL once closed and
+ *                  drained, or aborted)
+ *   EndRead()    - releases the reader's reference to the slot
+ *
+ * Abort() may be called from either side to wake up and release both.
+ */
+class CSectorRingBuffer
+{
+public:
+    /**
+     * @brief CSectorRingBuffer constructor
+     * @param[in] number of slots in the ring
+     * @param[in] number of 16-bit samples per slot
+     * @param[in] number of readers sharing the slots (default: 1)
+     * @throw std::invalid_argument if any argument is zero
+     */
+    CSectorRingBuffer(const size_t nslots, const size_t slotsize, const size_t nreaders=1);
+
+    /**
+     * @brief CSectorRingBuffer destructor
+     */
+    virtual ~CSectorRingBuffer();
+
+    /**
+     * @brief Get the slot size
+     * @return Number of 16-bit samples each slot can hold
+     */
+    size_t GetSlotSize() const { return slotsize; }
+
+    /**
+     * @brief Get the number of readers
+     * @return Number of readers sharing the slots
+     */
+    size_t GetNumberOfReaders() const { return nreaders; }
+
+    /**
+     * @brief Get the next free slot. Blocks the calling thread while the
+     *        ring is full.
+     * @return pointer to the slot buffer or NULL if the ring has been aborted
+     */
+    int16_t* BeginWrite();
+
+    /**
+     * @brief Publish the slot obtained by the last BeginWrite() call
+     * @param[in] number of samples written to the slot (<= GetSlotSize())
+     */
+    void EndWrite(const size_t nsamples);
+
+    /**
+     * @brief Signal the consumers that no more slot will be written
+     */
+    void Close();
+
+    /**
+     * @brief Get the oldest slot not yet read by the reader. Blocks the
+     *        calling thread while there is none.
+     * @param[out] number of samples in the slot
+     * @param[in] reader index (0 to GetNumberOfReaders()-1)
+     * @return pointer to the slot buffer or NULL if the ring has been closed
+     *         and drained, or aborted. The buffer content is valid until
+     *         the subsequent EndRead() call.
+     */
+    const int16_t* BeginRead(size_t &nsamples, const size_t reader=0);
+
+    /**
+     * @brief Release the slot obtained by the last BeginRead() call
+     * @param[in] reader index (0 to GetNumberOfReaders()-1)
+     */
+    void EndRead(const size_t reader=0);
+
+    /**
+     * @brief Abort the data flow, unblocking both producer and consumer
+     */
+    void Abort();
+
+    /**
+     * @brief Returns true if Abort() has been called
+     * @return true if aborted
+     */
+    bool Aborted();
+
+private:
+    const size_t nslots;    // number of slots
+    const size_t slotsize;  // number of samples per slot
+    const size_t nreaders;  // number of readers
+
+    std::vector<int16_t> data;      // nslots*slotsize samples
+    std::vector<size_t> lengths;    // number of valid samples in each slot
+    std::vector<size_t> refcounts;  // number of readers yet to release each slot
+    std::vector<size_t> readcounts; // total number of slots released by each reader
+
+    size_t nwritten; // total number of slots published
+    size_t nread;    // total number of slots released by all readers
+
+    bool closed;     // true if producer is done
+    bool aborted;    // true if aborted
+
+    std::mutex mutex_ring;               // protects the counters & flags
+    std::condition_variable cv_notfull;  // signaled when a slot is released
+    std::condition_variable cv_notempty; // signaled when a slot is published
+};
@@ -2,6 +2,13 @@
 
 #include <stdexcept>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 using std::string;
 using std::runtime_error;
@@ -9,51 +16,319 @@ using std::mutex;
 using std::lock_guard;
 using std::unique_lock;
 
-CSinkBase::CSinkBase(const std::string &path) : lock_sign(0), nbytes_total(0)
+/* O_DIRECT alignment requirement (conservative) */
+#define DIRECT_ALIGN 4096
+
+#define IS_ALIGNED_(x) (((uintptr_t)(x))%DIRECT_ALIGN==0)
+
+CSinkBase::CSinkBase(const std::string &outpath, const size_t bufsize, const bool usedirect)
+    : lock_sign(0), path(outpath), fd(-1), direct(false), wbuf(NULL), wlen(0), pos(0), fsize(0),
+      preallocated(false), eof(false), nbytes_total(0)
 {
-	file = fopen(path.c_str(), "w+b");
-	if (!file) throw(runtime_error("Could not open the output file."));
+    // round the buffer size up to the alignment
+    wbufsize = ((bufsize ? bufsize : 1)+DIRECT_ALIGN-1)/DIRECT_ALIGN*DIRECT_ALIGN;
+
+    void *p;
+    if (posix_memalign(&p, DIRECT_ALIGN, wbufsize))
+        throw(runtime_error("Could not allocate the output file buffer."));
+    wbuf = (unsigned char*)p;
+
+    // try O_DIRECT first if requested, fall back to cached I/O if not supported
+    int flags = O_RDWR|O_CREAT|O_TRUNC;
+#ifdef O_DIRECT
+    if (usedirect)
+    {
+        fd = open(path.c_str(), flags|O_DIRECT, 0644);
+        direct = fd>=0;
+    }
+#endif
+    if (fd<0) fd = open(path.c_str(), flags, 0644);
+
+    if (fd<0)
+    {
+        free(wbuf);
+        throw(runtime_error("Could not open the output file."));
+    }
 }
 
+CSinkBase::CSinkBase()
+    : lock_sign(0), fd(-1), direct(false), wbuf(NULL), wbufsize(0), wlen(0), pos(0), fsize(0),
+      preallocated(false), eof(false), nbytes_total(0)
+{}
+
 CSinkBase::~CSinkBase()
 {
-	if (file) fclose(file);
+    if (fd>=0)
+    {
+        try
+        {
+            FlushFile_();
+        }
+        catch (...) {} // nothing can be done
+
+        // drop the unused preallocated space
+        if (preallocated && ftruncate(fd, fsize)) {}
+
+        close(fd);
+    }
+    free(wbuf);
+}
+
+/**
+ * @brief Preallocate the output file to hold nsamples of 16-bit audio.
+ * @param Total number of samples to be written
+ */
+void CSinkBase::Reserve(const size_t nsamples)
+{
+    PreallocateFile_(nsamples*sizeof(int16_t));
+}
+
+void CSinkBase::PreallocateFile_(const size_t nbytes)
+{
+    if (fd<0 || !nbytes) return;
+
+    // not all file systems support it; if not, let the file grow as written
+    if (!posix_fallocate(fd, 0, nbytes)) preallocated = true;
+}
+
+/**
+ * @brief Set the final path of the output file, to which CommitFile_()
+ *        renames the file
+ * @param[in] final path (copied over if on another file system)
+ */
+void CSinkBase::SetFinalPath(const std::string &dest)
+{
+    lock_guard<mutex> lck(mutex_file);
+    finalpath = dest;
+}
+
+void CSinkBase::CommitFile_()
+{
+    string dest;
+    {
+        lock_guard<mutex> lck(mutex_file);
+        dest.swap(finalpath);
+    }
+    if (fd<0 || dest.empty()) return;
+
+    // complete the file before it appears under the final path
+    FlushFile_();
+    if (preallocated)
+    {
+        if (ftruncate(fd, fsize)) {}
+        preallocated = false;
+    }
+    if (fsync(fd))
+        throw(runtime_error("Failed to write to the output file."));
+
+    if (!rename(path.c_str(), dest.c_str())) path = dest;
+    else if (errno==EXDEV) CopyFile_(dest);
+    else throw(runtime_error(string("Failed to rename the output file: ") + strerror(errno)));
+}
+
+void CSinkBase::CopyFile_(const std::string &dest)
+{
+    // copy to a temporary file next to dest so that dest appears complete
+    string tmppath = dest + ".part";
+    int fd_dest = open(tmppath.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if (fd_dest<0)
+        throw(runtime_error(string("Failed to copy the output file: ") + strerror(errno)));
+
+    if (direct) SetDirect_(false);
+    direct = false;
+
+    unsigned char buf[65536];
+    off_t off = 0;
+    bool ok = true;
+    while (ok && off<fsize)
+    {
+        ssize_t n = pread(fd, buf, std::min<off_t>(sizeof(buf), fsize-off), off);
+        if (n<0 && errno==EINTR) continue;
+        if (!n) errno = EIO; // file shorter than written
+        if (n<=0) { ok = false; break; }
+
+        for (ssize_t done = 0; done<n; )
+        {
+            ssize_t bcount = pwrite(fd_dest, buf+done, n-done, off+done);
+            if (bcount<0 && errno==EINTR) continue;
+            if (bcount<0) { ok = false; break; }
+            done += bcount;
+        }
+        off += n;
+    }
+    if (ok) ok = !fsync(fd_dest) && !rename(tmppath.c_str(), dest.c_str());
+
+    if (!ok)
+    {
+        int err = errno;
+        close(fd_dest);
+        std::remove(tmppath.c_str());
+        throw(runtime_error(string("Failed to copy the output file: ") + strerror(err)));
+    }
+
+    // continue on the copy & drop the original
+    close(fd);
+    std::remove(path.c_str());
+    fd = fd_dest;
+    path = dest;
+}
+
+void CSinkBase::SetDirect_(const bool enable)
+{
+#ifdef O_DIRECT
+    int flags = fcntl(fd, F_GETFL);
+    if (flags<0) return;
+    fcntl(fd, F_SETFL, enable ? (flags|O_DIRECT) : (flags&~O_DIRECT));
+#endif
+}
+
+void CSinkBase::WriteAt_(const void *buf, const size_t N, const off_t offset)
+{
+    // O_DIRECT only for aligned transfers
+    bool unaligned = direct && !(IS_ALIGNED_(buf) && IS_ALIGNED_(N) && IS_ALIGNED_(offset));
+    if (unaligned) SetDirect_(false);
+
+    const unsigned char *p = (const unsigned char *)buf;
+    size_t n = N;
+    off_t off = offset;
+    while (n)
+    {
+        ssize_t bcount = pwrite(fd, p, n, off);
+        if (bcount<0)
+        {
+            if (errno==EINTR) continue;
+            if (unaligned) SetDirect_(true);
+            throw(runtime_error("Failed to write to the output file."));
+        }
+        p += bcount;
+        n -= bcount;
+        off += bcount;
+    }
+
+    if (unaligned) SetDirect_(true);
+
+    lock_guard<mutex> lck(mutex_file);
+    if (off>fsize) fsize = off;
+}
+
+size_t CSinkBase::WriteFileAt_(const void *buf, const size_t N, const size_t offset)
+{
+    // toggling O_DIRECT per write is not thread-safe; use cached I/O from now on
+    {
+        lock_guard<mutex> lck(mutex_file);
+        if (direct)
+        {
+            SetDirect_(false);
+            direct = false;
+        }
+    }
+
+    WriteAt_(buf, N, offset);
+    return N;
+}
+
+size_t CSinkBase::GetFileSize_()
+{
+    lock_guard<mutex> lck(mutex_file);
+    return fsize;
+}
+
+void CSinkBase::FlushFile_()
+{
+    if (!wlen) return;
+
+    // reset first so a failed write is not retried by the destructor
+    size_t n = wlen;
+    wlen = 0;
+    WriteAt_(wbuf, n, pos-n);
 }
 
 void CSinkBase::SeekFile_( const long int offset, const int origin )
 {
+    // write out the buffered data
+    FlushFile_();
+
 	// adjust file position
-	if (fseek(file,offset,origin))
+    off_t newpos;
+    switch (origin)
+    {
+    case SEEK_SET: newpos = offset; break;
+    case SEEK_CUR: newpos = pos+offset; break;
+    case SEEK_END: newpos = fsize+offset; break;
+    default: newpos = -1;
+    }
+    if (newpos<0)
 		throw(runtime_error("Failed to seek the output file."));
-		
+
+    pos = newpos;
+    eof = false;
+
 	// adjust the # of bytes written
-	nbytes_total = ftell(file);
+	nbytes_total = pos;
 }
 
 size_t CSinkBase::ReadFile_(void* buf, const size_t N)
 {
-	size_t bcount = (size_t) fread((unsigned char *)buf, 1, N, file);
-	if (!bcount && ferror(file))
+    // write out the buffered data
+    FlushFile_();
+
+    bool unaligned = direct && !(IS_ALIGNED_(buf) && IS_ALIGNED_(N) && IS_ALIGNED_(pos));
+    if (unaligned) SetDirect_(false);
+
+    ssize_t bcount;
+    do bcount = pread(fd, buf, N, pos);
+    while (bcount<0 && errno==EINTR);
+
+    if (unaligned) SetDirect_(true);
+
+	if (bcount<0)
 		throw(runtime_error("Failed to read the output file."));
-	
+
+    // do not read into the preallocated space
+    if (pos+bcount>fsize) bcount = fsize>pos ? fsize-pos : 0;
+
+    pos += bcount;
+    eof = (size_t)bcount<N;
 	return bcount;
 }
 
 size_t CSinkBase::WriteFile_(const void *buf, const size_t N)
 {
-	// write data
-	size_t bcount = (size_t) fwrite((unsigned char*)buf, 1, N, file);
-	if (!bcount && ferror(file))
-		throw(runtime_error("Failed to write to the output file."));
-		
+    const unsigned char *p = (const unsigned char *)buf;
+    size_t n = N;
+
+    // large block with empty buffer: write directly (no copy) unless O_DIRECT
+    // requires alignment the caller's buffer does not have
+    if (!wlen && n>=wbufsize && !(direct && !IS_ALIGNED_(p)))
+    {
+        size_t m = n - n%DIRECT_ALIGN;
+        WriteAt_(p, m, pos);
+        pos += m;
+        p += m;
+        n -= m;
+    }
+
+    // copy the rest to the buffer, flushing as it fills up
+    while (n)
+    {
+        size_t m = std::min(n, wbufsize-wlen);
+        memcpy(wbuf+wlen, p, m);
+        wlen += m;
+        pos += m;
+        p += m;
+        n -= m;
+
+        if (wlen==wbufsize) FlushFile_();
+    }
+
 	// update the # of bytes written
-	nbytes_total += bcount;
-	return bcount;
+	nbytes_total += N;
+	return N;
 }
 
 bool CSinkBase::EOF_()
 {
-	return feof(file);
+	return eof;
 }
 
 size_t CSinkBase::GetNumberOfBytesWritten_()
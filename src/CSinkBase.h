@@ -1,41 +1,161 @@
-#pragma once
-
-#include <cstdint>
-#include <string>
-#include <mutex>
-#include <condition_variable>
-
-#include "ISink.h"
-
-class CSinkBase : public ISink
-{
-public:
-	CSinkBase(const std::string &path);
-	virtual ~CSinkBase();
-
-    virtual bool IsLocked();
-    virtual void Lock(const uintptr_t sign);
-    virtual bool TryLock(const uintptr_t sign);
-    virtual bool Unlock(const uintptr_t sign);
-    virtual void WaitTillUnlock();
-
-protected:
-
-    virtual void SeekFile_(const long int offset, const int origin);
-	virtual size_t ReadFile_(void* buf, const size_t N);
-	virtual size_t WriteFile_(const void *buf, const size_t N);
-	virtual bool EOF_(); // returns true if end-of-file
-	virtual size_t GetNumberOfBytesWritten_();
-
-    virtual uintptr_t GetLockSign_();
-
-private:
-
-    std::condition_variable cv_sign; // condition variable to wait for unlock
-    std::mutex mutex_sign; // mutex to protect lock_sign
-    uintptr_t lock_sign;   // lock signature
-
-	FILE* file;
-	size_t nbytes_total;
-};
-
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+
+#include <sys/types.h>
+
+#include "ISink.h"
+
+/**
+ * @brief Base class of file sinks
+ *
+ * CSinkBase implements the ISink locking mechanism and the file access
+ * functions for the derived sinks.
+ *
+ * The output file is written through a large, page-aligned buffer (1 MiB by
+ * default), so the file system sees few large writes instead of many small
+ * ones. Optionally, the file can be opened with O_DIRECT to bypass the page
+ * cache; page-aligned buffer flushes are then written directly, while the
+ * unaligned ones (e.g., the header rewrites and the last partial block)
+ * temporarily fall back to cached I/O. If the file system does not support
+ * O_DIRECT, cached I/O is used throughout.
+ *
+ * If the total amount of data is known ahead (see Reserve()), the file is
+ * preallocated with posix_fallocate() to avoid incremental file growth. The
+ * file is truncated to the data actually written when it is closed.
+ */
+class CSinkBase : public ISink
+{
+public:
+    static const size_t DefaultBufferSize = 1<<20; /// default write buffer size (1 MiB)
+
+    /**
+     * @brief CSinkBase constructor. Creates (or truncates) the output file.
+     * @param[in] output file path
+     * @param[in] write buffer size in bytes (rounded up to the page size)
+     * @param[in] true to bypass the page cache (O_DIRECT)
+     * @throw std::runtime_error if failed to open the file
+     */
+	CSinkBase(const std::string &path, const size_t bufsize=DefaultBufferSize, const bool direct=false);
+	virtual ~CSinkBase();
+
+    virtual bool IsLocked();
+    virtual void Lock(const uintptr_t sign);
+    virtual bool TryLock(const uintptr_t sign);
+    virtual bool Unlock(const uintptr_t sign);
+    virtual void WaitTillUnlock();
+
+    /**
+     * @brief Preallocate the output file to hold nsamples of 16-bit audio.
+     *        Derived classes shall override if they add more than a small
+     *        header to the audio data.
+     * @param Total number of samples to be written
+     */
+    virtual void Reserve(const size_t nsamples);
+
+    /**
+     * @brief Set the final path of the output file, to which CommitFile_()
+     *        renames the file
+     * @param[in] final path (copied over if on another file system)
+     */
+    virtual void SetFinalPath(const std::string &path);
+
+protected:
+    /**
+     * @brief Constructor for a sink without an output file (e.g., one that
+     *        only analyzes the data). The file access functions must not
+     *        be called.
+     */
+    CSinkBase();
+
+    virtual void SeekFile_(const long int offset, const int origin);
+	virtual size_t ReadFile_(void* buf, const size_t N);
+	virtual size_t WriteFile_(const void *buf, const size_t N);
+	virtual bool EOF_(); // returns true if end-of-file
+	virtual size_t GetNumberOfBytesWritten_();
+
+    /**
+     * @brief Write a block directly to the file at the given offset,
+     *        bypassing the write buffer and leaving the file position
+     *        unchanged. Safe to be called concurrently from multiple threads
+     *        for non-overlapping blocks. Clears O_DIRECT mode at first call.
+     * @param[in] data buffer
+     * @param[in] number of bytes to write
+     * @param[in] file offset in bytes
+     * @return number of bytes written
+     * @throw std::runtime_error if failed to write
+     */
+    virtual size_t WriteFileAt_(const void *buf, const size_t N, const size_t offset);
+
+    /**
+     * @brief Get the size of the data written to the file (excluding the
+     *        buffered data and the preallocated space)
+     * @return file size in bytes
+     */
+    virtual size_t GetFileSize_();
+
+    /**
+     * @brief Flush the write buffer to the file
+     * @throw std::runtime_error if failed to write
+     */
+    virtual void FlushFile_();
+
+    /**
+     * @brief Preallocate the disk space for the output file
+     * @param[in] expected file size in bytes
+     */
+    virtual void PreallocateFile_(const size_t nbytes);
+
+    /**
+     * @brief Complete the output file (flush, release the unused
+     *        preallocation & sync) and atomically rename it to the final path
+     *        (if set, see SetFinalPath()). Derived classes shall call it at the
+     *        end of WritePostamble().
+     * @throw std::runtime_error if failed to write or rename the file
+     */
+    virtual void CommitFile_();
+
+    virtual uintptr_t GetLockSign_();
+
+private:
+
+    std::condition_variable cv_sign; // condition variable to wait for unlock
+    std::mutex mutex_sign; // mutex to protect lock_sign
+    uintptr_t lock_sign;   // lock signature
+
+	std::mutex mutex_file; // mutex to protect fsize & direct for positional writes, and finalpath
+
+	std::string path;   // output file path
+	std::string finalpath; // path to rename the output file to (empty to keep)
+	int fd;             // output file descriptor (-1 if no file)
+	bool direct;        // true if fd is opened with O_DIRECT
+	unsigned char *wbuf; // page-aligned write buffer
+	size_t wbufsize;    // write buffer size
+	size_t wlen;        // number of bytes in the write buffer
+	off_t pos;          // current file position (incl. buffered data)
+	off_t fsize;        // size of the data written to the file
+	bool preallocated;  // true if the file has been preallocated
+	bool eof;           // true if last read hit the end of the file
+
+	size_t nbytes_total;
+
+    /**
+     * @brief Write a block to the file at given offset
+     */
+    void WriteAt_(const void *buf, const size_t N, const off_t offset);
+
+    /**
+     * @brief Copy the output file to the final path (for CommitFile_() when
+     *        the final path is on another file system) and switch over to it
+     * @throw std::runtime_error if failed to copy the file
+     */
+    void CopyFile_(const std::string &dest);
+
+    /**
+     * @brief Enable/disable O_DIRECT on the file descriptor
+     */
+    void SetDirect_(const bool enable);
+};
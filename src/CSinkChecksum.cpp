@@ -0,0 +1,288 @@
+#include "CSinkChecksum.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include <cdio/sector.h>
+
+using std::runtime_error;
+using std::out_of_range;
+
+/* number of stereo samples per sector */
+#define SAMPLES_PER_SECTOR (CDIO_CD_FRAMESIZE_RAW/4)
+
+/* AccurateRip skips the first and last 5 sectors of the disc */
+#define AR_SKIP_SAMPLES (5*SAMPLES_PER_SECTOR)
+
+/* CRC32 (IEEE 802.3, reflected) lookup tables for slicing-by-4 */
+struct SCrc32Tables
+{
+    uint32_t t[4][256];
+
+    SCrc32Tables()
+    {
+        for (uint32_t i = 0; i<256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k<8; k++) c = (c&1) ? (0xEDB88320u ^ (c>>1)) : (c>>1);
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i<256; i++)
+            for (int k = 1; k<4; k++)
+                t[k][i] = (t[k-1][i]>>8) ^ t[0][t[k-1][i]&0xff];
+    }
+};
+
+static const SCrc32Tables &crc_tables()
+{
+    static const SCrc32Tables tables;
+    return tables;
+}
+
+SChecksumTrack::SChecksumTrack(const size_t b, const size_t e, const bool first, const bool last)
+    : begin(b), end(e), arv1(0), arv2(0), crc(0xffffffffu), crcnz(0xffffffffu)
+{
+    size_t len = end-begin;
+    ar_from = first ? AR_SKIP_SAMPLES : 1;
+    ar_to = last ? (len>AR_SKIP_SAMPLES ? len-AR_SKIP_SAMPLES : 0) : len;
+}
+
+/**
+ * @brief CSinkChecksum constructor
+ * @param[in] cuesheet with track index 1 times and total time populated
+ *            (e.g., from ISourceCdda::GetCueSheet())
+ */
+CSinkChecksum::CSinkChecksum(const SCueSheet &cuesheet) : pos(0), itrk(0)
+{
+    size_t ntracks = cuesheet.Tracks.size();
+    tracks.reserve(ntracks);
+    for (size_t i = 0; i<ntracks; i++)
+    {
+        size_t begin = cuesheet.Tracks[i].StartTime()*SAMPLES_PER_SECTOR;
+        size_t end = (i+1<ntracks) ? cuesheet.Tracks[i+1].StartTime() : cuesheet.TotalTime;
+        end = std::max(begin, end*SAMPLES_PER_SECTOR);
+        tracks.emplace_back(begin, end, i==0, i+1==ntracks);
+    }
+}
+
+CSinkChecksum::~CSinkChecksum() {}
+
+/**
+ * @brief Reset the checksums. The instance must be locked by the calling
+ *        thread.
+ * @param A unique signature used to lock the sink
+ */
+void CSinkChecksum::WritePreamble(const uintptr_t sign)
+{
+    if (sign!=GetLockSign_())
+        throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
+
+    for (SChecksumTrackVector::iterator it = tracks.begin(); it!=tracks.end(); it++)
+        *it = SChecksumTrack((*it).begin, (*it).end, it==tracks.begin(), it+1==tracks.end());
+
+    pos = 0;
+    itrk = 0;
+}
+
+/**
+ * @brief Accumulate the checksums over a frame of audio data
+ * @param data buffer (16-bit integer)
+ * @param buffer size in the number of samples
+ * @param A unique signature used to lock the sink
+ * @return Number of samples processed
+ */
+int CSinkChecksum::WriteFrame(const int16_t* data, const size_t framesize, const uintptr_t sign)
+{
+    if (sign!=GetLockSign_())
+        throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
+
+    size_t n = framesize/2; // stereo samples
+
+    // split the frame at the track boundaries
+    while (n && itrk<tracks.size())
+    {
+        SChecksumTrack &trk = tracks[itrk];
+        size_t m;
+
+        if (pos>=trk.end) // done with the track
+        {
+            itrk++;
+            continue;
+        }
+        else if (pos<trk.begin) // before the first track
+        {
+            m = std::min(n, trk.begin-pos);
+        }
+        else
+        {
+            m = std::min(n, trk.end-pos);
+            Accumulate_(trk, data, m, pos-trk.begin+1);
+        }
+
+        pos += m;
+        data += 2*m;
+        n -= m;
+    }
+
+    return framesize;
+}
+
+/**
+ * @brief Finalize the checksums.
+ * @param A unique signature used to lock the sink
+ */
+void CSinkChecksum::WritePostamble(const uintptr_t sign)
+{
+    if (sign!=GetLockSign_())
+        throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
+
+    // no more data
+    itrk = tracks.size();
+}
+
+/**
+ * @brief returns true if cuesheet can be embedded
+ * @return always false
+ */
+bool CSinkChecksum::CueSheetEmbeddable() { return false; }
+
+/**
+ * @brief Does nothing as cuesheet cannot be embedded
+ * @param[in] reference to the cuesheet
+ */
+void CSinkChecksum::SetCueSheet(const SCueSheet& cuesheet) {}
+
+/**
+ * @brief Does nothing as there is no output file
+ * @param[in] image data
+ * @param[in] true for the front cover, false for the back cover
+ */
+void CSinkChecksum::SetCoverArt(const std::vector<unsigned char> &data, const bool front) {}
+
+/**
+ * @brief Get AccurateRip v1 checksum of a track
+ * @param[in] track number (1-based)
+ * @return checksum
+ * @throw std::out_of_range if invalid track number
+ */
+uint32_t CSinkChecksum::GetAccurateRipV1(const size_t track) const
+{
+    return tracks.at(track-1).arv1;
+}
+
+/**
+ * @brief Get AccurateRip v2 checksum of a track
+ * @param[in] track number (1-based)
+ * @return checksum
+ * @throw std::out_of_range if invalid track number
+ */
+uint32_t CSinkChecksum::GetAccurateRipV2(const size_t track) const
+{
+    const SChecksumTrack &trk = tracks.at(track-1);
+    return trk.arv1 + trk.arv2; // v2 sums both low (=v1) and high words of the products
+}
+
+/**
+ * @brief Get CRC32 of a track
+ * @param[in] track number (1-based)
+ * @return CRC32 of all the samples of the track
+ * @throw std::out_of_range if invalid track number
+ */
+uint32_t CSinkChecksum::GetCRC32(const size_t track) const
+{
+    return ~tracks.at(track-1).crc;
+}
+
+/**
+ * @brief Get CRC32 of a track, excluding silent samples
+ * @param[in] track number (1-based)
+ * @return CRC32 of the non-zero samples of the track
+ * @throw std::out_of_range if invalid track number
+ */
+uint32_t CSinkChecksum::GetCRC32NoSilence(const size_t track) const
+{
+    return ~tracks.at(track-1).crcnz;
+}
+
+/**
+ * @brief Add the checksums to the track REM fields of a cuesheet
+ *        (ACCURATERIPV1, ACCURATERIPV2, CRC32, and CRC32NS)
+ * @param[inout] cuesheet with the same number of tracks
+ */
+void CSinkChecksum::AppendRems(SCueSheet &cuesheet) const
+{
+    size_t ntracks = std::min(tracks.size(), cuesheet.Tracks.size());
+    for (size_t i = 1; i<=ntracks; i++)
+    {
+        std::vector<std::string> &rems = cuesheet.Tracks[i-1].Rems;
+        std::ostringstream os;
+        os << std::hex << std::uppercase << std::setfill('0');
+
+        os.str(""); os << "ACCURATERIPV1 " << std::setw(8) << GetAccurateRipV1(i);
+        rems.push_back(os.str());
+        os.str(""); os << "ACCURATERIPV2 " << std::setw(8) << GetAccurateRipV2(i);
+        rems.push_back(os.str());
+        os.str(""); os << "CRC32 " << std::setw(8) << GetCRC32(i);
+        rems.push_back(os.str());
+        os.str(""); os << "CRC32NS " << std::setw(8) << GetCRC32NoSilence(i);
+        rems.push_back(os.str());
+    }
+}
+
+/**
+ * @brief Accumulate the checksums over a block of stereo samples, which
+ *        belongs to a single track
+ * @param[inout] track
+ * @param[in] stereo samples (little-endian left/right pairs)
+ * @param[in] number of stereo samples
+ * @param[in] AccurateRip multiplier of the first sample
+ */
+void CSinkChecksum::Accumulate_(SChecksumTrack &trk, const int16_t *data, const size_t n, const size_t mult)
+{
+    const uint32_t (&t)[4][256] = crc_tables().t;
+
+    // AccurateRip: only the samples with multipliers in [ar_from, ar_to]. The
+    // loop over the clipped range is branch-free, so the compiler can vectorize it.
+    size_t first = std::max(mult, trk.ar_from);
+    size_t last = std::min(mult+n-1, trk.ar_to);
+    uint32_t v1 = trk.arv1;
+    uint32_t v2 = trk.arv2;
+    for (size_t m = first; m<=last; m++)
+    {
+        const int16_t *s = data + 2*(m-mult);
+        uint32_t word = (uint32_t)(uint16_t)s[0] | ((uint32_t)(uint16_t)s[1]<<16);
+        uint64_t prod = (uint64_t)word*(uint32_t)m;
+        v1 += (uint32_t)prod;
+        v2 += (uint32_t)(prod>>32);
+    }
+    trk.arv1 = v1;
+    trk.arv2 = v2;
+
+    // CRC32 over all samples (a stereo sample, or 4 bytes, at a time) and
+    // CRC32 over non-zero 16-bit samples
+    uint32_t crc = trk.crc;
+    uint32_t crcnz = trk.crcnz;
+    for (size_t i = 0; i<n; i++, data+=2)
+    {
+        uint16_t left = (uint16_t)data[0];
+        uint16_t right = (uint16_t)data[1];
+
+        crc ^= (uint32_t)left | ((uint32_t)right<<16);
+        crc = t[3][crc&0xff] ^ t[2][(crc>>8)&0xff] ^ t[1][(crc>>16)&0xff] ^ t[0][crc>>24];
+
+        if (left)
+        {
+            crcnz = (crcnz>>8) ^ t[0][(crcnz^left)&0xff];
+            crcnz = (crcnz>>8) ^ t[0][(crcnz^(left>>8))&0xff];
+        }
+        if (right)
+        {
+            crcnz = (crcnz>>8) ^ t[0][(crcnz^right)&0xff];
+            crcnz = (crcnz>>8) ^ t[0][(crcnz^(right>>8))&0xff];
+        }
+    }
+    trk.crc = crc;
+    trk.crcnz = crcnz;
+}
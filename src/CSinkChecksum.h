@@ -0,0 +1,161 @@
+#pragma once
+
+#include "CSinkBase.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Per-track checksum accumulator
+ */
+struct SChecksumTrack
+{
+    size_t begin;   // first stereo sample of the track (index 1)
+    size_t end;     // one past the last stereo sample of the track
+    size_t ar_from; // first AccurateRip multiplier included in the sums
+    size_t ar_to;   // last AccurateRip multiplier included in the sums
+
+    uint32_t arv1;  // AccurateRip v1 sum
+    uint32_t arv2;  // AccurateRip v2 sum (the high words; arv1 is added on output)
+    uint32_t crc;   // CRC32 state over all samples
+    uint32_t crcnz; // CRC32 state over non-zero samples
+
+    SChecksumTrack(const size_t b, const size_t e, const bool first, const bool last);
+};
+
+typedef std::vector<SChecksumTrack> SChecksumTrackVector;
+
+/**
+ * @brief Sink to compute rip checksums on the fly
+ *
+ * CSinkChecksum is an analysis-only sink (no output file). Attach it to
+ * CCdRipper alongside the audio file sinks, and it computes per-track
+ * checksums while the sectors stream by, without a second pass over the
+ * output files:
+ *
+ * - AccurateRip v1 and v2 checksums (first 5 sectors of the first track and
+ *   last 5 sectors of the last track are excluded, per AccurateRip)
+ * - CRC32 of the track audio data (EAC's "Copy CRC")
+ * - CRC32 of the track audio data, skipping zero (silent) 16-bit samples
+ *   (EAC's "CRC w/o null samples")
+ *
+ * The track boundaries are the index-1 times of the cuesheet tracks, the
+ * last track extending to SCueSheet::TotalTime. The stream is expected to
+ * begin at sector 0 of the disc as ISourceCdda delivers it; the samples
+ * before the index 1 of the first track (hidden track) are not included.
+ *
+ * The results are valid after WritePostamble(), and can be added to the
+ * cuesheet as track REM fields with AppendRems().
+ */
+class CSinkChecksum : public CSinkBase
+{
+public:
+    /**
+     * @brief CSinkChecksum constructor
+     * @param[in] cuesheet with track index 1 times and total time populated
+     *            (e.g., from ISourceCdda::GetCueSheet())
+     */
+    CSinkChecksum(const SCueSheet &cuesheet);
+    virtual ~CSinkChecksum();
+
+    /**
+     * @brief Reset the checksums. The instance must be locked by the calling
+     *        thread.
+     * @param A unique signature used to lock the sink
+     */
+    virtual void WritePreamble(const uintptr_t sign);
+
+    /**
+     * @brief Accumulate the checksums over a frame of audio data
+     * @param data buffer (16-bit integer)
+     * @param buffer size in the number of samples
+     * @param A unique signature used to lock the sink
+     * @return Number of samples processed
+     */
+    virtual int WriteFrame(const int16_t* data, const size_t framesize, const uintptr_t sign);
+
+    /**
+     * @brief Finalize the checksums.
+     * @param A unique signature used to lock the sink
+     */
+    virtual void WritePostamble(const uintptr_t sign);
+
+    /**
+     * @brief returns true if cuesheet can be embedded
+     * @return always false
+     */
+    virtual bool CueSheetEmbeddable();
+
+    /**
+     * @brief Does nothing as cuesheet cannot be embedded
+     * @param[in] reference to the cuesheet
+     */
+    virtual void SetCueSheet(const SCueSheet& cuesheet);
+
+    /**
+     * @brief Does nothing as there is no output file
+     * @param[in] image data
+     * @param[in] true for the front cover, false for the back cover
+     */
+    virtual void SetCoverArt(const std::vector<unsigned char> &data, const bool front);
+
+    /**
+     * @brief Get the number of tracks
+     * @return Number of tracks
+     */
+    size_t NumberOfTracks() const { return tracks.size(); }
+
+    /**
+     * @brief Get AccurateRip v1 checksum of a track
+     * @param[in] track number (1-based)
+     * @return checksum
+     * @throw std::out_of_range if invalid track number
+     */
+    uint32_t GetAccurateRipV1(const size_t track) const;
+
+    /**
+     * @brief Get AccurateRip v2 checksum of a track
+     * @param[in] track number (1-based)
+     * @return checksum
+     * @throw std::out_of_range if invalid track number
+     */
+    uint32_t GetAccurateRipV2(const size_t track) const;
+
+    /**
+     * @brief Get CRC32 of a track
+     * @param[in] track number (1-based)
+     * @return CRC32 of all the samples of the track
+     * @throw std::out_of_range if invalid track number
+     */
+    uint32_t GetCRC32(const size_t track) const;
+
+    /**
+     * @brief Get CRC32 of a track, excluding silent samples
+     * @param[in] track number (1-based)
+     * @return CRC32 of the non-zero samples of the track
+     * @throw std::out_of_range if invalid track number
+     */
+    uint32_t GetCRC32NoSilence(const size_t track) const;
+
+    /**
+     * @brief Add the checksums to the track REM fields of a cuesheet
+     *        (ACCURATERIPV1, ACCURATERIPV2, CRC32, and CRC32NS)
+     * @param[inout] cuesheet with the same number of tracks
+     */
+    void AppendRems(SCueSheet &cuesheet) const;
+
+private:
+    SChecksumTrackVector tracks;
+    size_t pos;   // current position in stereo samples
+    size_t itrk;  // index of the current track in tracks
+
+    /**
+     * @brief Accumulate the checksums over a block of stereo samples, which
+     *        belongs to a single track
+     * @param[inout] track
+     * @param[in] stereo samples (little-endian left/right pairs)
+     * @param[in] number of stereo samples
+     * @param[in] AccurateRip multiplier of the first sample
+     */
+    static void Accumulate_(SChecksumTrack &trk, const int16_t *data, const size_t n, const size_t mult);
+};
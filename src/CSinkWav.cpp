@@ -1,25 +1,59 @@
 #include "CSinkWav.h"
 
 #include <stdexcept>
+#include <cstring>
 
 using std::string;
 using std::runtime_error;
 
-CSinkWav::CSinkWav(const string &path) : CSinkBase(path)
+// size of the WAV header
+#define WAV_HEADER_SIZE 44
+
+CSinkWav::CSinkWav(const string &path, const size_t bufsize, const bool direct)
+    : CSinkBase(path, bufsize, direct), ndata(0), nwritten(0)
 {}	
 
 CSinkWav::~CSinkWav()
 {}
 
+void CSinkWav::Reserve(const size_t nsamples)
+{
+    ndata = nsamples*sizeof(int16_t);
+    PreallocateFile_(WAV_HEADER_SIZE + ndata);
+}
+
+// store an integer as an n-byte little-endian entity
+static void PutInteger_(unsigned char *c, long int num, int bytes)
+{
+    for (int i=0; i<bytes; i++)
+        c[i] = (num >> (i<<3)) & 0xff;
+}
+
 void CSinkWav::WriteInteger_(long int num, int bytes)
 {
-	unsigned int i;
-	unsigned char c;
-	for (i=0; bytes--; i++)
-	{
-		c = (num >> (i<<3)) & 0xff;
-		WriteFile_(&c, 1);
-	}
+    unsigned char c[sizeof(num)];
+    PutInteger_(c, num, bytes);
+    WriteFile_(c, bytes);
+}
+
+void CSinkWav::WriteHeaderAt_(const size_t datasize)
+{
+    unsigned char h[WAV_HEADER_SIZE];
+
+    memcpy(h, "RIFF", 4); /* 0-3 : FILE ID String */
+    PutInteger_(h+4, datasize+WAV_HEADER_SIZE-8, 4); /* 4-7 : Size of the overall file - 8*/
+    memcpy(h+8, "WAVEfmt ", 8); /* 8-15 : File type header + format chunk header */
+    PutInteger_(h+16, 16, 4); /* 16-19 : length of the header so far*/
+    PutInteger_(h+20, 1, 2); /* 20-21 : type of format */
+    PutInteger_(h+22, 2, 2); /* 22-23 : number of channels*/
+    PutInteger_(h+24, 44100, 4); /* 24-27 : sample rate */
+    PutInteger_(h+28, 44100*2*2, 4); /* 28-31 : total bitrate in bytes/second */
+    PutInteger_(h+32, 4, 2); /* 32-33 : total # of bytes per sample (all channels)*/
+    PutInteger_(h+34, 16, 2); /* 34-35 : bits per sample */
+    memcpy(h+36, "data", 4); /* 36-39 : data chunk header */
+    PutInteger_(h+40, datasize, 4); /* 40-43 : data chunk size*/
+
+    WriteFileAt_(h, WAV_HEADER_SIZE, 0);
 }
 
 #define WriteString_(s) \
@@ -31,6 +65,14 @@ void CSinkWav::WritePreamble(const uintptr_t sign)
     if (sign!=GetLockSign_())
         throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
 
+    // exact-length mode: final header now, no seek-back later
+    if (ndata)
+    {
+        WriteHeaderAt_(ndata);
+        nwritten = 0;
+        return;
+    }
+
     /* quick and dirty */
 	WriteString_("RIFF"); /* 0-3 : FILE ID String */
 
@@ -45,6 +87,7 @@ void CSinkWav::WritePreamble(const uintptr_t sign)
 	WriteInteger_(4, 2); /* 32-33 : total # of bytes per sample (all channels)*/
 	WriteInteger_(16, 2); /* 34-35 : bits per sample */
 	WriteString_("data"); /* 36-39 : data chunk header */
+	SeekFile_(4, SEEK_CUR);	/* 40-43 : skip the data chunk size for now */
 }
 
 int CSinkWav::WriteFrame(const int16_t* data, const size_t framesize, const uintptr_t sign)
@@ -52,20 +95,52 @@ int CSinkWav::WriteFrame(const int16_t* data, const size_t framesize, const uint
     if (sign!=GetLockSign_())
         throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
 
+    // exact-length mode: write in place from the caller's buffer
+    if (ndata)
+    {
+        WriteFileAt_(data, 2*framesize, WAV_HEADER_SIZE+nwritten);
+        nwritten += 2*framesize;
+        return framesize;
+    }
+
     return WriteFile_(data, 2*framesize);
 }
 
+int CSinkWav::WriteFrameAt(const int16_t* data, const size_t framesize, const size_t offset, const uintptr_t sign)
+{
+    if (sign!=GetLockSign_())
+        throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
+
+    if (!ndata)
+        throw(runtime_error("CSinkWav::WriteFrameAt() requires the data length to be set by Reserve() first."));
+
+    WriteFileAt_(data, 2*framesize, WAV_HEADER_SIZE+2*offset);
+    return framesize;
+}
+
 void CSinkWav::WritePostamble(const uintptr_t sign)
 {
     if (sign!=GetLockSign_())
         throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
 
-    size_t nbytes_total = GetNumberOfBytesWritten_();
-	SeekFile_(4, SEEK_SET);	// skip the file size for now
-	WriteInteger_(nbytes_total-8, 4); /* 4-7 : Size of the overall file - 8*/
-	SeekFile_(40, SEEK_SET);	// skip the file size for now
-	WriteInteger_(nbytes_total-44, 4); /* 40-43 : data chunk size*/
-	SeekFile_(0, SEEK_END);	// move the cursor to the end
+    // exact-length mode: header only needs fixing if the length came out different
+    if (ndata)
+    {
+        size_t datasize = GetFileSize_()-WAV_HEADER_SIZE;
+        if (datasize!=ndata) WriteHeaderAt_(datasize);
+    }
+    else
+    {
+        size_t nbytes_total = GetNumberOfBytesWritten_();
+        SeekFile_(4, SEEK_SET); // skip the file size for now
+        WriteInteger_(nbytes_total-8, 4); /* 4-7 : Size of the overall file - 8*/
+        SeekFile_(40, SEEK_SET); // skip the file size for now
+        WriteInteger_(nbytes_total-WAV_HEADER_SIZE, 4); /* 40-43 : data chunk size*/
+        SeekFile_(0, SEEK_END); // move the cursor to the end
+    }
+
+    // move the completed file to its final path
+    CommitFile_();
 }
 
 /**
@@ -81,3 +156,10 @@ bool CSinkWav::CueSheetEmbeddable() { return false; }
  *        cuesheet (i.e., CueSheetEmbeddable() returns false)
  */
 void CSinkWav::SetCueSheet(const SCueSheet& cuesheet) {}
+
+/**
+ * @brief Does nothing as the output file has no tags
+ * @param[in] image data
+ * @param[in] true for the front cover, false for the back cover
+ */
+void CSinkWav::SetCoverArt(const std::vector<unsigned char> &data, const bool front) {}
@@ -5,16 +5,52 @@
 #include <string>
 #include <stdint.h>
 
+/**
+ * @brief WAV file sink
+ *
+ * By default, CSinkWav writes a placeholder header and patches the RIFF
+ * sizes in WritePostamble().
+ *
+ * If the total number of samples is given ahead by Reserve(), the file is
+ * preallocated to its exact size and the final header is written by
+ * WritePreamble(). The audio data is then written with positional writes
+ * straight from the caller's buffer (no intermediate copy, no seek-back),
+ * and WriteFrameAt() may be used to write the data out of order from
+ * several threads.
+ */
 class CSinkWav : public CSinkBase
 {
 public:
-	CSinkWav(const std::string &path);
+	CSinkWav(const std::string &path, const size_t bufsize=DefaultBufferSize, const bool direct=false);
 	virtual ~CSinkWav();
 
+    /**
+     * @brief Preallocate the output file to hold the header and nsamples
+     *        of 16-bit audio, and switch to the exact-length mode. Must be
+     *        called before WritePreamble().
+     * @param Total number of samples to be written
+     */
+    virtual void Reserve(const size_t nsamples);
+
     virtual void WritePreamble(const uintptr_t sign);
     virtual int WriteFrame(const int16_t* data, const size_t framesize, const uintptr_t sign);
     virtual void WritePostamble(const uintptr_t sign);
 
+    /**
+     * @brief Write a frame of audio data at the given position. Only
+     *        available in the exact-length mode (see Reserve()). May be
+     *        called concurrently from multiple threads (sharing the lock
+     *        signature) for non-overlapping frames.
+     * @param data buffer (16-bit integer)
+     * @param buffer size in the number of samples
+     * @param position of the frame from the beginning of the audio data, in
+     *        the number of samples
+     * @param A unique signature used to lock the sink
+     * @return Number of samples written
+     * @throw std::runtime_error if not in the exact-length mode
+     */
+    virtual int WriteFrameAt(const int16_t* data, const size_t framesize, const size_t offset, const uintptr_t sign);
+
     /**
      * @brief returns true if cuesheet can be embedded
      * @return true if cuesheet can be embedded
@@ -28,7 +64,18 @@ public:
      *        cuesheet (i.e., CueSheetEmbeddable() returns false)
      */
     virtual void SetCueSheet(const SCueSheet& cuesheet);
+
+    /**
+     * @brief Does nothing as the output file has no tags
+     * @param[in] image data
+     * @param[in] true for the front cover, false for the back cover
+     */
+    virtual void SetCoverArt(const std::vector<unsigned char> &data, const bool front);
 private:
+	size_t ndata;	// exact-length mode: expected audio data size in bytes (0 if unknown)
+	size_t nwritten;	// exact-length mode: sequential write position in the audio data
+
 	void WriteInteger_(long int num, int n);	// write an integer as an n-byte entity
+	void WriteHeaderAt_(const size_t datasize);	// write a complete header with given data size
 };
 
@@ -6,6 +6,11 @@
 #include <cstdio>
 #include <cstring>
 #include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <exception>
+
+#include "utils.h"
 
 using std::string;
 using std::runtime_error;
@@ -30,9 +35,84 @@ static int write_block (void *id, void *data, int32_t length)
 
 #define CLEAR_(destin) memset (&destin, 0, sizeof (destin));
 
-CSinkWavPack::CSinkWavPack(const string &path) 
-	: CSinkBase(path), first_block_size(0)
+/* number of samples buffered before passing to WavPack (1 second of audio) */
+#define BUFFER_SAMPLES (44100*2)
+
+/* parallel encoding: (stereo) samples per WavPack block & blocks per segment */
+#define BLOCK_SAMPLES 22050
+#define SEGMENT_BLOCKS 8
+#define SEGMENT_SAMPLES (BLOCK_SAMPLES*SEGMENT_BLOCKS*2)
+
+/* WavpackHeader field offsets (little-endian) */
+#define WVHDR_TOTAL_SAMPLES_U8 11
+#define WVHDR_TOTAL_SAMPLES 12
+#define WVHDR_BLOCK_INDEX 16
+#define WVHDR_SIZE 32
+
+static uint32_t get_le32_(const unsigned char *p)
+{
+	return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24);
+}
+
+static void set_le32_(unsigned char *p, const uint32_t val)
+{
+	p[0] = val&0xff; p[1] = (val>>8)&0xff; p[2] = (val>>16)&0xff; p[3] = val>>24;
+}
+
+/* A segment of the audio stream, encoded independently
+ */
+struct SWavPackSegment
+{
+	std::vector<int32_t> samples;	// 32-bit interleaved samples
+	std::vector<char> blocks;		// encoded WavPack blocks
+	uint32_t start;				// stream index of the first (stereo) sample
+	uint32_t first_block_size;	// size of the first encoded block
+	bool done;					// true once encoded
+	bool failed;				// true if encoding failed
+	std::exception_ptr error;	// exception caught in write_segment_block, if any
+
+	SWavPackSegment() : start(0), first_block_size(0), done(false), failed(false)
+	{
+		samples.reserve(SEGMENT_SAMPLES);
+	}
+};
+
+/* WavpackBlockOutput function for the segment encoders: shifts the block
+   index by the segment's stream position and collects the blocks
+ */
+static int write_segment_block (void *id, void *data, int32_t length)
+{
+	SWavPackSegment &seg = *(SWavPackSegment*) id;
+	unsigned char *block = (unsigned char*) data;
+
+	if (length>=WVHDR_SIZE && !strncmp((char*)block, "wvpk", 4))
+		set_le32_(block+WVHDR_BLOCK_INDEX, get_le32_(block+WVHDR_BLOCK_INDEX)+seg.start);
+
+	// exceptions must not propagate through libwavpack
+	try
+	{
+		if (seg.blocks.empty()) seg.first_block_size = length;
+		seg.blocks.insert(seg.blocks.end(), block, block+length);
+	}
+	catch (...)
+	{
+		seg.error = std::current_exception();
+		return 0;
+	}
+
+	return 1;
+}
+
+CSinkWavPack::CSinkWavPack(const string &path, const size_t bufsize, const bool direct)
+	: CSinkBase(path, bufsize, direct), first_block_size(0), buflen(0),
+	  nthreads(1), nsamples(0), stop_encoders(false)
 {
+	// allocate the sample buffer once (aligned for the SIMD widening)
+	void *p;
+	if (posix_memalign(&p, 32, BUFFER_SAMPLES*sizeof(int32_t)))
+		throw (runtime_error("Could not allocate the WavPack sample buffer."));
+	buffer = (int32_t*)p;
+
 	// initialize its member variables
 	CLEAR_(config);
 
@@ -59,14 +139,33 @@ CSinkWavPack::CSinkWavPack(const string &path)
 	
 	// create the WavPack writer's context
 	wpc = WavpackOpenFileOutput(write_block, this, NULL);
-	if (!wpc) throw (runtime_error("Could not create a wavpack context."));
+	if (!wpc)
+	{
+		free(buffer);
+		throw (runtime_error("Could not create a wavpack context."));
+	}
 
 }	
 
 CSinkWavPack::~CSinkWavPack()
 {
+	// stop the encoders if still running (i.e., rip aborted)
+	StopEncoders_();
+
 	// Close the context
 	WavpackCloseFile(wpc);
+	free(buffer);
+}
+
+void CSinkWavPack::SetThreads(const unsigned n)
+{
+	nthreads = n ? n : 1;
+}
+
+void CSinkWavPack::Reserve(const size_t nsamples)
+{
+	// lossless compression of CD audio typically yields 50-70% of the PCM size
+	PreallocateFile_(nsamples*sizeof(int16_t)/2);
 }
 
 /* Write a the header for a WAV file. */
@@ -75,11 +174,17 @@ void CSinkWavPack::WritePreamble(const uintptr_t sign)
     if (sign!=GetLockSign_())
         throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
 
+	// parallel encoding: fixed block size to make segments of whole blocks
+	config.block_samples = (nthreads>1) ? BLOCK_SAMPLES : 0;
+
 	if (!WavpackSetConfiguration (wpc, &config, -1))
 		throw(runtime_error("Failed to set wavpack configuration."));
 
 	//  4. prepare for packing with WavpackPackInit()
 	WavpackPackInit(wpc);
+	buflen = 0;
+
+	if (nthreads>1) StartEncoders_();
 }
 
 int CSinkWavPack::WriteFrame(const int16_t* data, const size_t framesize, const uintptr_t sign)
@@ -87,16 +192,52 @@ int CSinkWavPack::WriteFrame(const int16_t* data, const size_t framesize, const
     if (sign!=GetLockSign_())
         throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
 
-    // copy data to the sample buffers as a 32-bit data
-	buffer.assign(data,data+framesize);
-	
-	// 5. actually compress audio and write blocks with WavpackPackSamples()
-	if ( !WavpackPackSamples(wpc, buffer.data(), framesize/2) )
-		throw(runtime_error("Failed to set wavpack configuration."));
+    // parallel: widen data into the segment, submitting each as it fills up
+	if (nthreads>1)
+	{
+		for (size_t i = 0; i<framesize;)
+		{
+			std::vector<int32_t> &buf = segment->samples;
+			size_t len = buf.size();
+			size_t n = std::min<size_t>(framesize-i, SEGMENT_SAMPLES-len);
+			buf.resize(len+n);
+			widen_int16(buf.data()+len, data+i, n);
+			i += n;
+
+			if (buf.size()==SEGMENT_SAMPLES)
+			{
+				SubmitSegment_();
+				WriteSegments_(2*nthreads); // limit the memory use
+			}
+		}
+		return framesize;
+	}
+
+	// widen data into the sample buffer as 32-bit data, packing each time it fills up
+	for (size_t i = 0; i<framesize;)
+	{
+		size_t n = std::min(framesize-i, BUFFER_SAMPLES-buflen);
+		widen_int16(buffer+buflen, data+i, n);
+		buflen += n;
+		i += n;
+
+		if (buflen==BUFFER_SAMPLES) PackBuffer_();
+	}
 	
 	return framesize;
 }
 
+void CSinkWavPack::PackBuffer_()
+{
+	if (!buflen) return;
+
+	// 5. actually compress audio and write blocks with WavpackPackSamples()
+	if ( !WavpackPackSamples(wpc, buffer, buflen/2) )
+		throw(runtime_error("WavPack: Failed to pack samples."));
+
+	buflen = 0;
+}
+
 void CSinkWavPack::WritePostamble(const uintptr_t sign)
 {
 /*
@@ -113,8 +254,20 @@ void CSinkWavPack::WritePostamble(const uintptr_t sign)
         throw(runtime_error("The calling thread must call Lock() first; it has not attained exclusive access."));
 
     // we're now done with any WavPack blocks, so flush any remaining data
-	if (!WavpackFlushSamples (wpc))
-		throw(runtime_error("WavPack: Failed to flush samples."));
+	if (nthreads>1)
+	{
+		// encode the last segment & write all the remaining segments
+		SubmitSegment_();
+		WriteSegments_(0);
+		StopEncoders_();
+	}
+	else
+	{
+		// pack the remaining buffered samples, then flush any remaining data
+		PackBuffer_();
+		if (!WavpackFlushSamples (wpc))
+			throw(runtime_error("WavPack: Failed to flush samples."));
+	}
 
 	// to see if we need to create & write a tag 
 	// (which is NOT stored in regular WavPack blocks)
@@ -124,14 +277,19 @@ void CSinkWavPack::WritePostamble(const uintptr_t sign)
 	// situations we might have to back up and re-write the initial blocks.
 	// Currently the only case is if we're ignoring length or inputting raw pcm data.
 	UpdatePreamble_();
+
+	// move the completed file to its final path
+	CommitFile_();
 }
 
 void CSinkWavPack::WriteTags_()
 {
+	std::lock_guard<std::mutex> lck(mutex_tags);
+
 	// loop through all the tags and write them 
 	for (const STagAPEv2 *tag = (const STagAPEv2*)tags.ReadFirstTag(); tag; tag = (const STagAPEv2*)tags.ReadNextTag())
 	{
-		int res;
+		int res = 1;
 		
 		// append the tag to the file
 		switch (tag->enc)
@@ -142,13 +300,17 @@ void CSinkWavPack::WriteTags_()
 		case APEv2_ENC_BINARY:
 			res = WavpackAppendBinaryTagItem (wpc, tag->key.c_str(), tag->val.data(), tag->val.size());
 			break;
-		default: // APEv2_ENC_EXTREF not supported
-			printf("WavPack: Skipping %s tag, which uses an unsupported encoding.", tag->key.c_str());
+		default: // APEv2_ENC_EXTREF not supported, skip the tag
+			break;
 		}
 		
 		if (!res)
 			throw(runtime_error("WavPack: Failed to write tags."));
 	}
+
+	// write the APEv2 tag (after the audio blocks, through write_block())
+	if (!WavpackWriteTag (wpc))
+		throw(runtime_error("WavPack: Failed to write tags."));
 }
 
 void CSinkWavPack::UpdatePreamble_()
@@ -167,7 +329,15 @@ void CSinkWavPack::UpdatePreamble_()
 		if (strncmp (block_buff, "wvpk", 4)) throw;
 
 		// update the first block to include the final sample size
-		WavpackUpdateNumSamples (wpc, block_buff);
+		if (nthreads>1)
+		{
+			block_buff[WVHDR_TOTAL_SAMPLES_U8] = 0;
+			set_le32_((unsigned char*)block_buff+WVHDR_TOTAL_SAMPLES, nsamples);
+		}
+		else
+		{
+			WavpackUpdateNumSamples (wpc, block_buff);
+		}
 
 		// re-write the first block data
 		SeekFile_(0, SEEK_SET);
@@ -194,6 +364,119 @@ size_t CSinkWavPack::WriteFile(const void *buf, const size_t N)
 	return bcount;
 }
 
+void CSinkWavPack::StartEncoders_()
+{
+	stop_encoders = false;
+	nsamples = 0;
+	segments.clear();
+	segment.reset(new SWavPackSegment);
+
+	for (unsigned i = 0; i<nthreads; i++)
+		encoders.emplace_back(&CSinkWavPack::EncoderMain_, this);
+}
+
+void CSinkWavPack::StopEncoders_()
+{
+	{
+		std::lock_guard<std::mutex> lck(mutex_jobs);
+		stop_encoders = true;
+		cv_jobs.notify_all();
+	}
+
+	for (size_t i = 0; i<encoders.size(); i++) encoders[i].join();
+	encoders.clear();
+}
+
+void CSinkWavPack::EncoderMain_()
+{
+	std::unique_lock<std::mutex> lck(mutex_jobs);
+	while (true)
+	{
+		while (!stop_encoders && jobs.empty()) cv_jobs.wait(lck);
+		if (stop_encoders) return;
+
+		SWavPackSegment *seg = jobs.front();
+		jobs.pop();
+
+		lck.unlock();
+		try
+		{
+			EncodeSegment_(*seg);
+		}
+		catch (...)
+		{
+			// handed over to the writing thread by WriteSegments_()
+			if (!seg->error) seg->error = std::current_exception();
+			seg->failed = true;
+		}
+		lck.lock();
+
+		seg->done = true;
+		cv_done.notify_all();
+	}
+}
+
+void CSinkWavPack::EncodeSegment_(SWavPackSegment &seg)
+{
+	WavpackConfig cfg = config;
+	WavpackContext *ctx = WavpackOpenFileOutput(write_segment_block, &seg, NULL);
+
+	seg.failed = !(ctx && WavpackSetConfiguration(ctx, &cfg, -1) && WavpackPackInit(ctx)
+			&& WavpackPackSamples(ctx, seg.samples.data(), seg.samples.size()/2)
+			&& WavpackFlushSamples(ctx));
+
+	if (ctx) WavpackCloseFile(ctx);
+
+	// release the sample memory early
+	std::vector<int32_t>().swap(seg.samples);
+
+	// rethrow the exception caught in write_segment_block
+	if (seg.error) std::rethrow_exception(seg.error);
+}
+
+void CSinkWavPack::SubmitSegment_()
+{
+	if (segment->samples.empty()) return;
+
+	segment->start = nsamples;
+	nsamples += segment->samples.size()/2;
+
+	std::lock_guard<std::mutex> lck(mutex_jobs);
+	jobs.push(segment.get());
+	segments.push_back(std::move(segment));
+	segment.reset(new SWavPackSegment);
+	cv_jobs.notify_one();
+}
+
+void CSinkWavPack::WriteSegments_(const size_t maxpending)
+{
+	std::unique_lock<std::mutex> lck(mutex_jobs);
+	while (!segments.empty())
+	{
+		SWavPackSegment &seg = *segments.front();
+
+		// wait for the oldest segment only if too many are pending
+		if (!seg.done)
+		{
+			if (segments.size()<=maxpending) return;
+			cv_done.wait(lck);
+			continue;
+		}
+
+		if (seg.error) std::rethrow_exception(seg.error);
+		if (seg.failed)
+			throw(runtime_error("WavPack: Failed to encode samples."));
+
+		// write outside the lock so the encoders can carry on
+		lck.unlock();
+		if (!first_block_size) first_block_size = seg.first_block_size;
+		CSinkBase::WriteFile_(seg.blocks.data(), seg.blocks.size());
+		lck.lock();
+
+		segments.pop_front();
+	}
+}
+
 /**
  * @brief returns true if cuesheet can be embedded
  * @return always false
@@ -210,5 +493,28 @@ void CSinkWavPack::SetCueSheet(const SCueSheet& cuesheet)
 {
     std::ostringstream os ;
     os << cuesheet;
+
+    std::lock_guard<std::mutex> lck(mutex_tags);
     tags.AppendTag("cuesheet", os.str().c_str());
 }
+
+/**
+ * @brief Add/overwrite "Cover Art (Front)" or "Cover Art (Back)" binary
+ *        tag entry to the output file
+ * @param[in] image data (JPEG or PNG)
+ * @param[in] true for the front cover, false for the back cover
+ */
+void CSinkWavPack::SetCoverArt(const std::vector<unsigned char> &data, const bool front)
+{
+    if (data.empty()) return;
+
+    // APEv2 cover art: NUL-terminated file name followed by the image data
+    bool png = data.size()>4 && memcmp(data.data(), "\x89PNG", 4)==0;
+    std::string val(front ? "front" : "back");
+    val += png ? ".png" : ".jpg";
+    val.push_back('\0');
+    val.append((const char*)data.data(), data.size());
+
+    std::lock_guard<std::mutex> lck(mutex_tags);
+    tags.AppendBinaryTag(front ? "Cover Art (Front)" : "Cover Art (Back)", val.data(), val.size());
+}
@@ -1,49 +1,115 @@
-#pragma once
-
-#include <string>
-#include <queue>
-#include <wavpack/wavpack.h>
-
-#include "CSinkBase.h"
-#include "CTagsAPEv2.h"
-
-class CSinkWavPack : public CSinkBase
-{
-public:
-	CTagsAPEv2 tags;
-
-	CSinkWavPack(const std::string &path);
-	virtual ~CSinkWavPack();
-
-    virtual void WritePreamble(const uintptr_t sign);
-    virtual int WriteFrame(const int16_t* data, const size_t framesize, const uintptr_t sign);
-    virtual void WritePostamble(const uintptr_t sign);
-
-	virtual size_t WriteFile(const void *buf, const size_t N);
-
-    /**
-     * @brief returns true if cuesheet can be embedded
-     * @return true if cuesheet can be embedded
-     */
-    virtual bool CueSheetEmbeddable();
-
-    /**
-     * @brief Add "cuesheet" tag entry to the output file
-     * @param[in] reference to the cuesheet
-     * @throw std::runtime_error if ISink instance does not support embedded
-     *        cuesheet (i.e., CueSheetEmbeddable() returns false)
-     */
-    virtual void SetCueSheet(const SCueSheet& cuesheet);
-
-private:
-	uint32_t first_block_size;
-	
-	WavpackConfig config;
-	WavpackContext *wpc;
-	
-	std::vector<int32_t> buffer;
-	
-	virtual void WriteTags_();
-	virtual void UpdatePreamble_();
-};
-
+#pragma once
+
+#include <string>
+#include <queue>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <wavpack/wavpack.h>
+
+#include "CSinkBase.h"
+#include "CTagsAPEv2.h"
+
+struct SWavPackSegment;
+
+/**
+ * @brief WavPack file sink
+ *
+ * By default, the audio is compressed by a single WavPack context on the
+ * thread calling WriteFrame(). With SetThreads(n) (n>1), the audio stream
+ * is instead split into segments of whole WavPack blocks, which are
+ * compressed concurrently by n encoder threads, each with its own WavPack
+ * context. As WavPack blocks are independently decodable, the encoded
+ * blocks are re-indexed to their position in the stream and written to the
+ * file in order, yielding the same file layout as the serial encoder.
+ */
+class CSinkWavPack : public CSinkBase
+{
+public:
+	CTagsAPEv2 tags;
+
+	CSinkWavPack(const std::string &path, const size_t bufsize=DefaultBufferSize, const bool direct=false);
+	virtual ~CSinkWavPack();
+
+    /**
+     * @brief Set the number of encoder threads. Must be called before
+     *        WritePreamble().
+     * @param[in] number of threads (0 or 1 for serial encoding)
+     */
+    void SetThreads(const unsigned nthreads);
+
+    /**
+     * @brief Preallocate the output file for the estimated compressed size
+     *        (half the PCM size; the file grows beyond it if needed, and the
+     *        unused space is released at WritePostamble())
+     * @param Total number of samples to be written
+     */
+    virtual void Reserve(const size_t nsamples);
+
+    virtual void WritePreamble(const uintptr_t sign);
+    virtual int WriteFrame(const int16_t* data, const size_t framesize, const uintptr_t sign);
+    virtual void WritePostamble(const uintptr_t sign);
+
+	virtual size_t WriteFile(const void *buf, const size_t N);
+
+    /**
+     * @brief returns true if cuesheet can be embedded
+     * @return true if cuesheet can be embedded
+     */
+    virtual bool CueSheetEmbeddable();
+
+    /**
+     * @brief Add "cuesheet" tag entry to the output file
+     * @param[in] reference to the cuesheet
+     * @throw std::runtime_error if ISink instance does not support embedded
+     *        cuesheet (i.e., CueSheetEmbeddable() returns false)
+     */
+    virtual void SetCueSheet(const SCueSheet& cuesheet);
+
+    /**
+     * @brief Add/overwrite "Cover Art (Front)" or "Cover Art (Back)" binary
+     *        tag entry to the output file
+     * @param[in] image data (JPEG or PNG)
+     * @param[in] true for the front cover, false for the back cover
+     */
+    virtual void SetCoverArt(const std::vector<unsigned char> &data, const bool front);
+
+private:
+	uint32_t first_block_size;
+	
+	WavpackConfig config;
+	WavpackContext *wpc;
+	
+	int32_t *buffer;	// aligned 32-bit sample buffer, reused for the whole rip
+	size_t buflen;		// number of samples in buffer
+	
+	void PackBuffer_();	// pass the buffered samples to the encoder
+
+	// parallel encoding
+	unsigned nthreads;	// number of encoder threads
+	uint32_t nsamples;	// number of (stereo) samples submitted to the encoders
+	std::unique_ptr<SWavPackSegment> segment;	// segment being filled
+	std::deque<std::unique_ptr<SWavPackSegment>> segments;	// submitted segments in stream order
+	std::queue<SWavPackSegment*> jobs;	// segments waiting for an encoder
+	std::vector<std::thread> encoders;	// encoder threads
+	std::mutex mutex_jobs;	// protects jobs, segment states, & stop_encoders
+	std::condition_variable cv_jobs;	// signaled when a job is queued
+	std::condition_variable cv_done;	// signaled when a segment is encoded
+	bool stop_encoders;
+
+	std::mutex mutex_tags;	// protects tags, which may be set while ripping
+
+	void StartEncoders_();
+	void StopEncoders_();
+	void EncoderMain_();
+	void EncodeSegment_(SWavPackSegment &seg);
+	void SubmitSegment_();	// queue the segment being filled for encoding
+	void WriteSegments_(const size_t maxpending);	// write encoded segments in order
+
+	virtual void WriteTags_();
+	virtual void UpdatePreamble_();
+};
+
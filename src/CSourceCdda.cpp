@@ -2,6 +2,8 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 /*
 #include <stdlib.h>
@@ -18,8 +20,18 @@
 using std::string;
 using std::runtime_error;
 
+/* number of sectors per burst read command */
+#define BURST_SECTORS 26
+
+/* drive cache size assumed by the burst mode verification (8 MB) */
+#define CACHEBUST_SECTORS 3600
+
+/* longest track held in memory for the burst mode verification (15 min);
+   longer tracks are read with paranoia */
+#define BURST_MAX_TRACK_SECTORS (15*60*CDIO_CD_FRAMES_PER_SEC)
+
 CSourceCdda::CSourceCdda()	// auto-detect CD-ROM drive
-: d(NULL)
+: d(NULL), burst(false), i_paranoia_lsn(-1), burst_pos(0), burst_len(0)
 {
 	OpenDisc_();	// throws exception if failed
     try
@@ -34,7 +46,7 @@ CSourceCdda::CSourceCdda()	// auto-detect CD-ROM drive
 }
 
 CSourceCdda::CSourceCdda(const std::string &path) // use the given drive
-: d(NULL)
+: d(NULL), burst(false), i_paranoia_lsn(-1), burst_pos(0), burst_len(0)
 {
 	OpenDisc_(path.c_str());	// throws exception if failed
     try
@@ -141,6 +153,12 @@ void CSourceCdda::InitParanoia_()
 	p = paranoia_init(d);
 	paranoia_modeset(p, PARANOIA_MODE_FULL^PARANOIA_MODE_NEVERSKIP);
     i_last_lsn = cdda_disc_lastsector(d);
+
+    /* track boundaries for burst mode fallback */
+    track_last_lsns.clear();
+    for (track_t i = 1; i <= cdda_tracks(d); i++)
+        track_last_lsns.push_back(cdda_track_lastsector(d,i));
+
     Rewind();
 }
 	
@@ -151,6 +169,13 @@ size_t CSourceCdda::GetSectorSize() const
 
 const int16_t* CSourceCdda::ReadNextSector()
 {
+	/* burst mode: hand over the verified track a sector at a time */
+	if (burst)
+	{
+		size_t n = 1;
+		return NextBurst_(n);
+	}
+
 	/* return NULL if reached the end */
 	if (i_curr_lsn>i_last_lsn) return NULL;
 
@@ -164,11 +189,168 @@ const int16_t* CSourceCdda::ReadNextSector()
 	return p_readbuf;
 }
 
+size_t CSourceCdda::ReadSectors(int16_t *buf, const size_t nsectors)
+{
+	/* burst mode: copy out of the verified track (or paranoia's buffer) */
+	if (burst)
+	{
+		size_t ntotal = 0;
+		while (ntotal<nsectors)
+		{
+			size_t n = nsectors-ntotal;
+			const int16_t *src = NextBurst_(n);
+			if (!src) break;
+			memcpy(buf, src, n*CDIO_CD_FRAMESIZE_RAW);
+			buf += n*(CDIO_CD_FRAMESIZE_RAW/2);
+			ntotal += n;
+		}
+		return ntotal;
+	}
+
+	/* clip the request at the end of the disc */
+	size_t m = 0;
+	if (i_curr_lsn<=i_last_lsn)
+		m = std::min<size_t>(nsectors, i_last_lsn-i_curr_lsn+1);
+
+	/* paranoia reads one sector at a time into its own buffer */
+	for (size_t i=0; i<m; i++, buf+=CDIO_CD_FRAMESIZE_RAW/2)
+	{
+		int16_t *p_readbuf = paranoia_read(p, NULL);
+		if(!p_readbuf) throw (runtime_error("paranoia read error. Stopping."));
+		memcpy(buf, p_readbuf, CDIO_CD_FRAMESIZE_RAW);
+	}
+
+	/* advance the sector counter */
+	i_curr_lsn += m;
+
+	return m;
+}
+
 void CSourceCdda::Rewind()
 {
 	/* Set reading mode for full paranoia, but allow skipping sectors. */
     paranoia_seek(p, 0, SEEK_SET);
 	i_curr_lsn = 0;
+
+	/* reset burst mode states */
+	i_paranoia_lsn = -1;
+	burst_pos = burst_len = 0;
+	paranoia_tracks.clear();
+}
+
+void CSourceCdda::SetBurstMode(const bool enable)
+{
+	if (burst==enable) return;
+
+	/* give back the sectors read ahead but not consumed yet */
+	i_curr_lsn -= burst_len-burst_pos;
+	burst_pos = burst_len = 0;
+
+	burst = enable;
+	if (burst)
+	{
+		verify_buf.resize(BURST_SECTORS*CDIO_CD_FRAMESIZE_RAW/2);
+		i_paranoia_lsn = i_curr_lsn-1;
+	}
+	else
+	{
+		/* paranoia picks up where burst reading stopped */
+		paranoia_seek(p, i_curr_lsn, SEEK_SET);
+	}
+}
+
+/* Burst mode: get up to n (>0) sectors at i_curr_lsn. Once the verified
+   track in burst_buf is used up, the next track is read & verified, or read
+   with paranoia if that fails. Returns a pointer to the sectors and sets n
+   to their number, or NULL at the end of the disc. */
+const int16_t* CSourceCdda::NextBurst_(size_t &n)
+{
+	if (burst_pos==burst_len)
+	{
+		burst_pos = burst_len = 0;
+		if (i_curr_lsn>i_last_lsn) return NULL;
+
+		if (i_curr_lsn>i_paranoia_lsn && !ReadTrack_()) // failed the burst read
+		{
+			std::vector<lsn_t>::iterator it =
+					std::lower_bound(track_last_lsns.begin(), track_last_lsns.end(), i_curr_lsn);
+			i_paranoia_lsn = std::min((it!=track_last_lsns.end()) ? *it : i_last_lsn, i_last_lsn);
+			paranoia_tracks.push_back(it-track_last_lsns.begin()+1);
+			paranoia_seek(p, i_curr_lsn, SEEK_SET);
+		}
+
+		if (i_curr_lsn<=i_paranoia_lsn) // in a track which failed the burst read
+		{
+			int16_t *p_readbuf = paranoia_read(p, NULL);
+			if(!p_readbuf) throw (runtime_error("paranoia read error. Stopping."));
+			i_curr_lsn++;
+			n = 1;
+			return p_readbuf;
+		}
+	}
+
+	n = std::min(n, burst_len-burst_pos);
+	const int16_t *rval = burst_buf.data() + burst_pos*(CDIO_CD_FRAMESIZE_RAW/2);
+	burst_pos += n;
+	return rval;
+}
+
+/* Burst mode: read the rest of the track at i_curr_lsn straight through into
+   burst_buf, then read it a second time and compare. The second pass starts
+   at the sectors which the first pass read longest ago, so a track more than
+   twice as long as the drive cache evicts itself from the cache before the
+   second pass gets to its end. A shorter track is evicted by reading
+   CACHEBUST_SECTORS away from it, once. On success, the track is left in
+   burst_buf and i_curr_lsn is moved past it. Note that cdio returns the raw
+   (little-endian) CD byte order, which matches paranoia's output on
+   little-endian hosts. */
+bool CSourceCdda::ReadTrack_()
+{
+	CdIo_t *cdio = ((cdrom_drive_s*)d)->p_cdio;
+
+	std::vector<lsn_t>::iterator it =
+			std::lower_bound(track_last_lsns.begin(), track_last_lsns.end(), i_curr_lsn);
+	lsn_t last_lsn = std::min((it!=track_last_lsns.end()) ? *it : i_last_lsn, i_last_lsn);
+	size_t len = last_lsn-i_curr_lsn+1;
+	if (len>BURST_MAX_TRACK_SECTORS) return false;
+
+	// first pass
+	burst_buf.resize(len*(CDIO_CD_FRAMESIZE_RAW/2));
+	for (size_t i=0; i<len; i+=BURST_SECTORS)
+	{
+		size_t n = std::min<size_t>(len-i, BURST_SECTORS);
+		if (cdio_read_audio_sectors(cdio, burst_buf.data()+i*(CDIO_CD_FRAMESIZE_RAW/2),
+				i_curr_lsn+i, n)!=DRIVER_OP_SUCCESS)
+			return false;
+	}
+
+	// bust the cache for a short track: read as far away from it as the disc allows
+	if (len<2*CACHEBUST_SECTORS)
+	{
+		lsn_t bust_lsn = (i_curr_lsn<i_last_lsn/2) ? i_last_lsn-CACHEBUST_SECTORS+1 : 0;
+		if (bust_lsn<0) bust_lsn = 0;
+		lsn_t bust_end = std::min<lsn_t>(bust_lsn+CACHEBUST_SECTORS, i_last_lsn+1);
+		for (lsn_t lsn=bust_lsn; lsn<bust_end; lsn+=BURST_SECTORS)
+		{
+			size_t n = std::min<size_t>(bust_end-lsn, BURST_SECTORS);
+			if (cdio_read_audio_sectors(cdio, verify_buf.data(), lsn, n)!=DRIVER_OP_SUCCESS)
+				return false;
+		}
+	}
+
+	// second pass
+	for (size_t i=0; i<len; i+=BURST_SECTORS)
+	{
+		size_t n = std::min<size_t>(len-i, BURST_SECTORS);
+		if (cdio_read_audio_sectors(cdio, verify_buf.data(), i_curr_lsn+i, n)!=DRIVER_OP_SUCCESS
+				|| memcmp(burst_buf.data()+i*(CDIO_CD_FRAMESIZE_RAW/2), verify_buf.data(), n*CDIO_CD_FRAMESIZE_RAW))
+			return false;
+	}
+
+	burst_pos = 0;
+	burst_len = len;
+	i_curr_lsn += len;
+	return true;
 }
 
 /** /brief Fill track info on SCueSheet Cd object
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <cinttypes>
 //#include <sys/types.h>
@@ -40,7 +41,46 @@ public:
     size_t GetLength(cdtimeunit_t units=CDTIMEUNIT_SECTORS) const;
 	
 	const int16_t* ReadNextSector(); /* returns non-NULL until end of CD */
+
+    /**
+     * @brief Read a block of consecutive sectors into a caller-provided buffer
+     * @param[out] buffer with room for nsectors*GetSectorSize() samples
+     * @param[in] maximum number of sectors to read
+     * @return number of sectors read. Less than nsectors only at the end of
+     *         the disc, and 0 if all sectors have been read.
+     */
+    size_t ReadSectors(int16_t *buf, const size_t nsectors);
+
 	void Rewind(); /* rewind to the first sector of the disc*/
+
+    /**
+     * @brief Enable/disable burst read mode (disabled by default).
+     *
+     * In burst mode, each track is read without paranoia straight through
+     * in blocks of multiple sectors, and held in memory until it is verified
+     * by a second pass over the track (long enough, or preceded by a
+     * cache-busting read, to come off the disc rather than from the drive
+     * cache). If the track fails to read or the two passes do not match, the
+     * track is re-read with full paranoia. Burst reading resumes at the
+     * beginning of the next track. The sectors of a track are thus delivered
+     * only after it has been read twice.
+     *
+     * @param[in] true to enable burst mode
+     */
+    void SetBurstMode(const bool enable);
+
+    /**
+     * @brief Get burst read mode
+     * @return true if burst mode is enabled
+     */
+    bool GetBurstMode() const { return burst; }
+
+    /**
+     * @brief Get the tracks which have been re-read with paranoia while in
+     *        burst mode since the last Rewind()
+     * @return a vector of track numbers
+     */
+    const std::vector<int> &GetParanoiaTracks() const { return paranoia_tracks; }
 	
     /**
      * @brief Get a cuesheet object populated with the CD track info
@@ -54,10 +94,22 @@ private:
 
 	lsn_t i_curr_lsn; 			/* current LSN */
 	lsn_t i_last_lsn;				/* last LSN */
-	
+
+	bool burst;						/* true if in burst mode */
+	lsn_t i_paranoia_lsn;			/* burst mode: last LSN to be read with paranoia */
+	std::vector<lsn_t> track_last_lsns;	/* last LSN of each track */
+	std::vector<int> paranoia_tracks;	/* tracks re-read with paranoia */
+	std::vector<int16_t> burst_buf;	/* burst mode: verified track */
+	std::vector<int16_t> verify_buf;	/* burst mode: buffer for the verification pass */
+	size_t burst_pos;				/* burst mode: next sector in burst_buf */
+	size_t burst_len;				/* burst mode: number of sectors in burst_buf */
+
 	void OpenDisc_(const char * path=NULL);
 	void InitParanoia_();
 	void CloseDisc_();
 
+	const int16_t* NextBurst_(size_t &n);
+	bool ReadTrack_();
+
 	
 };
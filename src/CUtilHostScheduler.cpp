@@ -0,0 +1,135 @@
+#include "CUtilHostScheduler.h"
+
+#include <thread>
+#include <algorithm>
+
+// initialize static member variables
+std::mutex CUtilHostScheduler::mutex_hosts;
+CUtilHostScheduler::SchedulerMap CUtilHostScheduler::hosts;
+
+/**
+ * @brief Constructor. The host is not rate limited.
+ */
+CUtilHostScheduler::CUtilHostScheduler() : rate(0.0), burst(1.0), hold(clock::now())
+{
+    std::fill(waiting, waiting+NumberOfHttpPriorities, 0);
+}
+
+/**
+ * @brief Get the scheduler of a host, created on the first request
+ * @param[in] host name (e.g., "musicbrainz.org")
+ * @return the process-wide scheduler of the host
+ */
+std::shared_ptr<CUtilHostScheduler> CUtilHostScheduler::Get(const std::string &host)
+{
+    std::lock_guard<std::mutex> lck(mutex_hosts);
+
+    std::shared_ptr<CUtilHostScheduler> &sched = hosts[host];
+    if (!sched) sched = std::make_shared<CUtilHostScheduler>();
+    return sched;
+}
+
+/**
+ * @brief Change the rate limit. No action if unchanged (so every client
+ *        may set the host's limit without refilling the bucket).
+ * @param[in] number of requests per second (<=0 for unlimited)
+ * @param[in] maximum number of requests in a burst
+ */
+void CUtilHostScheduler::SetRate(const double r, const double b)
+{
+    std::lock_guard<std::mutex> lck(mutex_sched);
+    if (r==rate && b==burst) return;
+
+    rate = r;
+    burst = b;
+    bucket.SetRate(rate, burst);
+}
+
+/**
+ * @brief Register a request waiting for the host
+ * @param[in] priority of the request
+ */
+void CUtilHostScheduler::Enqueue(const HttpPriority priority)
+{
+    std::lock_guard<std::mutex> lck(mutex_sched);
+    waiting[(int)priority]++;
+}
+
+/**
+ * @brief Unregister a waiting request (started or abandoned)
+ * @param[in] priority of the request
+ */
+void CUtilHostScheduler::Dequeue(const HttpPriority priority)
+{
+    std::lock_guard<std::mutex> lck(mutex_sched);
+    waiting[(int)priority]--;
+}
+
+/**
+ * @brief Let a request start if the host permits
+ * @param[in] priority of the request
+ * @return 0 if the request may start, else seconds to wait before trying again
+ */
+double CUtilHostScheduler::TryTake(const HttpPriority priority)
+{
+    std::lock_guard<std::mutex> lck(mutex_sched);
+
+    clock::time_point now = clock::now();
+    if (now<hold) return std::chrono::duration<double>(hold-now).count();
+
+    // the requests of higher priorities go first (if unlimited, they do not
+    // compete for the tokens)
+    if (rate>0.0)
+    {
+        for (int p=0; p<(int)priority; p++)
+            if (waiting[p]>0) return 1.0/rate;
+    }
+
+    return bucket.TryTake();
+}
+
+/**
+ * @brief Wait until a request may start, blocking the calling thread
+ * @param[in] priority of the request
+ */
+void CUtilHostScheduler::Take(const HttpPriority priority)
+{
+    Enqueue(priority);
+
+    double wait;
+    while ((wait = TryTake(priority))>0.0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+
+    Dequeue(priority);
+}
+
+/**
+ * @brief Suspend the requests to the host (e.g., per Retry-After). A
+ *        shorter hold than the current one has no effect.
+ * @param[in] seconds
+ */
+void CUtilHostScheduler::Hold(const double seconds)
+{
+    if (seconds<=0.0) return;
+
+    std::lock_guard<std::mutex> lck(mutex_sched);
+    clock::time_point until = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+    if (until>hold) hold = until;
+}
+
+/**
+ * @brief Apply the request quota reported by the host over a moving
+ *        window (e.g., X-Discogs-Ratelimit-Remaining): no more requests
+ *        than the remaining quota are granted in a burst, and the host is
+ *        held for a request interval once the quota runs out.
+ * @param[in] number of requests allowed per window
+ * @param[in] number of requests remaining in the current window
+ * @param[in] window length in seconds
+ */
+void CUtilHostScheduler::Quota(const long limit, const long remaining, const double window)
+{
+    bucket.Drain(remaining);
+
+    // the oldest request of the window expires in a request interval on average
+    if (remaining<=0) Hold(limit>0 ? window/limit : window);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+#include "CUtilTokenBucket.h"
+
+/**
+ * @brief Priority of HTTP requests to the same host
+ */
+enum class HttpPriority
+{
+    INTERACTIVE,    /// requests a user is waiting on (e.g., disc lookup)
+    BACKGROUND,     /// enrichment (e.g., cover art)
+};
+
+#define NumberOfHttpPriorities 2
+
+/**
+ * @brief Process-wide request scheduler of a host
+ *
+ * All the HTTP transfers of all the CUtilUrl objects to a host go through
+ * its CUtilHostScheduler (see Get()), so the host's limits hold however
+ * many databases and drives access it at once. A request may start when:
+ *
+ * - the host is not on hold (i.e., a Retry-After or a quota reported by the
+ *   server has not run out, see Hold() and Quota()),
+ * - no request of a higher priority is waiting for the host, and
+ * - the host's token bucket (see SetRate()) grants a token.
+ *
+ * Like CUtilTokenBucket, Take() blocks until the request may start, while
+ * TryTake() returns immediately with the time to wait so an event loop
+ * (e.g., curl multi) can schedule the request without blocking. A request
+ * scheduled with TryTake() must be registered with Enqueue() while it
+ * waits, so it keeps the requests of lower priorities behind it.
+ */
+class CUtilHostScheduler
+{
+public:
+    /**
+     * @brief Constructor. The host is not rate limited.
+     */
+    CUtilHostScheduler();
+
+    /**
+     * @brief Get the scheduler of a host, created on the first request
+     * @param[in] host name (e.g., "musicbrainz.org")
+     * @return the process-wide scheduler of the host
+     */
+    static std::shared_ptr<CUtilHostScheduler> Get(const std::string &host);
+
+    /**
+     * @brief Change the rate limit. No action if unchanged (so every client
+     *        may set the host's limit without refilling the bucket).
+     * @param[in] number of requests per second (<=0 for unlimited)
+     * @param[in] maximum number of requests in a burst
+     */
+    void SetRate(const double rate, const double burst=1.0);
+
+    /**
+     * @brief Register a request waiting for the host
+     * @param[in] priority of the request
+     */
+    void Enqueue(const HttpPriority priority);
+
+    /**
+     * @brief Unregister a waiting request (started or abandoned)
+     * @param[in] priority of the request
+     */
+    void Dequeue(const HttpPriority priority);
+
+    /**
+     * @brief Let a request start if the host permits
+     * @param[in] priority of the request
+     * @return 0 if the request may start, else seconds to wait before trying again
+     */
+    double TryTake(const HttpPriority priority);
+
+    /**
+     * @brief Wait until a request may start, blocking the calling thread
+     * @param[in] priority of the request
+     */
+    void Take(const HttpPriority priority);
+
+    /**
+     * @brief Suspend the requests to the host (e.g., per Retry-After). A
+     *        shorter hold than the current one has no effect.
+     * @param[in] seconds
+     */
+    void Hold(const double seconds);
+
+    /**
+     * @brief Apply the request quota reported by the host over a moving
+     *        window (e.g., X-Discogs-Ratelimit-Remaining): no more requests
+     *        than the remaining quota are granted in a burst, and the host is
+     *        held for a request interval once the quota runs out.
+     * @param[in] number of requests allowed per window
+     * @param[in] number of requests remaining in the current window
+     * @param[in] window length in seconds
+     */
+    void Quota(const long limit, const long remaining, const double window);
+
+private:
+    typedef std::chrono::steady_clock clock;
+    typedef std::map<std::string, std::shared_ptr<CUtilHostScheduler>> SchedulerMap;
+
+    std::mutex mutex_sched;
+    double rate;            // current rate limit
+    double burst;           // current burst limit
+    CUtilTokenBucket bucket;
+    int waiting[NumberOfHttpPriorities]; // number of waiting requests per priority
+    clock::time_point hold; // requests are held until
+
+    static std::mutex mutex_hosts;
+    static SchedulerMap hosts; // process-wide schedulers
+};
@@ -0,0 +1,75 @@
+#include "CUtilTokenBucket.h"
+
+#include <thread>
+#include <algorithm>
+
+/**
+ * @brief Constructor. The bucket starts full.
+ * @param[in] refill rate in tokens per second (<=0 for unlimited)
+ * @param[in] bucket capacity (maximum burst, at least 1)
+ */
+CUtilTokenBucket::CUtilTokenBucket(const double r, const double c)
+{
+    SetRate(r, c);
+}
+
+/**
+ * @brief Change the rate and capacity. The bucket is refilled.
+ * @param[in] refill rate in tokens per second (<=0 for unlimited)
+ * @param[in] bucket capacity (maximum burst, at least 1)
+ */
+void CUtilTokenBucket::SetRate(const double r, const double c)
+{
+    std::lock_guard<std::mutex> lck(mutex_tokens);
+    rate = r;
+    capacity = std::max(c, 1.0);
+    tokens = capacity;
+    last = clock::now();
+}
+
+void CUtilTokenBucket::Refill_()
+{
+    clock::time_point now = clock::now();
+    std::chrono::duration<double> elapsed = now - last;
+    tokens = std::min(capacity, tokens + elapsed.count()*rate);
+    last = now;
+}
+
+/**
+ * @brief Consume a token if available
+ * @return 0 if a token is taken, else seconds until the next token
+ */
+double CUtilTokenBucket::TryTake()
+{
+    std::lock_guard<std::mutex> lck(mutex_tokens);
+    if (rate<=0.0) return 0.0;
+
+    Refill_();
+    if (tokens<1.0) return (1.0-tokens)/rate;
+
+    tokens -= 1.0;
+    return 0.0;
+}
+
+/**
+ * @brief Discard the available tokens in excess of a count
+ * @param[in] maximum number of tokens to keep
+ */
+void CUtilTokenBucket::Drain(const double max)
+{
+    std::lock_guard<std::mutex> lck(mutex_tokens);
+    if (rate<=0.0) return;
+
+    Refill_();
+    tokens = std::min(tokens, std::max(max, 0.0));
+}
+
+/**
+ * @brief Consume a token, blocking the calling thread until available
+ */
+void CUtilTokenBucket::Take()
+{
+    double wait;
+    while ((wait = TryTake())>0.0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+
+/**
+ * @brief Thread-safe token bucket rate limiter
+ *
+ * CUtilTokenBucket refills at a fixed rate (tokens per second) up to its
+ * capacity (the largest burst allowed). Each request consumes a token;
+ * Take() blocks until one is available, while TryTake() returns
+ * immediately with the time to wait, so an event loop (e.g., curl multi)
+ * can schedule the request without blocking.
+ */
+class CUtilTokenBucket
+{
+public:
+    /**
+     * @brief Constructor. The bucket starts full.
+     * @param[in] refill rate in tokens per second (<=0 for unlimited)
+     * @param[in] bucket capacity (maximum burst, at least 1)
+     */
+    CUtilTokenBucket(const double rate=0.0, const double capacity=1.0);
+
+    /**
+     * @brief Change the rate and capacity. The bucket is refilled.
+     * @param[in] refill rate in tokens per second (<=0 for unlimited)
+     * @param[in] bucket capacity (maximum burst, at least 1)
+     */
+    void SetRate(const double rate, const double capacity=1.0);
+
+    /**
+     * @brief Consume a token, blocking the calling thread until available
+     */
+    void Take();
+
+    /**
+     * @brief Consume a token if available
+     * @return 0 if a token is taken, else seconds until the next token
+     */
+    double TryTake();
+
+    /**
+     * @brief Discard the available tokens in excess of a count
+     * @param[in] maximum number of tokens to keep
+     */
+    void Drain(const double max);
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    std::mutex mutex_tokens;
+    double rate;        // tokens per second (<=0 for unlimited)
+    double capacity;    // maximum number of tokens
+    double tokens;      // number of available tokens
+    clock::time_point last; // time of the last refill
+
+    /**
+     * @brief Refill the bucket for the time elapsed. Caller must hold mutex_tokens.
+     */
+    void Refill_();
+};
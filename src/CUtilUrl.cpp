@@ -2,15 +2,38 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
 
 using std::string;
+using std::vector;
 using std::mutex;
 using std::runtime_error;
 
+/* largest buffer preallocated from Content-Length (larger data grows the buffer) */
+#define DOWNLOAD_RESERVE_MAX (64<<20)
+
+/* number of attempts of a request throttled by its host (429 or 503) */
+#define HTTP_MAX_ATTEMPTS 4
+
+/* Discogs counts the requests over a 60-second moving window */
+#define DISCOGS_RATELIMIT_WINDOW 60.0
+
+/* seconds to wait for a connection, so an offline station fails fast */
+#define HTTP_CONNECT_TIMEOUT 10L
+
 // initialize static member variables
 int CUtilUrl::Nobjs = 0;
 std::atomic_bool CUtilUrl::AutoCleanUp(true);
 std::mutex CUtilUrl::globalmutex;
+std::shared_ptr<CUtilUrlCache> CUtilUrl::cache;
+CURLSH *CUtilUrl::share = NULL;
+std::mutex CUtilUrl::sharemutexes[CURL_LOCK_DATA_LAST];
 
 /** Constructor.
  *
@@ -18,15 +41,22 @@ std::mutex CUtilUrl::globalmutex;
  *  @param[in] Client program version. If omitted or empty, uses "alpha"
  */
 CUtilUrl::CUtilUrl(const std::string &cname,const std::string &cversion)
+    : priority(HttpPriority::INTERACTIVE)
 {
     // initialize curl object
     globalmutex.lock();
     curl = curl_easy_init();
-    if (curl) Nobjs++;
+    if (curl)
+    {
+        if (!Nobjs) InitShare_();
+        Nobjs++;
+    }
     globalmutex.unlock();
 
     if (!curl) throw(runtime_error("Failed to start a libcurl session."));
 
+    InitHandle_(curl);
+
     // reserve large enough data buffer
     rawdata.reserve(CURL_MAX_WRITE_SIZE);    // reserve memory for receive buffer
 
@@ -36,15 +66,17 @@ CUtilUrl::CUtilUrl(const std::string &cname,const std::string &cversion)
 
     // set user agent
     curl_easy_setopt(curl, CURLOPT_USERAGENT, (cname+"/"+cversion).c_str());
+
+    InitMulti_();
 }
 
 /**
  * @brief Copy Constructor (creates duplicate curl session)
  * @param[in] source
  */
-CUtilUrl::CUtilUrl(const CUtilUrl &src)
+CUtilUrl::CUtilUrl(const CUtilUrl &src) : priority(src.priority)
 {
-    // initialize curl object
+    // initialize curl object (the share pool exists as src does)
     globalmutex.lock();
     curl = curl_easy_duphandle(src.curl);
     if (curl) Nobjs++;
@@ -52,24 +84,37 @@ CUtilUrl::CUtilUrl(const CUtilUrl &src)
 
     if (!curl) throw(runtime_error("Failed to start a libcurl session."));
 
+    InitHandle_(curl);
+
     // reserve large enough data buffer
     rawdata.reserve(CURL_MAX_WRITE_SIZE);    // reserve memory for receive buffer
 
     // use static write_callback as the default write callback function
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CUtilUrl::write_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &rawdata);
+
+    InitMulti_();
+    SetMaxConnections_(src.maxconns);
 }
 
 /** Destructor
  */
 CUtilUrl::~CUtilUrl()
 {
+    for (size_t i=0; i<idle_handles.size(); i++) curl_easy_cleanup(idle_handles[i]);
+    curl_multi_cleanup(multi);
     curl_easy_cleanup(curl);
 
-    // decrement the number of instances and call global cleanup if this is the last object
+    // decrement the number of instances and release the share pool (and
+    // call global cleanup) if this is the last object
     globalmutex.lock();
     Nobjs--;
-    if (!Nobjs && AutoCleanUp) curl_global_cleanup();
+    if (!Nobjs)
+    {
+        if (share) curl_share_cleanup(share);
+        share = NULL;
+        if (AutoCleanUp) curl_global_cleanup();
+    }
     globalmutex.unlock();
 }
 
@@ -85,11 +130,433 @@ void CUtilUrl::PerformHttpTransfer_(const std::string &url)
     // empty the buffer
     rawdata.clear();
 
+    // use the cached response if fresh
+    std::shared_ptr<CUtilUrlCache> urlcache = GetCache();
+    CUtilUrlCache::SEntry entry;
+    curl_slist *reqheaders = NULL;
+    int cached = LookupCache_(urlcache.get(), url, entry, reqheaders);
+    if (cached>0)
+    {
+        rawdata.swap(entry.data);
+        return;
+    }
+
+    SHttpHeaders headers;
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    CURLcode res = curl_easy_perform(curl);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, reqheaders);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, CUtilUrl::header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
+
+    // wait for the host's turn, and try again if the host is throttling
+    std::shared_ptr<CUtilHostScheduler> sched = GetScheduler_(url);
+    CURLcode res;
+    int attempts = 0;
+    do
+    {
+        sched->Take(priority);
+        rawdata.clear();
+        headers = SHttpHeaders();
+        res = curl_easy_perform(curl);
+    } while (res==CURLE_OK && Throttled_(*sched, headers, ++attempts));
+
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+    curl_slist_free_all(reqheaders);
 
     /* Check for errors */
     if(res != CURLE_OK) throw(std::runtime_error(curl_easy_strerror(res)));
+
+    if (UpdateCache_(urlcache.get(), curl, url, rawdata, headers, cached==0))
+        rawdata.swap(entry.data);
+}
+
+/**
+ * @brief Set the process-wide HTTP response cache, used by all the
+ *        CUtilUrl objects
+ * @param[in] cache (nullptr to disable caching)
+ */
+void CUtilUrl::SetCache(const std::shared_ptr<CUtilUrlCache> &newcache)
+{
+    std::lock_guard<std::mutex> lck(globalmutex);
+    cache = newcache;
+}
+
+/**
+ * @brief Get the process-wide HTTP response cache
+ * @return cache (nullptr if caching is disabled)
+ */
+std::shared_ptr<CUtilUrlCache> CUtilUrl::GetCache()
+{
+    std::lock_guard<std::mutex> lck(globalmutex);
+    return cache;
+}
+
+int CUtilUrl::LookupCache_(CUtilUrlCache *urlcache, const std::string &url,
+                           CUtilUrlCache::SEntry &entry, curl_slist *&reqheaders)
+{
+    reqheaders = NULL;
+    if (!urlcache || !urlcache->Lookup(url, entry)) return -1;
+    if (urlcache->Fresh(entry)) return 1;
+
+    // stale: ask the server if it has been modified
+    if (entry.etag.size())
+        reqheaders = curl_slist_append(reqheaders, ("If-None-Match: "+entry.etag).c_str());
+    if (entry.lastmod.size())
+        reqheaders = curl_slist_append(reqheaders, ("If-Modified-Since: "+entry.lastmod).c_str());
+    return 0;
+}
+
+bool CUtilUrl::UpdateCache_(CUtilUrlCache *urlcache, CURL *handle, const std::string &url,
+                            const std::string &data, const SHttpHeaders &headers, const bool revalidated)
+{
+    if (!urlcache) return false;
+
+    long code = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &code);
+
+    if (code==304 && revalidated) // not modified, keep using the cached data
+    {
+        urlcache->Refresh(url);
+        return true;
+    }
+
+    if (code==200) urlcache->Store(url, data, headers.etag, headers.lastmod);
+    return false;
+}
+
+void CUtilUrl::InitMulti_()
+{
+    multi = curl_multi_init();
+    if (!multi)
+    {
+        curl_easy_cleanup(curl);
+        throw(runtime_error("Failed to start a libcurl multi session."));
+    }
+    SetMaxConnections_(4);
+
+    // run concurrent transfers to an HTTP/2 host as streams of one connection
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+}
+
+void CUtilUrl::InitShare_()
+{
+    share = curl_share_init();
+    if (!share) return; // not fatal, each handle keeps its own caches
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, CUtilUrl::share_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, CUtilUrl::share_unlock);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+void CUtilUrl::InitHandle_(CURL *handle)
+{
+    if (share) curl_easy_setopt(handle, CURLOPT_SHARE, share);
+
+    // negotiate HTTP/2 over TLS, and let a transfer wait for an existing
+    // HTTP/2 connection to multiplex on rather than opening a new one
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+
+    // keep the idle connections alive between the requests
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, HTTP_CONNECT_TIMEOUT);
+}
+
+void CUtilUrl::share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+    sharemutexes[data].lock();
+}
+
+void CUtilUrl::share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+    sharemutexes[data].unlock();
+}
+
+/**
+ * @brief Set the maximum number of concurrent connections per host for
+ *        PerformHttpTransfers_()
+ * @param[in] number of connections (default: 4)
+ */
+void CUtilUrl::SetMaxConnections_(const long n)
+{
+    maxconns = std::max(n, 1L);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, maxconns);
+}
+
+/**
+ * @brief Limit the rate of the requests to a host. The limit is
+ *        process-wide: it applies to the transfers of all the CUtilUrl
+ *        objects.
+ * @param[in] host name (e.g., "musicbrainz.org")
+ * @param[in] number of requests per second (<=0 to remove the limit)
+ * @param[in] maximum number of requests in a burst
+ */
+void CUtilUrl::SetRateLimit_(const std::string &host, const double rate, const double burst)
+{
+    CUtilHostScheduler::Get(host)->SetRate(std::max(rate, 0.0), burst);
+}
+
+std::shared_ptr<CUtilHostScheduler> CUtilUrl::GetScheduler_(const std::string &url)
+{
+    return CUtilHostScheduler::Get(HostName_(url));
+}
+
+bool CUtilUrl::Throttled_(CUtilHostScheduler &sched, const SHttpHeaders &headers, const int attempts)
+{
+    if (headers.quota>=0 && headers.remaining>=0)
+        sched.Quota(headers.quota, headers.remaining, DISCOGS_RATELIMIT_WINDOW);
+
+    if (headers.status!=429 && headers.status!=503) return false;
+
+    // hold the host as told, else back off for 1, 2, 4... seconds
+    sched.Hold(headers.retryafter>=0.0 ? headers.retryafter : (double)(1<<(attempts-1)));
+    return attempts<HTTP_MAX_ATTEMPTS;
+}
+
+/**
+ * @brief Extract the host name of a URL
+ * @param[in] URL
+ * @return host name (empty if not found)
+ */
+std::string CUtilUrl::HostName_(const std::string &url)
+{
+    size_t pos = url.find("://");
+    pos = (pos==url.npos) ? 0 : pos+3;
+
+    // skip user info
+    size_t end = url.find_first_of("/?#", pos);
+    size_t at = url.find('@', pos);
+    if (at<end) pos = at+1;
+
+    end = url.find_first_of(":/?#", pos);
+    return url.substr(pos, end==url.npos ? url.npos : end-pos);
+}
+
+/**
+ * @brief Perform multiple HTTP transfers concurrently
+ * @param[in] URLs of the other endpoints
+ * @param[out] received data, one per URL in the same order (empty if
+ *             streamed)
+ * @param[in] true to follow HTTP redirects
+ * @param[in] stream functions, one per URL in the same order (an empty
+ *            function or vector to store the data)
+ * @throw runtime_error if any of the transfers failed
+ * @throw exception thrown by a stream function
+ */
+void CUtilUrl::PerformHttpTransfers_(const std::vector<std::string> &urls,
+                                     std::vector<std::string> &data, const bool follow,
+                                     const std::vector<HttpStreamFunc> &funcs)
+{
+    size_t nurls = urls.size();
+    data.assign(nurls, string());
+
+    // per-transfer cache states
+    std::shared_ptr<CUtilUrlCache> urlcache = GetCache();
+    vector<CUtilUrlCache::SEntry> entries(nurls);
+    vector<curl_slist*> reqheaders(nurls, (curl_slist*)NULL);
+    vector<int> cached(nurls, -1);
+
+    // streamed transfers keep their data only if to be cached
+    vector<STransfer> transfers(nurls);
+    vector<string> bodies(urlcache ? nurls : 0);
+    for (size_t i=0; i<nurls; i++)
+    {
+        bool streamed = i<funcs.size() && funcs[i];
+        transfers[i].func = streamed ? &funcs[i] : NULL;
+        transfers[i].data = !streamed ? &data[i] : urlcache ? &bodies[i] : NULL;
+    }
+
+    // pass the cached data to the stream function
+    auto deliver = [&](const size_t i, string &body)
+    {
+        if (!transfers[i].func) data[i].swap(body);
+        else
+        {
+            try
+            {
+                (*transfers[i].func)(body.data(), body.size());
+            }
+            catch (...)
+            {
+                transfers[i].error = std::current_exception();
+            }
+        }
+    };
+
+    size_t next = 0;    // next transfer to start
+    std::deque<size_t> retries; // throttled transfers to start again (ahead of next)
+    int nactive = 0;    // number of transfers in progress
+    CURLcode res = CURLE_OK; // first error
+    while (next<nurls || retries.size() || nactive)
+    {
+        // start the transfers as their hosts' schedulers permit; the
+        // connection limit is enforced by multi, which queues the excess
+        // transfers internally
+        long timeout = 1000; // ms
+        while (next<nurls || retries.size())
+        {
+            size_t i = retries.size() ? retries.front() : next;
+            STransfer &transfer = transfers[i];
+
+            // use the cached response if fresh
+            if (!transfer.sched)
+            {
+                cached[i] = LookupCache_(urlcache.get(), urls[i], entries[i], reqheaders[i]);
+                if (cached[i]>0)
+                {
+                    deliver(i, entries[i].data);
+                    next++;
+                    continue;
+                }
+                transfer.sched = GetScheduler_(urls[i]);
+            }
+
+            // wait in the host's queue, keeping the requests of lower
+            // priorities behind
+            double wait = transfer.sched->TryTake(priority);
+            if (wait>0.0)
+            {
+                if (!transfer.queued) transfer.sched->Enqueue(priority);
+                transfer.queued = true;
+                timeout = std::min(timeout, (long)(wait*1000.0)+1);
+                break;
+            }
+            if (transfer.queued) transfer.sched->Dequeue(priority);
+            transfer.queued = false;
+
+            // reuse an easy handle (and its connections) if available
+            CURL *handle;
+            if (idle_handles.size())
+            {
+                handle = idle_handles.back();
+                idle_handles.pop_back();
+            }
+            else
+            {
+                handle = curl_easy_duphandle(curl);
+                if (!handle)
+                {
+                    curl_slist_free_all(reqheaders[i]);
+                    reqheaders[i] = NULL;
+                    res = CURLE_OUT_OF_MEMORY;
+                    next = nurls; // give up the rest
+                    retries.clear();
+                    break;
+                }
+                InitHandle_(handle);
+            }
+
+            transfer.headers = SHttpHeaders();
+            transfer.attempts++;
+            curl_easy_setopt(handle, CURLOPT_URL, urls[i].c_str());
+            curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, CUtilUrl::write_transfer_callback);
+            curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer);
+            curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, follow ? 1L : 0L);
+            curl_easy_setopt(handle, CURLOPT_HTTPHEADER, reqheaders[i]);
+            curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, CUtilUrl::header_callback);
+            curl_easy_setopt(handle, CURLOPT_HEADERDATA, &transfer.headers);
+            curl_easy_setopt(handle, CURLOPT_PRIVATE, &transfer);
+            curl_multi_add_handle(multi, handle);
+
+            if (retries.size()) retries.pop_front();
+            else next++;
+            nactive++;
+        }
+
+        // run the transfers & wait for activity
+        int nrunning;
+        curl_multi_perform(multi, &nrunning);
+
+        // collect the completed transfers
+        CURLMsg *msg;
+        int nmsgs;
+        while ((msg = curl_multi_info_read(multi, &nmsgs)))
+        {
+            if (msg->msg!=CURLMSG_DONE) continue;
+
+            // identify the transfer by its state
+            char *priv;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+            size_t i = (STransfer*)priv - transfers.data();
+
+            // (a stream function exception aborts the transfer with a write error)
+            if (msg->data.result!=CURLE_OK && res==CURLE_OK && !transfers[i].error) res = msg->data.result;
+
+            // throttled by the host: start again once the host permits (the
+            // response body has been discarded)
+            bool retry = msg->data.result==CURLE_OK
+                    && Throttled_(*transfers[i].sched, transfers[i].headers, transfers[i].attempts);
+
+            if (retry)
+            {
+                retries.push_back(i);
+            }
+            else if (msg->data.result==CURLE_OK)
+            {
+                string empty;
+                const string &body = transfers[i].data ? *transfers[i].data : empty;
+                if (UpdateCache_(urlcache.get(), msg->easy_handle, urls[i], body, transfers[i].headers, cached[i]==0))
+                    deliver(i, entries[i].data);
+            }
+
+            curl_multi_remove_handle(multi, msg->easy_handle);
+            curl_easy_setopt(msg->easy_handle, CURLOPT_HTTPHEADER, NULL);
+            if (!retry)
+            {
+                curl_slist_free_all(reqheaders[i]);
+                reqheaders[i] = NULL;
+            }
+            idle_handles.push_back(msg->easy_handle);
+            nactive--;
+        }
+
+        // (curl_multi_wait returns immediately if there is no transfer to wait for)
+        if (nactive)
+            curl_multi_wait(multi, NULL, 0, timeout, NULL);
+        else if (next<nurls || retries.size())
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    }
+
+    // leave the hosts' queues (if gave up)
+    for (size_t i=0; i<nurls; i++)
+    {
+        if (transfers[i].queued) transfers[i].sched->Dequeue(priority);
+        curl_slist_free_all(reqheaders[i]);
+    }
+
+    /* Check for errors */
+    if(res != CURLE_OK) throw(std::runtime_error(curl_easy_strerror(res)));
+    for (size_t i=0; i<nurls; i++)
+        if (transfers[i].error) std::rethrow_exception(transfers[i].error);
+}
+
+size_t CUtilUrl::write_transfer_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    size *= nmemb;
+    STransfer &transfer = *(STransfer*)userdata;
+
+    // discard the body of a response to be retried
+    if ((transfer.headers.status==429 || transfer.headers.status==503) && transfer.attempts<HTTP_MAX_ATTEMPTS)
+        return size;
+
+    if (transfer.func)
+    {
+        // exceptions must not propagate through libcurl; a short count aborts
+        try
+        {
+            (*transfer.func)(ptr, size);
+        }
+        catch (...)
+        {
+            transfer.error = std::current_exception();
+            return 0;
+        }
+    }
+    if (transfer.data) transfer.data->append(ptr, size);
+    return size;
 }
 
 /**
@@ -104,6 +571,7 @@ size_t CUtilUrl::GetHttpContentLength_(const std::string &url) const
     // set so only header is returned
     curl_easy_setopt(curl, CURLOPT_NOBODY, 1);
 
+    GetScheduler_(url)->Take(priority);
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_perform(curl);
     curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &size);
@@ -130,6 +598,52 @@ size_t CUtilUrl::write_callback(char *ptr, size_t size, size_t nmemb, void *user
     return size;
 }
 
+size_t CUtilUrl::header_callback(char *buffer, size_t size, size_t nitems, void *userdata)
+{
+    size *= nitems;
+    SHttpHeaders &headers = *(SHttpHeaders*)userdata;
+    string line(buffer, size);
+
+    // strip the line ending
+    size_t end = line.find_last_not_of("\r\n");
+    line.erase(end==line.npos ? 0 : end+1);
+
+    size_t colon = line.find(':');
+    if (line.compare(0, 5, "HTTP/")==0) // new response (e.g., after redirect)
+    {
+        headers = SHttpHeaders();
+
+        size_t pos = line.find(' ');
+        if (pos!=line.npos) headers.status = strtol(line.c_str()+pos, NULL, 10);
+    }
+    else if (colon!=line.npos)
+    {
+        string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+        size_t pos = line.find_first_not_of(" \t", colon+1);
+        string value = (pos==line.npos) ? string() : line.substr(pos);
+
+        if (name.compare("etag")==0) headers.etag = value;
+        else if (name.compare("last-modified")==0) headers.lastmod = value;
+        else if (name.compare("content-length")==0) headers.length = strtoull(value.c_str(), NULL, 10);
+        else if (name.compare("x-discogs-ratelimit")==0) headers.quota = strtol(value.c_str(), NULL, 10);
+        else if (name.compare("x-discogs-ratelimit-remaining")==0) headers.remaining = strtol(value.c_str(), NULL, 10);
+        else if (name.compare("retry-after")==0 && value.size())
+        {
+            // either in seconds or an HTTP date
+            if (isdigit((unsigned char)value[0])) headers.retryafter = strtod(value.c_str(), NULL);
+            else
+            {
+                time_t date = curl_getdate(value.c_str(), NULL);
+                if (date>=0) headers.retryafter = std::max(difftime(date, time(NULL)), 0.0);
+            }
+        }
+    }
+
+    return size;
+}
+
 size_t CUtilUrl::write_uchar_vector_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
     size *= nmemb;
@@ -148,28 +662,115 @@ size_t CUtilUrl::write_uchar_vector_callback(char *ptr, size_t size, size_t nmem
  */
 UByteVector CUtilUrl::DataToMemory(const std::string &url)
 {
-    UByteVector data;
-    size_t size;
+    SDownloadBuffer buffer;
 
     if (url.size()) // if URL is an empty string, return empty vector
     {
-        // get the image file size
-        size = GetHttpContentLength_(url);
-        if (size>0) data.reserve(size);
+        // use the cached data if fresh
+        std::shared_ptr<CUtilUrlCache> urlcache = GetCache();
+        CUtilUrlCache::SEntry entry;
+        if (urlcache && urlcache->Lookup(url, entry) && urlcache->Fresh(entry))
+            return UByteVector(entry.data.begin(), entry.data.end());
 
-        // set imdata as the download buffer
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CUtilUrl::write_uchar_vector_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &data);
+        // single GET; the buffer is sized from Content-Length as the body arrives
+        Download_(url, CUtilUrl::write_download_callback, &buffer, buffer.headers);
 
-        // perform the HTTP transaction
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        CURLcode res = curl_easy_perform(curl);
-        if(res != CURLE_OK) throw(std::runtime_error(curl_easy_strerror(res)));
+        if (urlcache) UpdateCache_(urlcache.get(), curl, url, string(buffer.data.begin(), buffer.data.end()), buffer.headers, false);
+    }
 
-        // reset the download buffer
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CUtilUrl::write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &rawdata);
+    return std::move(buffer.data);
+}
+
+/**
+ * @brief Download the (binary) data from URL and write it to a file as it
+ *        is received
+ * @param[in] URL
+ * @param[in] output file path (created or truncated)
+ * @return number of bytes written
+ * @throw runtime_error if curl fails to retrieve the data or failed to
+ *        write the file
+ */
+size_t CUtilUrl::DataToFile(const std::string &url, const std::string &path)
+{
+    // use the cached data if fresh
+    std::shared_ptr<CUtilUrlCache> urlcache = GetCache();
+    CUtilUrlCache::SEntry entry;
+    bool cached = urlcache && urlcache->Lookup(url, entry) && urlcache->Fresh(entry);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) throw(runtime_error("Could not open the output file."));
+
+    size_t nbytes = 0;
+    try
+    {
+        if (cached)
+        {
+            if (fwrite(entry.data.data(), 1, entry.data.size(), file)!=entry.data.size())
+                throw(runtime_error("Failed to write to the output file."));
+            nbytes = entry.data.size();
+        }
+        else
+        {
+            SHttpHeaders headers;
+            Download_(url, CUtilUrl::write_file_callback, file, headers);
+            nbytes = ftell(file);
+        }
+    }
+    catch (...)
+    {
+        fclose(file);
+        remove(path.c_str());
+        throw;
     }
 
-    return data;
+    if (fclose(file))
+    {
+        remove(path.c_str());
+        throw(runtime_error("Failed to write to the output file."));
+    }
+    return nbytes;
+}
+
+void CUtilUrl::Download_(const std::string &url, curl_write_callback func, void *userdata, SHttpHeaders &headers)
+{
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, func);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, userdata);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, CUtilUrl::header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
+
+    // perform the HTTP transaction in the host's turn (the data is passed
+    // on as it arrives, so a throttled request is not retried)
+    std::shared_ptr<CUtilHostScheduler> sched = GetScheduler_(url);
+    sched->Take(priority);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    CURLcode res = curl_easy_perform(curl);
+    if (res==CURLE_OK) Throttled_(*sched, headers, 1);
+
+    // reset the download buffer
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CUtilUrl::write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &rawdata);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+
+    if(res != CURLE_OK) throw(std::runtime_error(curl_easy_strerror(res)));
+}
+
+size_t CUtilUrl::write_download_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    size *= nmemb;
+    SDownloadBuffer &buffer = *(SDownloadBuffer*)userdata;
+
+    // size the buffer once from Content-Length (capped, as it is untrusted);
+    // otherwise, vector grows geometrically
+    if (buffer.data.empty() && buffer.headers.length>buffer.data.capacity())
+        buffer.data.reserve(std::min(buffer.headers.length, (size_t)DOWNLOAD_RESERVE_MAX));
+
+    buffer.data.insert(buffer.data.end(), (unsigned char*)ptr, (unsigned char*)ptr+size);
+    return size;
+}
+
+size_t CUtilUrl::write_file_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    // short count aborts the transfer
+    return fwrite(ptr, size, nmemb, (FILE*)userdata)*size;
 }
@@ -4,11 +4,43 @@
 #include <atomic>
 #include <mutex>
 #include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <exception>
 #include <curl/curl.h>
 
+#include "CUtilHostScheduler.h"
+#include "CUtilUrlCache.h"
+
 typedef std::vector<unsigned char> UByteVector;
 
+/**
+ * @brief Function to receive the body of an HTTP transfer as it arrives
+ * @param[in] received data
+ * @param[in] size of the data in bytes
+ * @throw any exception to abort the transfer
+ */
+typedef std::function<void(const char *data, const size_t size)> HttpStreamFunc;
+
 /** Abstract base Database class with libcurl object
+ *
+ *  All the curl handles of all the CUtilUrl objects share a process-wide
+ *  curl share pool, so the DNS lookups and the TLS sessions are cached
+ *  across the databases. Each object reuses its own connections: those of
+ *  its easy handle for PerformHttpTransfer_(), and those of its multi handle
+ *  for PerformHttpTransfers_() (libcurl does not support sharing the
+ *  connections among the handles used on concurrent threads). HTTP/2 is
+ *  negotiated with HTTPS servers, and the concurrent transfers to an HTTP/2
+ *  server are multiplexed over a single connection.
+ *
+ *  Every transfer waits for its turn on the process-wide scheduler of its
+ *  host (see CUtilHostScheduler), which enforces the host's rate limit (see
+ *  SetRateLimit_()) and puts the object's requests behind those of higher
+ *  priorities (see SetPriority_()). A host responding "429 Too Many
+ *  Requests" or "503 Service Unavailable" is held for its Retry-After (or
+ *  an increasing backoff) and the request is retried, and the Discogs
+ *  request quota (X-Discogs-Ratelimit-Remaining) is applied to its host.
  */
 class CUtilUrl
 {
@@ -42,6 +74,19 @@ public:
      */
     static void SetAutoCleanUpMode(const bool mode) { AutoCleanUp = mode; }
 
+    /**
+     * @brief Set the process-wide HTTP response cache, used by all the
+     *        CUtilUrl objects
+     * @param[in] cache (nullptr to disable caching)
+     */
+    static void SetCache(const std::shared_ptr<CUtilUrlCache> &cache);
+
+    /**
+     * @brief Get the process-wide HTTP response cache
+     * @return cache (nullptr if caching is disabled)
+     */
+    static std::shared_ptr<CUtilUrlCache> GetCache();
+
 protected:
     CURL *curl; // pointer to the curl session
     std::string rawdata; // received data buffer
@@ -55,6 +100,62 @@ protected:
      */
     virtual void PerformHttpTransfer_(const std::string &url);
 
+    /**
+     * @brief Perform multiple HTTP transfers concurrently
+     *
+     * The transfers are run on a curl multi handle owned by the object, so
+     * the connections are kept alive across calls. No more than the maximum
+     * number of transfers per host (see SetMaxConnections_()) run at a time,
+     * and each transfer starts only after the scheduler of its host grants
+     * it. rawdata is left untouched.
+     *
+     * A transfer with a stream function passes the body to the function as
+     * it arrives instead of storing it (e.g., to parse it on the fly).
+     *
+     * @param[in] URLs of the other endpoints
+     * @param[out] received data, one per URL in the same order (empty if
+     *             streamed)
+     * @param[in] true to follow HTTP redirects
+     * @param[in] stream functions, one per URL in the same order (an empty
+     *            function or vector to store the data)
+     * @throw runtime_error if any of the transfers failed
+     * @throw exception thrown by a stream function
+     */
+    virtual void PerformHttpTransfers_(const std::vector<std::string> &urls,
+                                       std::vector<std::string> &data, const bool follow=false,
+                                       const std::vector<HttpStreamFunc> &funcs=std::vector<HttpStreamFunc>());
+
+    /**
+     * @brief Limit the rate of the requests to a host. The limit is
+     *        process-wide: it applies to the transfers of all the CUtilUrl
+     *        objects.
+     * @param[in] host name (e.g., "musicbrainz.org")
+     * @param[in] number of requests per second (<=0 to remove the limit)
+     * @param[in] maximum number of requests in a burst
+     */
+    static void SetRateLimit_(const std::string &host, const double rate, const double burst=1.0);
+
+    /**
+     * @brief Set the priority of the object's requests against those of the
+     *        other objects to the same host
+     * @param[in] priority (default: HttpPriority::INTERACTIVE)
+     */
+    void SetPriority_(const HttpPriority p) { priority = p; }
+
+    /**
+     * @brief Set the maximum number of concurrent connections per host for
+     *        PerformHttpTransfers_()
+     * @param[in] number of connections (default: 4)
+     */
+    void SetMaxConnections_(const long n);
+
+    /**
+     * @brief Extract the host name of a URL
+     * @param[in] URL
+     * @return host name (empty if not found)
+     */
+    static std::string HostName_(const std::string &url);
+
     /**
      * @brief Get the length of remote content
      * @param[in] URL of the remote content
@@ -71,6 +172,17 @@ protected:
      */
     virtual UByteVector DataToMemory(const std::string &url);
 
+    /**
+     * @brief Download the (binary) data from URL and write it to a file as it
+     *        is received
+     * @param[in] URL
+     * @param[in] output file path (created or truncated)
+     * @return number of bytes written
+     * @throw runtime_error if curl fails to retrieve the data or failed to
+     *        write the file
+     */
+    virtual size_t DataToFile(const std::string &url, const std::string &path);
+
     /** Default callback for writing received HTTP data
      *
      * @param[in]   Points to the delivered data
@@ -90,7 +202,155 @@ protected:
      */
     static size_t write_uchar_vector_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
 
+    /**
+     * @brief Response header fields of interest
+     */
+    struct SHttpHeaders
+    {
+        std::string etag;       // ETag
+        std::string lastmod;    // Last-Modified
+        size_t length;          // Content-Length (0 if not given)
+        long status;            // status code (0 if not received)
+        double retryafter;      // Retry-After in seconds (<0 if not given)
+        long quota;             // X-Discogs-Ratelimit (<0 if not given)
+        long remaining;         // X-Discogs-Ratelimit-Remaining (<0 if not given)
+
+        SHttpHeaders() : length(0), status(0), retryafter(-1.0), quota(-1), remaining(-1) {}
+    };
+
+    /** Callback for parsing received HTTP headers into SHttpHeaders
+     *
+     * @param[in]   Points to the delivered header line
+     * @param[in]   The actual size of that data in byte is size multiplied with nitems
+     * @param[in]   See above
+     * @param[out]  SHttpHeaders object
+     * @return      The number of bytes actually taken care of
+     */
+    static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata);
+
 private:
+    /**
+     * @brief State of a transfer of PerformHttpTransfers_()
+     */
+    struct STransfer
+    {
+        SHttpHeaders headers;       // received response headers
+        std::string *data;          // received data buffer (NULL if not kept)
+        const HttpStreamFunc *func; // stream function (NULL if not streamed)
+        std::exception_ptr error;   // exception thrown by func
+        std::shared_ptr<CUtilHostScheduler> sched; // scheduler of the host
+        bool queued;                // true if registered as waiting to sched
+        int attempts;               // number of attempts made
+
+        STransfer() : data(NULL), func(NULL), queued(false), attempts(0) {}
+    };
+
+    /** Callback for passing received HTTP data to STransfer
+     */
+    static size_t write_transfer_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+    /**
+     * @brief Download buffer of DataToMemory()
+     */
+    struct SDownloadBuffer
+    {
+        SHttpHeaders headers;
+        UByteVector data;
+    };
+
+    /**
+     * @brief Perform a GET on the object's easy handle, passing the body to
+     *        the given write callback
+     * @param[in] URL
+     * @param[in] write callback
+     * @param[in] write callback data
+     * @param[out] received response headers
+     * @throw runtime_error if curl fails to retrieve the data
+     */
+    void Download_(const std::string &url, curl_write_callback func, void *userdata, SHttpHeaders &headers);
+
+    /** Callback for writing received HTTP data to SDownloadBuffer, which
+     *  preallocates the buffer from Content-Length
+     */
+    static size_t write_download_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+    /** Callback for writing received HTTP data to a FILE stream
+     */
+    static size_t write_file_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+    CURLM *multi; // multi handle for the concurrent transfers
+    std::vector<CURL*> idle_handles; // easy handles to be reused by multi
+    long maxconns; // maximum number of concurrent connections per host
+    HttpPriority priority; // priority of the requests
+
+    /**
+     * @brief Initialize the multi handle (shared by the constructors)
+     */
+    void InitMulti_();
+
+    /**
+     * @brief Create the process-wide share pool (globalmutex must be locked)
+     */
+    static void InitShare_();
+
+    /**
+     * @brief Set the common options of an easy handle (share pool, HTTP/2)
+     * @param[in] easy handle
+     */
+    static void InitHandle_(CURL *handle);
+
+    /**
+     * @brief Share pool lock callbacks
+     */
+    static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr);
+    static void share_unlock(CURL *handle, curl_lock_data data, void *userptr);
+
+    /**
+     * @brief Get the scheduler of the URL's host
+     * @param[in] URL
+     * @return the process-wide scheduler of the host
+     */
+    static std::shared_ptr<CUtilHostScheduler> GetScheduler_(const std::string &url);
+
+    /**
+     * @brief Apply the response's Retry-After and request quota to the
+     *        scheduler of its host
+     * @param[in] scheduler of the host
+     * @param[in] received response headers
+     * @param[in] number of attempts made
+     * @return true if the host is throttling the request (i.e., to retry)
+     */
+    static bool Throttled_(CUtilHostScheduler &sched, const SHttpHeaders &headers, const int attempts);
+
+    /**
+     * @brief Look up the response cache before a transfer
+     * @param[in] cache (may be NULL)
+     * @param[in] URL
+     * @param[out] cached entry (if found)
+     * @param[out] conditional request headers to revalidate a stale entry
+     * @return 1 if a fresh entry is found, 0 if a stale entry is found, -1 if not found
+     */
+    static int LookupCache_(CUtilUrlCache *urlcache, const std::string &url,
+                            CUtilUrlCache::SEntry &entry, curl_slist *&reqheaders);
+
+    /**
+     * @brief Update the response cache after a transfer
+     * @param[in] cache (may be NULL)
+     * @param[in] completed easy handle
+     * @param[in] URL
+     * @param[in] received data
+     * @param[in] received response headers
+     * @param[in] true if a stale entry was revalidated
+     * @return true if the server confirmed the stale entry (i.e., "304 Not Modified")
+     */
+    static bool UpdateCache_(CUtilUrlCache *urlcache, CURL *handle, const std::string &url,
+                             const std::string &data, const SHttpHeaders &headers, const bool revalidated);
+
+    static std::shared_ptr<CUtilUrlCache> cache; /// process-wide response cache (protected by globalmutex)
+
+    static CURLSH *share; /// process-wide share pool (DNS & TLS session caches)
+    static std::mutex sharemutexes[CURL_LOCK_DATA_LAST]; /// share pool locks, one per data type
+
     static std::mutex globalmutex; /// mutex to make curl_global_init and curl_global_cleanup thread safe
     static int Nobjs; /// number of instantiated CUtilUrl objects
     static std::atomic_bool AutoCleanUp;    /// if true (default)
@@ -0,0 +1,375 @@
+#include "CUtilUrlCache.h"
+
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "utils.h"
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+using std::lock_guard;
+using std::mutex;
+
+/* on-disk index record */
+struct SIndexRecord
+{
+    uint64_t key;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t reserved;
+    int64_t stored;
+};
+
+/* on-disk data record header, followed by URL, ETag, Last-Modified, & body */
+struct SDataHeader
+{
+    uint32_t urllen;
+    uint32_t etaglen;
+    uint32_t lastmodlen;
+    uint32_t datalen;
+};
+
+/* write all or throw */
+static void write_all(int fd, const void *buf, size_t n, off_t offset)
+{
+    const char *p = (const char*)buf;
+    while (n)
+    {
+        ssize_t bcount = pwrite(fd, p, n, offset);
+        if (bcount<0)
+        {
+            if (errno==EINTR) continue;
+            throw(runtime_error("Failed to write to the URL cache."));
+        }
+        p += bcount;
+        n -= bcount;
+        offset += bcount;
+    }
+}
+
+/**
+ * @brief Constructor. Opens (or creates) the cache in a directory.
+ * @param[in] cache directory (created if not exists)
+ * @param[in] time-to-live of the entries in seconds
+ * @param[in] size cap of the data file in bytes
+ * @throw runtime_error if failed to open the cache files
+ */
+CUtilUrlCache::CUtilUrlCache(const std::string &d, const time_t t, const uint64_t m)
+    : dir(d), fd_lock(-1), fd_data(-1), fd_index(-1), datasize(0), indexsize(0), ttl(t), maxsize(m)
+{
+    mkdir(dir.c_str(), 0755); // fails if exists
+
+    fd_lock = open((dir+"/cache.lck").c_str(), O_RDWR|O_CREAT, 0644);
+    if (fd_lock<0) throw(runtime_error("Could not open the URL cache."));
+
+    try
+    {
+        SFileLock flck(fd_lock, LOCK_EX);
+        Open_();
+
+        // drop a partially written last index record (e.g., after a crash)
+        if (ftruncate(fd_index, indexsize)) {}
+    }
+    catch (...)
+    {
+        close(fd_lock);
+        throw;
+    }
+}
+
+CUtilUrlCache::~CUtilUrlCache()
+{
+    Close_();
+    close(fd_lock);
+}
+
+void CUtilUrlCache::Open_()
+{
+    fd_data = open((dir+"/cache.dat").c_str(), O_RDWR|O_CREAT, 0644);
+    fd_index = open((dir+"/cache.idx").c_str(), O_RDWR|O_CREAT, 0644);
+    if (fd_data<0 || fd_index<0)
+    {
+        Close_();
+        throw(runtime_error("Could not open the URL cache."));
+    }
+
+    index.clear();
+    datasize = indexsize = 0;
+    LoadIndex_();
+}
+
+void CUtilUrlCache::Close_()
+{
+    if (fd_data>=0) close(fd_data);
+    if (fd_index>=0) close(fd_index);
+    fd_data = fd_index = -1;
+}
+
+void CUtilUrlCache::Sync_()
+{
+    // compacted by another process
+    if (file_replaced(dir+"/cache.dat", fd_data) || file_replaced(dir+"/cache.idx", fd_index))
+    {
+        Close_();
+        Open_();
+        return;
+    }
+
+    // cleared by another process
+    struct stat st;
+    if (!fstat(fd_index, &st) && (uint64_t)st.st_size<indexsize)
+    {
+        index.clear();
+        indexsize = 0;
+    }
+
+    LoadIndex_();
+}
+
+void CUtilUrlCache::LoadIndex_()
+{
+    struct stat st;
+    if (!fstat(fd_data, &st)) datasize = st.st_size;
+    if (fstat(fd_index, &st) || (uint64_t)st.st_size<indexsize+sizeof(SIndexRecord)) return;
+
+    // load the new records (drop a partially written last record & the
+    // records pointing beyond the data file)
+    size_t nrecs = (st.st_size-indexsize)/sizeof(SIndexRecord);
+    vector<SIndexRecord> recs(nrecs);
+    ssize_t bcount = pread(fd_index, recs.data(), nrecs*sizeof(SIndexRecord), indexsize);
+    nrecs = bcount>0 ? bcount/sizeof(SIndexRecord) : 0;
+
+    index.reserve(index.size()+nrecs);
+    for (size_t i=0; i<nrecs; i++)
+    {
+        const SIndexRecord &rec = recs[i];
+        if (rec.offset+rec.size<=datasize)
+            index[rec.key] = SIndex{rec.offset, rec.size, rec.stored};
+    }
+    indexsize += nrecs*sizeof(SIndexRecord);
+}
+
+/**
+ * @brief Look up an entry
+ * @param[in] URL
+ * @param[out] cached entry
+ * @return true if found (fresh or stale)
+ */
+bool CUtilUrlCache::Lookup(const std::string &url, SEntry &entry)
+{
+    SIndex rec;
+    vector<char> buf;
+    ssize_t bcount;
+    {
+        lock_guard<mutex> lck(mutex_cache);
+        {
+            SFileLock flck(fd_lock, LOCK_SH);
+            Sync_();
+        }
+
+        IndexMap::const_iterator it = index.find(Hash_(url));
+        if (it==index.end()) return false;
+        rec = (*it).second;
+
+        // read the whole record at once. The records are never overwritten,
+        // and a compaction by another process replaces the file, so the
+        // data file lock is not needed.
+        buf.resize(rec.size);
+        do bcount = pread(fd_data, buf.data(), rec.size, rec.offset);
+        while (bcount<0 && errno==EINTR);
+    }
+    if (bcount!=(ssize_t)rec.size || rec.size<sizeof(SDataHeader)) return false;
+
+    SDataHeader hdr;
+    memcpy(&hdr, buf.data(), sizeof(hdr));
+    if (sizeof(hdr)+(uint64_t)hdr.urllen+hdr.etaglen+hdr.lastmodlen+hdr.datalen!=rec.size)
+        return false;
+
+    // make sure it is not a hash collision
+    const char *p = buf.data()+sizeof(hdr);
+    if (url.compare(0, url.npos, p, hdr.urllen)!=0) return false;
+    p += hdr.urllen;
+
+    entry.etag.assign(p, hdr.etaglen);
+    p += hdr.etaglen;
+    entry.lastmod.assign(p, hdr.lastmodlen);
+    p += hdr.lastmodlen;
+    entry.data.assign(p, hdr.datalen);
+    entry.stored = rec.stored;
+
+    return true;
+}
+
+/**
+ * @brief Check if an entry is still within its time-to-live
+ * @param[in] cached entry
+ * @return true if fresh
+ */
+bool CUtilUrlCache::Fresh(const SEntry &entry) const
+{
+    return time(NULL)-entry.stored < ttl;
+}
+
+/**
+ * @brief Store a response
+ * @param[in] URL
+ * @param[in] response body
+ * @param[in] ETag header value (may be empty)
+ * @param[in] Last-Modified header value (may be empty)
+ */
+void CUtilUrlCache::Store(const std::string &url, const std::string &data,
+                          const std::string &etag, const std::string &lastmod)
+{
+    SDataHeader hdr = {(uint32_t)url.size(), (uint32_t)etag.size(),
+                       (uint32_t)lastmod.size(), (uint32_t)data.size()};
+
+    string rec;
+    rec.reserve(sizeof(hdr)+url.size()+etag.size()+lastmod.size()+data.size());
+    rec.append((const char*)&hdr, sizeof(hdr));
+    rec += url;
+    rec += etag;
+    rec += lastmod;
+    rec += data;
+
+    lock_guard<mutex> lck(mutex_cache);
+    SFileLock flck(fd_lock, LOCK_EX);
+    Sync_();
+
+    // append the record to the data file, then index it
+    write_all(fd_data, rec.data(), rec.size(), datasize);
+    SIndex idx = {datasize, (uint32_t)rec.size(), (int64_t)time(NULL)};
+    datasize += rec.size();
+
+    AppendIndex_(Hash_(url), idx);
+
+    if (datasize>maxsize) Compact_();
+}
+
+/**
+ * @brief Mark an entry revalidated (e.g., by "304 Not Modified")
+ * @param[in] URL
+ */
+void CUtilUrlCache::Refresh(const std::string &url)
+{
+    uint64_t key = Hash_(url);
+
+    lock_guard<mutex> lck(mutex_cache);
+    SFileLock flck(fd_lock, LOCK_EX);
+    Sync_();
+
+    IndexMap::const_iterator it = index.find(key);
+    if (it==index.end()) return;
+
+    // re-index the same record with the new time
+    SIndex idx = (*it).second;
+    idx.stored = time(NULL);
+    AppendIndex_(key, idx);
+}
+
+/**
+ * @brief Remove all the entries
+ */
+void CUtilUrlCache::Clear()
+{
+    lock_guard<mutex> lck(mutex_cache);
+    SFileLock flck(fd_lock, LOCK_EX);
+    Sync_();
+
+    if (ftruncate(fd_index, 0) || ftruncate(fd_data, 0))
+        throw(runtime_error("Failed to clear the URL cache."));
+    index.clear();
+    datasize = indexsize = 0;
+}
+
+void CUtilUrlCache::AppendIndex_(const uint64_t key, const SIndex &idx)
+{
+    SIndexRecord rec = {key, idx.offset, idx.size, 0, idx.stored};
+
+    write_all(fd_index, &rec, sizeof(rec), indexsize);
+    indexsize += sizeof(rec);
+
+    index[key] = idx;
+}
+
+void CUtilUrlCache::Compact_()
+{
+    // keep the most recently stored entries
+    vector<std::pair<uint64_t,SIndex>> entries(index.begin(), index.end());
+    std::sort(entries.begin(), entries.end(),
+              [](const std::pair<uint64_t,SIndex> &a, const std::pair<uint64_t,SIndex> &b)
+              { return a.second.stored>b.second.stored; });
+
+    string datapath = dir+"/cache.dat";
+    string indexpath = dir+"/cache.idx";
+    int fd_newdata = open((datapath+".tmp").c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+    int fd_newindex = open((indexpath+".tmp").c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+
+    try
+    {
+        if (fd_newdata<0 || fd_newindex<0)
+            throw(runtime_error("Failed to compact the URL cache."));
+
+        vector<char> buf;
+        vector<SIndexRecord> recs;
+        uint64_t newsize = 0;
+        for (size_t i=0; i<entries.size(); i++)
+        {
+            const SIndex &idx = entries[i].second;
+            if (newsize+idx.size>maxsize/2) continue; // evicted
+
+            buf.resize(idx.size);
+            ssize_t bcount;
+            do bcount = pread(fd_data, buf.data(), idx.size, idx.offset);
+            while (bcount<0 && errno==EINTR);
+            if (bcount!=(ssize_t)idx.size) continue; // lost
+
+            write_all(fd_newdata, buf.data(), idx.size, newsize);
+            recs.push_back(SIndexRecord{entries[i].first, newsize, idx.size, 0, idx.stored});
+            newsize += idx.size;
+        }
+        write_all(fd_newindex, recs.data(), recs.size()*sizeof(SIndexRecord), 0);
+
+        // the new files replace the old ones. A crash in between leaves index
+        // records pointing to the wrong data records, which Lookup() rejects
+        // as the URLs do not match.
+        if (rename((datapath+".tmp").c_str(), datapath.c_str())
+                || rename((indexpath+".tmp").c_str(), indexpath.c_str()))
+            throw(runtime_error("Failed to compact the URL cache."));
+    }
+    catch (...)
+    {
+        if (fd_newdata>=0) close(fd_newdata);
+        if (fd_newindex>=0) close(fd_newindex);
+        unlink((datapath+".tmp").c_str());
+        unlink((indexpath+".tmp").c_str());
+        throw;
+    }
+
+    // switch over to the new files
+    Close_();
+    fd_data = fd_newdata;
+    fd_index = fd_newindex;
+    index.clear();
+    datasize = indexsize = 0;
+    LoadIndex_();
+}
+
+uint64_t CUtilUrlCache::Hash_(const std::string &url)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i=0; i<url.size(); i++)
+    {
+        h ^= (unsigned char)url[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
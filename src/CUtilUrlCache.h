@@ -0,0 +1,170 @@
+#pragma once
+
+#include <string>
+#include <ctime>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * @brief Persistent on-disk cache of HTTP responses
+ *
+ * CUtilUrlCache keeps the bodies of successful HTTP GET responses keyed by
+ * their URLs, along with their ETag and Last-Modified headers for
+ * revalidation. An entry is fresh for the time-to-live given to the
+ * constructor; a stale entry can still be revalidated with a conditional
+ * request (If-None-Match/If-Modified-Since) and refreshed on
+ * "304 Not Modified" without downloading the body again.
+ *
+ * The cache consists of two files in its directory:
+ *
+ *   cache.dat - append-only records: URL, ETag, Last-Modified, and body
+ *   cache.idx - fixed-size index records: URL hash, record offset & size,
+ *               and the time stored
+ *
+ * The index file is read into memory when the cache is opened, so a lookup
+ * costs a hash table lookup and a single positioned read of the data file.
+ * A newer index record of the same URL supersedes the older ones.
+ *
+ * Once the data file grows past the size cap given to the constructor, the
+ * cache is compacted: the live entries, most recently stored first, are
+ * copied to new files until half the cap is reached, and the new files are
+ * renamed over the old ones.
+ *
+ * All member functions are thread-safe. Several processes may share a cache
+ * directory: the files are modified under an exclusive flock() on a third
+ * file (cache.lck), and each process picks up the records appended by the
+ * others, or reopens the files compacted by them, under a shared lock.
+ */
+class CUtilUrlCache
+{
+public:
+    /**
+     * @brief Cached response
+     */
+    struct SEntry
+    {
+        std::string data;   // response body
+        std::string etag;   // ETag header value
+        std::string lastmod; // Last-Modified header value
+        time_t stored;      // time stored or last revalidated
+
+        SEntry() : stored(0) {}
+    };
+
+    static const uint64_t DefaultMaxSize = 256<<20; /// default size cap of the data file (256 MiB)
+
+    /**
+     * @brief Constructor. Opens (or creates) the cache in a directory.
+     * @param[in] cache directory (created if not exists)
+     * @param[in] time-to-live of the entries in seconds
+     * @param[in] size cap of the data file in bytes
+     * @throw runtime_error if failed to open the cache files
+     */
+    CUtilUrlCache(const std::string &dir, const time_t ttl=7*24*3600, const uint64_t maxsize=DefaultMaxSize);
+    virtual ~CUtilUrlCache();
+
+    /**
+     * @brief Look up an entry
+     * @param[in] URL
+     * @param[out] cached entry
+     * @return true if found (fresh or stale)
+     */
+    bool Lookup(const std::string &url, SEntry &entry);
+
+    /**
+     * @brief Check if an entry is still within its time-to-live
+     * @param[in] cached entry
+     * @return true if fresh
+     */
+    bool Fresh(const SEntry &entry) const;
+
+    /**
+     * @brief Store a response
+     * @param[in] URL
+     * @param[in] response body
+     * @param[in] ETag header value (may be empty)
+     * @param[in] Last-Modified header value (may be empty)
+     */
+    void Store(const std::string &url, const std::string &data,
+               const std::string &etag, const std::string &lastmod);
+
+    /**
+     * @brief Mark an entry revalidated (e.g., by "304 Not Modified")
+     * @param[in] URL
+     */
+    void Refresh(const std::string &url);
+
+    /**
+     * @brief Remove all the entries
+     */
+    void Clear();
+
+    /**
+     * @brief Get the time-to-live
+     * @return time-to-live in seconds
+     */
+    time_t GetTTL() const { return ttl; }
+
+private:
+    struct SIndex
+    {
+        uint64_t offset; // offset of the record in the data file
+        uint32_t size;   // size of the record
+        int64_t stored;  // time stored
+    };
+    typedef std::unordered_map<uint64_t, SIndex> IndexMap;
+
+    std::mutex mutex_cache;
+    std::string dir; // cache directory
+    int fd_lock;    // lock file (never replaced, so it can be flock'ed)
+    int fd_data;    // data file
+    int fd_index;   // index file
+    uint64_t datasize;  // size of the data file
+    uint64_t indexsize; // size of the index file loaded into index
+    time_t ttl;     // time-to-live in seconds
+    uint64_t maxsize; // size cap of the data file
+    IndexMap index;
+
+    /**
+     * @brief Open the data & index files and load the index. The file lock
+     *        must be held.
+     */
+    void Open_();
+
+    /**
+     * @brief Close the data & index files
+     */
+    void Close_();
+
+    /**
+     * @brief Catch up with the other processes: reopen the files if they
+     *        have been compacted or cleared, and load the index records
+     *        appended since the last call. The file lock must be held.
+     */
+    void Sync_();
+
+    /**
+     * @brief Load the index records past indexsize. The file lock must be
+     *        held.
+     */
+    void LoadIndex_();
+
+    /**
+     * @brief Append an index record to the index file & the in-memory index.
+     *        The file lock must be held exclusively.
+     */
+    void AppendIndex_(const uint64_t key, const SIndex &rec);
+
+    /**
+     * @brief Rewrite the most recent entries up to half the size cap to new
+     *        files and rename them over the old ones. The file lock must be
+     *        held exclusively.
+     */
+    void Compact_();
+
+    /**
+     * @brief 64-bit FNV-1a hash of a URL
+     */
+    static uint64_t Hash_(const std::string &url);
+};
@@ -0,0 +1,213 @@
+#include "CUtilXmlStream.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+
+using std::string;
+using std::runtime_error;
+
+/** Constructor.
+ */
+CUtilXmlStream::CUtilXmlStream() : ctxt(NULL), finished(false), nattrs(0), attrs(NULL)
+{
+    xmlSAXHandler sax;
+    memset(&sax, 0, sizeof(sax));
+    sax.initialized = XML_SAX2_MAGIC;
+    sax.startElementNs = CUtilXmlStream::start_element;
+    sax.endElementNs = CUtilXmlStream::end_element;
+    sax.characters = CUtilXmlStream::characters;
+    sax.cdataBlock = CUtilXmlStream::characters;
+
+    ctxt = xmlCreatePushParserCtxt(&sax, this, NULL, 0, NULL);
+    if (!ctxt) throw(runtime_error("Failed to create an XML parser."));
+}
+
+/** Destructor
+ */
+CUtilXmlStream::~CUtilXmlStream()
+{
+    xmlFreeParserCtxt(ctxt);
+}
+
+/**
+ * @brief Parse the next chunk of the document
+ * @param[in] chunk data
+ * @param[in] chunk size in bytes
+ * @throw runtime_error if the document is malformed
+ */
+void CUtilXmlStream::Feed(const char *chunk, const size_t size)
+{
+    if (finished) throw(runtime_error("XML document has already been completed."));
+    if (size) CheckError_(xmlParseChunk(ctxt, chunk, size, 0));
+}
+
+/**
+ * @brief Complete the document
+ * @throw runtime_error if the document is malformed or incomplete
+ */
+void CUtilXmlStream::Finish()
+{
+    if (finished) return;
+    finished = true;
+
+    CheckError_(xmlParseChunk(ctxt, NULL, 0, 1));
+    if (!ctxt->wellFormed) throw(runtime_error("Failed to parse document\n"));
+
+    EndDocument_();
+}
+
+bool CUtilXmlStream::Attribute_(const std::string &name, std::string &value) const
+{
+    // 5 pointers per attribute: localname, prefix, URI, value begin & end
+    for (int i = 0; i<nattrs; i++)
+    {
+        const xmlChar **attr = attrs+5*i;
+        if (name.compare((const char*)attr[0])==0)
+        {
+            value.assign((const char*)attr[3], attr[4]-attr[3]);
+            if (value.find('&')!=value.npos) DecodeEntities_(value);
+            return true;
+        }
+    }
+    return false;
+}
+
+void CUtilXmlStream::DecodeEntities_(std::string &value)
+{
+    // libxml2 passes the attribute values with the entity references (the
+    // predefined ones as character references) unless it is allowed to
+    // substitute all the entities, including the external ones
+    string rval;
+    rval.reserve(value.size());
+    for (size_t pos = 0; pos<value.size();)
+    {
+        size_t end;
+        if (value[pos]!='&' || (end = value.find(';', pos))==value.npos)
+        {
+            rval += value[pos++];
+            continue;
+        }
+
+        string ref = value.substr(pos+1, end-pos-1);
+        unsigned long code = 0;
+        if (ref.size()>1 && ref[0]=='#')
+            code = (ref[1]=='x') ? strtoul(ref.c_str()+2, NULL, 16) : strtoul(ref.c_str()+1, NULL, 10);
+        else if (ref=="amp") code = '&';
+        else if (ref=="lt") code = '<';
+        else if (ref=="gt") code = '>';
+        else if (ref=="quot") code = '"';
+        else if (ref=="apos") code = '\'';
+
+        if (!code || code>0x10FFFF) // unknown, keep as is
+        {
+            rval += value[pos++];
+            continue;
+        }
+
+        // UTF-8 encode
+        if (code<0x80) rval += (char)code;
+        else if (code<0x800)
+        {
+            rval += (char)(0xC0|(code>>6));
+            rval += (char)(0x80|(code&0x3F));
+        }
+        else if (code<0x10000)
+        {
+            rval += (char)(0xE0|(code>>12));
+            rval += (char)(0x80|((code>>6)&0x3F));
+            rval += (char)(0x80|(code&0x3F));
+        }
+        else
+        {
+            rval += (char)(0xF0|(code>>18));
+            rval += (char)(0x80|((code>>12)&0x3F));
+            rval += (char)(0x80|((code>>6)&0x3F));
+            rval += (char)(0x80|(code&0x3F));
+        }
+        pos = end+1;
+    }
+    value.swap(rval);
+}
+
+void CUtilXmlStream::CheckError_(const int rc)
+{
+    // rethrow the exception a handler has thrown
+    if (error)
+    {
+        finished = true;
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+
+    if (rc)
+    {
+        finished = true;
+        throw(runtime_error("Failed to parse document\n"));
+    }
+}
+
+void CUtilXmlStream::start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+                                   const xmlChar *URI, int nb_namespaces, const xmlChar **namespaces,
+                                   int nb_attributes, int nb_defaulted, const xmlChar **attributes)
+{
+    CUtilXmlStream &obj = *(CUtilXmlStream*)ctx;
+    if (obj.error) return;
+
+    // exceptions must not propagate through libxml2
+    try
+    {
+        string name((const char*)localname);
+        obj.path += '/';
+        obj.path += name;
+        obj.text.clear();
+
+        obj.nattrs = nb_attributes;
+        obj.attrs = attributes;
+        obj.StartElement_(name);
+        obj.nattrs = 0;
+        obj.attrs = NULL;
+    }
+    catch (...)
+    {
+        obj.error = std::current_exception();
+        xmlStopParser(obj.ctxt);
+    }
+}
+
+void CUtilXmlStream::end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI)
+{
+    CUtilXmlStream &obj = *(CUtilXmlStream*)ctx;
+    if (obj.error) return;
+
+    try
+    {
+        string name((const char*)localname);
+        obj.EndElement_(name, obj.text);
+
+        obj.path.erase(obj.path.size()-name.size()-1);
+        obj.text.clear();
+    }
+    catch (...)
+    {
+        obj.error = std::current_exception();
+        xmlStopParser(obj.ctxt);
+    }
+}
+
+void CUtilXmlStream::characters(void *ctx, const xmlChar *ch, int len)
+{
+    CUtilXmlStream &obj = *(CUtilXmlStream*)ctx;
+    if (obj.error) return;
+
+    try
+    {
+        obj.text.append((const char*)ch, len);
+    }
+    catch (...)
+    {
+        obj.error = std::current_exception();
+        xmlStopParser(obj.ctxt);
+    }
+}
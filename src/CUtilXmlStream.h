@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <exception>
+
+#include <libxml/parser.h>
+
+#include "CUtilXml.h"
+
+/** Base class of streaming (SAX) XML extractors
+ *
+ *  CUtilXmlStream wraps a libxml2 push parser, so an XML document can be
+ *  parsed as its bytes arrive (e.g., from a curl write callback) without
+ *  buffering the whole document or building a tree. A derived class picks
+ *  the data it needs from the element events, with the path of the current
+ *  element (e.g., "/metadata/release/title") to identify the element.
+ */
+class CUtilXmlStream : public CUtilXml
+{
+public:
+    /** Constructor.
+     */
+    CUtilXmlStream();
+
+    /** Destructor
+     */
+    virtual ~CUtilXmlStream();
+
+    /**
+     * @brief Parse the next chunk of the document
+     * @param[in] chunk data
+     * @param[in] chunk size in bytes
+     * @throw runtime_error if the document is malformed
+     */
+    void Feed(const char *chunk, const size_t size);
+
+    /**
+     * @brief Complete the document
+     * @throw runtime_error if the document is malformed or incomplete
+     */
+    void Finish();
+
+    /**
+     * @brief Parse a whole document at once
+     * @param[in] XML document
+     * @throw runtime_error if the document is malformed
+     */
+    void Parse(const std::string &data) { Feed(data.data(), data.size()); Finish(); }
+
+protected:
+    /**
+     * @brief Called at the start tag of an element. The element is already
+     *        appended to Path_() and its attributes are available via
+     *        Attribute_().
+     * @param[in] element name (local name without namespace prefix)
+     */
+    virtual void StartElement_(const std::string &name) {}
+
+    /**
+     * @brief Called at the end tag of an element. The element is still the
+     *        last in Path_().
+     * @param[in] element name (local name without namespace prefix)
+     * @param[in] text content directly under the element
+     */
+    virtual void EndElement_(const std::string &name, const std::string &text) {}
+
+    /**
+     * @brief Called after the whole document is parsed
+     * @throw runtime_error if the document lacks required data
+     */
+    virtual void EndDocument_() {}
+
+    /**
+     * @brief Get the path of the current element
+     * @return slash-separated element names from the root element
+     */
+    const std::string &Path_() const { return path; }
+
+    /**
+     * @brief Get an attribute of the current element (only valid in
+     *        StartElement_())
+     * @param[in] attribute name
+     * @param[out] attribute value
+     * @return true if the attribute is found
+     */
+    bool Attribute_(const std::string &name, std::string &value) const;
+
+private:
+    xmlParserCtxtPtr ctxt;
+    std::string path;   // path of the current element
+    std::string text;   // text content of the current element
+    bool finished;
+
+    // attributes of the element being started
+    int nattrs;
+    const xmlChar **attrs;
+
+    std::exception_ptr error; // exception thrown by a handler
+
+    static void start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix,
+                              const xmlChar *URI, int nb_namespaces, const xmlChar **namespaces,
+                              int nb_attributes, int nb_defaulted, const xmlChar **attributes);
+    static void end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI);
+    static void characters(void *ctx, const xmlChar *ch, int len);
+
+    void CheckError_(const int rc);
+
+    /**
+     * @brief Replace the character & predefined entity references of an
+     *        attribute value
+     */
+    static void DecodeEntities_(std::string &value);
+};
@@ -5,12 +5,83 @@
 #include <utility>
 #include <stdexcept>
 #include <cstring>
+#include <unordered_map>
+#include <functional>
+
+#include <libxml/dict.h>
 
 using std::runtime_error;
 
+/** Child element index of a document (attached to xmlDoc::_private)
+ */
+struct CUtilXmlTree::SIndex
+{
+    typedef std::pair<const xmlNode*, const xmlChar*> Key; // <parent, interned name>
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            return std::hash<const void*>()(key.first) ^ (std::hash<const void*>()(key.second)<<1);
+        }
+    };
+
+    std::unordered_map<Key, const xmlNode*, KeyHash> children; // first child of the name
+    std::unordered_map<const xmlNode*, const xmlNode*> stops; // first non-element child
+
+    void Add(const xmlNode *parent)
+    {
+        // mirror the linear scan: it matches the elements until the first
+        // non-element child, which is returned if no element matched
+        for (const xmlNode *node = parent->children; node; node = node->next)
+        {
+            if (node->type!=XML_ELEMENT_NODE)
+            {
+                stops.emplace(parent, node);
+                break;
+            }
+            children.emplace(Key(parent, node->name), node);
+        }
+
+        for (const xmlNode *node = parent->children; node; node = node->next)
+            if (node->type==XML_ELEMENT_NODE) Add(node);
+    }
+
+    /**
+     * @brief Look up a child
+     * @return true if looked up (false if the index cannot be used)
+     */
+    static bool Find(const xmlNode *parent, const std::string &key, const xmlNode *&node)
+    {
+        xmlDocPtr doc = parent->doc;
+        if (!doc || !doc->_private || !doc->dict) return false;
+        const SIndex &index = *(const SIndex*)doc->_private;
+
+        // names are interned in the document dictionary, so a name not in it
+        // is not the name of any element
+        const xmlChar *name = xmlDictExists(doc->dict, (const xmlChar*)key.data(), key.size());
+        if (name)
+        {
+            std::unordered_map<Key, const xmlNode*, KeyHash>::const_iterator it = index.children.find(Key(parent, name));
+            if (it!=index.children.end())
+            {
+                node = (*it).second;
+                return true;
+            }
+        }
+
+        std::unordered_map<const xmlNode*, const xmlNode*>::const_iterator it = index.stops.find(parent);
+        node = (it!=index.stops.end()) ? (*it).second : nullptr;
+        return true;
+    }
+};
+
 /** Constructor.
+ *
+ *  @param[in] XML document (if empty, no document is loaded)
+ *  @param[in] true to index the document (see BuildIndex())
  */
-CUtilXmlTree::CUtilXmlTree(const std::string &rawdata) : root(nullptr), data(nullptr)
+CUtilXmlTree::CUtilXmlTree(const std::string &rawdata, const bool indexed) : root(nullptr), data(nullptr)
 {
     if (rawdata.size())
     {
@@ -21,6 +92,8 @@ CUtilXmlTree::CUtilXmlTree(const std::string &rawdata) : root(nullptr), data(nul
         data = xmlReadMemory(rawdata.c_str(), rawdata.size(), "", nullptr, 0);
         if (data) root = xmlDocGetRootElement(data);
         else throw(std::runtime_error("Failed to parse document\n"));
+
+        if (indexed) BuildIndex();
     }
 }
 
@@ -32,13 +105,23 @@ CUtilXmlTree::CUtilXmlTree(const CUtilXmlTree &src) : root(nullptr), data(nullpt
 {
     data = xmlCopyDoc(src.data,1);
     if (!data) throw(std::runtime_error("Failed to copy XML document."));
+
+    root = xmlDocGetRootElement(data);
+
+    // (the copy does not carry the source's index)
+    data->_private = nullptr;
+    if (src.data->_private) BuildIndex();
 }
 
 /** Destructor
  */
 CUtilXmlTree::~CUtilXmlTree()
 {
-    if (data) xmlFreeDoc(data);
+    if (data)
+    {
+        FreeIndex_(data);
+        xmlFreeDoc(data);
+    }
 }
 
 /**
@@ -76,14 +159,38 @@ void CUtilXmlTree::ClearData()
 {
     if (data)
     {
+        FreeIndex_(data);
         xmlFreeDoc(data);
         data = nullptr;
         root = nullptr;
     }
 }
 
+/**
+ * @brief Index the child elements of the loaded document for constant
+ *        time lookups. The index is kept until the document is cleared.
+ *        No action if already indexed.
+ */
+void CUtilXmlTree::BuildIndex()
+{
+    if (!data || data->_private) return;
+
+    SIndex *index = new SIndex;
+    for (const xmlNode *node = data->children; node; node = node->next)
+        if (node->type==XML_ELEMENT_NODE) index->Add(node);
+    data->_private = index;
+}
+
+void CUtilXmlTree::FreeIndex_(xmlDocPtr doc)
+{
+    delete (SIndex*)doc->_private;
+    doc->_private = nullptr;
+}
+
 bool CUtilXmlTree::FindElement(const xmlNode *parent, const std::string &key, const xmlNode *&node)
 {
+    if (SIndex::Find(parent, key, node)) return node!=nullptr;
+
     for (node = parent->children;
          node && node->type==XML_ELEMENT_NODE && (key.compare((char*)node->name)!=0);
          node = node->next);
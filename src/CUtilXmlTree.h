@@ -7,6 +7,13 @@
 #include "CUtilXml.h"
 
 /** Abstract base Database class with CD info stored in JSON format
+ *
+ *  Optionally (see BuildIndex()), the document can be indexed for the child
+ *  element lookups: the children of each element are then looked up by
+ *  name in a hash table (keyed by the element and its interned name) rather
+ *  than by scanning the sibling list, so FindElement(), FindArray(),
+ *  FindString(), and FindInt() take constant time on large documents. The
+ *  index is attached to the document, so the static functions use it too.
  */
 class CUtilXmlTree : public CUtilXml
 {
@@ -14,8 +21,11 @@ public:
     const xmlNode *root;
 
     /** Constructor.
+     *
+     *  @param[in] XML document (if empty, no document is loaded)
+     *  @param[in] true to index the document (see BuildIndex())
      */
-    CUtilXmlTree(const std::string &data="");
+    CUtilXmlTree(const std::string &data="", const bool indexed=false);
     CUtilXmlTree(const CUtilXmlTree &src);
 
     /** Destructor
@@ -40,6 +50,13 @@ public:
      */
     virtual void ClearData();
 
+    /**
+     * @brief Index the child elements of the loaded document for constant
+     *        time lookups. The index is kept until the document is cleared.
+     *        No action if already indexed.
+     */
+    void BuildIndex();
+
     /** Debug function. Prints full-struct of XML tree for a release
      *
      * @param[in] Depth to traverse the XML object tree (negative to go all the way)
@@ -92,5 +109,12 @@ public:
 private:
     xmlDocPtr data;
 
+    struct SIndex;
+
+    /**
+     * @brief Release the index of a document
+     */
+    static void FreeIndex_(xmlDocPtr doc);
+
     static void PrintXmlTree_(std::ostream &os, int depth, const xmlNode *obj, std::string indent);
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 #include <functional>
 #include <stdint.h>
@@ -14,6 +15,7 @@ typedef std::vector<std::reference_wrapper<ISink>> ISinkRefVector ;
 class ISink
 {
 public:
+    virtual ~ISink() {}
 
     /**
      * @brief IsLocked
@@ -48,6 +50,14 @@ public:
      */
     virtual void WaitTillUnlock()=0;
 
+    /**
+     * @brief Hint the total amount of audio data to be written, so the sink
+     *        can preallocate its output. Call before WritePreamble().
+     * @param Total number of samples (16-bit) to be written (e.g.,
+     *        ISourceCdda::GetLength(CDTIMEUNIT_WORDS))
+     */
+    virtual void Reserve(const size_t nsamples)=0;
+
     /**
      * @brief Write preamble data to the audio file. Derived class must
      *        the access to the data to be written. The ISink instance
@@ -81,11 +91,32 @@ public:
     virtual bool CueSheetEmbeddable()=0;
 
     /**
-     * @brief Add/overwrite "cuesheet" tag entry to the output file.
+     * @brief Add/overwrite "cuesheet" tag entry to the output file. The tags
+     *        are written by WritePostamble(), so this function may be called
+     *        until then, even while the frames are being written.
      * @param[in] reference to the cuesheet
      * @throw std::runtime_error if ISink instance does not support embedded
      *        cuesheet (i.e., CueSheetEmbeddable() returns false)
      */
     virtual void SetCueSheet(const SCueSheet& cuesheet)=0;
 
+    /**
+     * @brief Add/overwrite the cover image tag of the output file (no action
+     *        if the output file has no tags). Like SetCueSheet(), may be
+     *        called until WritePostamble().
+     * @param[in] image data (JPEG or PNG)
+     * @param[in] true for the front cover, false for the back cover
+     */
+    virtual void SetCoverArt(const std::vector<unsigned char> &data, const bool front)=0;
+
+    /**
+     * @brief Set the final path of the output file. The output is written to
+     *        the file the sink was created with (e.g., a spool file while the
+     *        metadata is looked up), which WritePostamble() completes and
+     *        atomically renames to the final path. May be called until
+     *        WritePostamble().
+     * @param[in] final path (on the same file system as the output file)
+     */
+    virtual void SetFinalPath(const std::string &path)=0;
+
 };
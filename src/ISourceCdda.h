@@ -36,6 +36,15 @@ public:
      */
     virtual const int16_t* ReadNextSector()=0; /* returns non-NULL until end of CD */
 
+    /**
+     * @brief Read a block of consecutive sectors into a caller-provided buffer
+     * @param[out] buffer with room for nsectors*GetSectorSize() samples
+     * @param[in] maximum number of sectors to read
+     * @return number of sectors read. Less than nsectors only at the end of
+     *         the disc, and 0 if all sectors have been read.
+     */
+    virtual size_t ReadSectors(int16_t *buf, const size_t nsectors)=0;
+
     /**
      * @brief Rewind to the beginning of the disc.
      */
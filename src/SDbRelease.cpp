@@ -0,0 +1,184 @@
+#include "SDbRelease.h"
+
+#include <stdexcept>
+#include <utility>
+
+using std::string;
+using std::runtime_error;
+
+SDbRelease::SDbRelease() : arena(1,'\0')
+{
+    Clear();
+}
+
+/**
+ * @brief Clear the record
+ */
+void SDbRelease::Clear()
+{
+    id = title = date = country = genre = label = catno = barcode = asin = group = 0;
+    performers = composers = SRange();
+    total_discs = 1;
+
+    tracks.clear();
+    credits.clear();
+    artists.clear();
+    links.clear();
+
+    arena.assign(1,'\0');
+    interned.clear();
+    artist_ids.clear();
+}
+
+/**
+ * @brief Exchanges the content with another SDbRelease object
+ * @param Another SDbRelease object
+ */
+void SDbRelease::Swap(SDbRelease &other)
+{
+    std::swap(id,other.id);
+    std::swap(title,other.title);
+    std::swap(date,other.date);
+    std::swap(country,other.country);
+    std::swap(genre,other.genre);
+    std::swap(label,other.label);
+    std::swap(catno,other.catno);
+    std::swap(barcode,other.barcode);
+    std::swap(asin,other.asin);
+    std::swap(group,other.group);
+    std::swap(performers,other.performers);
+    std::swap(composers,other.composers);
+    std::swap(total_discs,other.total_discs);
+
+    tracks.swap(other.tracks);
+    credits.swap(other.credits);
+    artists.swap(other.artists);
+    links.swap(other.links);
+
+    arena.swap(other.arena);
+    interned.swap(other.interned);
+    artist_ids.swap(other.artist_ids);
+}
+
+/**
+ * @brief Release the intern table and the unused capacity once the
+ *        record is complete
+ */
+void SDbRelease::Compact()
+{
+    std::unordered_map<string,StrRef>().swap(interned);
+    std::unordered_map<StrRef,uint32_t>().swap(artist_ids);
+
+    arena.shrink_to_fit();
+    tracks.shrink_to_fit();
+    credits.shrink_to_fit();
+    artists.shrink_to_fit();
+    links.shrink_to_fit();
+}
+
+/**
+ * @brief Intern a string
+ * @param[in] string
+ * @return reference to the interned string
+ */
+SDbRelease::StrRef SDbRelease::Intern(const std::string &str)
+{
+    if (str.empty()) return 0;
+
+    std::pair<std::unordered_map<string,StrRef>::iterator,bool> ret = interned.emplace(str, arena.size());
+    if (ret.second) arena.append(str.c_str(), str.size()+1); // new string, copy with its NUL
+    return (*ret.first).second;
+}
+
+/**
+ * @brief Find the artist with the ID, add it if not found
+ * @param[in] artist ID (if empty, always adds a new artist)
+ * @return index to artists
+ */
+uint32_t SDbRelease::Artist(const std::string &artist_id)
+{
+    StrRef ref = Intern(artist_id);
+    if (ref)
+    {
+        std::unordered_map<StrRef,uint32_t>::iterator it = artist_ids.find(ref);
+        if (it!=artist_ids.end()) return (*it).second;
+        artist_ids.emplace(ref, artists.size());
+    }
+
+    SArtist artist = { ref, 0, SCueArtistType::UNKNOWN };
+    artists.push_back(artist);
+    return artists.size()-1;
+}
+
+/**
+ * @brief Find the artist with the ID
+ * @param[in] artist ID
+ * @return pointer to the artist or NULL if not found
+ */
+SDbRelease::SArtist *SDbRelease::FindArtist(const std::string &artist_id)
+{
+    for (std::vector<SArtist>::iterator it = artists.begin(); it!=artists.end(); it++)
+        if ((*it).id && artist_id.compare(String((*it).id))==0) return &*it;
+    return NULL;
+}
+
+/**
+ * @brief Append a credit to a range. The credits of a range must be
+ *        appended consecutively.
+ * @param[inout] range to append the credit to
+ * @param[in] index to artists
+ * @param[in] credited artist name
+ * @param[in] joining phrase to the next artist
+ * @throw runtime_error if the range is not at the end of credits
+ */
+void SDbRelease::AddCredit(SRange &range, const uint32_t artist, const std::string &name, const std::string &joiner)
+{
+    if (!range.count) range.first = credits.size();
+    else if (range.first+range.count!=credits.size())
+        throw(runtime_error("Artist credits of a range must be added consecutively."));
+
+    SCredit credit = { artist, Intern(name), Intern(joiner) };
+    credits.push_back(credit);
+    range.count++;
+}
+
+/**
+ * @brief Get the artists of a credit range
+ * @param[in] credit range
+ * @return artists (the preferred names if given, else the credited names)
+ */
+SCueArtists SDbRelease::Artists(const SRange &range) const
+{
+    SCueArtists rval;
+    StrRef joiner = 0;
+
+    rval.reserve(range.count);
+    for (uint32_t i = range.first; i<range.first+range.count; i++)
+    {
+        const SCredit &credit = credits[i];
+        const SArtist &artist = artists[credit.artist];
+
+        // if there is a joining string carried over from the previous artist, add now
+        if (joiner && rval.size()) rval.back().joiner = String(joiner);
+
+        StrRef name = artist.name ? artist.name : credit.name;
+        if (name) rval.emplace_back(String(name), "", artist.type);
+
+        // save its joining string for the next artist
+        joiner = credit.joiner;
+    }
+
+    return rval;
+}
+
+/**
+ * @brief Get the target of the first link of a type
+ * @param[in] link type
+ * @return link target or empty if not found
+ */
+std::string SDbRelease::Link(const std::string &type) const
+{
+    for (std::vector<SLink>::const_iterator it = links.begin(); it!=links.end(); it++)
+        if (type.compare(String((*it).type))==0) return String((*it).target);
+    return "";
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "SCueArtist.h"
+
+/** Compact release record shared by the CDb*Elem classes
+ *
+ *  A database release response is extracted into SDbRelease once, and the
+ *  parsed response is freed. All the strings are interned in a single
+ *  character arena and referred to by their offsets (StrRef), and the
+ *  tracks, the artist credits, and the artists are stored in contiguous
+ *  arrays, of which the release and its tracks refer to ranges. Reading a
+ *  field is thus an array read.
+ *
+ *  Identical strings are stored once while the record is being built. Once
+ *  complete, Compact() releases the intern table and the unused capacity;
+ *  the strings interned afterwards are simply appended.
+ */
+struct SDbRelease
+{
+    typedef uint32_t StrRef; // offset of a string in the arena (0: empty string)
+
+    /** Range of the elements of an array
+     */
+    struct SRange
+    {
+        uint32_t first;
+        uint32_t count;
+
+        SRange() : first(0), count(0) {}
+    };
+
+    /** Artist (shared by all the credits of the artist)
+     */
+    struct SArtist
+    {
+        StrRef id;              // database artist ID
+        StrRef name;            // preferred name, overrides the credited names if given
+        SCueArtistType type;
+    };
+
+    /** Artist credit
+     */
+    struct SCredit
+    {
+        uint32_t artist;        // index to artists
+        StrRef name;            // credited artist name
+        StrRef joiner;          // joining phrase if more artist follows
+    };
+
+    /** Track
+     */
+    struct STrack
+    {
+        int number;             // track number on its disc (-1 if unknown)
+        int length;             // in milliseconds (-1 if unknown)
+        StrRef position;        // position as listed in the database
+        StrRef title;
+        StrRef isrc;
+        SRange performers;      // credits of the performing artists
+        SRange composers;       // credits of the composers
+
+        STrack() : number(-1), length(-1), position(0), title(0), isrc(0) {}
+    };
+
+    /** Typed link (e.g., URL relation or image URL)
+     */
+    struct SLink
+    {
+        StrRef type;
+        StrRef target;
+    };
+
+    // release fields
+    StrRef id;
+    StrRef title;
+    StrRef date;
+    StrRef country;
+    StrRef genre;
+    StrRef label;           // name of the first label
+    StrRef catno;           // catalog number of the first label
+    StrRef barcode;
+    StrRef asin;
+    StrRef group;           // release group ID
+    SRange performers;      // credits of the album artists
+    SRange composers;       // credits of the album composers
+    int total_discs;        // number of discs in the release (-1 if unknown)
+
+    std::vector<STrack> tracks;
+    std::vector<SCredit> credits;
+    std::vector<SArtist> artists;
+    std::vector<SLink> links;
+
+    SDbRelease();
+
+    /**
+     * @brief Clear the record
+     */
+    void Clear();
+
+    /**
+     * @brief Exchanges the content with another SDbRelease object
+     * @param Another SDbRelease object
+     */
+    void Swap(SDbRelease &other);
+
+    /**
+     * @brief Release the intern table and the unused capacity once the
+     *        record is complete
+     */
+    void Compact();
+
+    /**
+     * @brief Intern a string
+     * @param[in] string
+     * @return reference to the interned string
+     */
+    StrRef Intern(const std::string &str);
+
+    /**
+     * @brief Get an interned string
+     * @param[in] reference to the interned string
+     * @return the string (valid until the next string is interned)
+     */
+    const char *String(const StrRef ref) const { return arena.c_str()+ref; }
+
+    /**
+     * @brief Find the artist with the ID, add it if not found
+     * @param[in] artist ID (if empty, always adds a new artist)
+     * @return index to artists
+     */
+    uint32_t Artist(const std::string &id);
+
+    /**
+     * @brief Find the artist with the ID
+     * @param[in] artist ID
+     * @return pointer to the artist or NULL if not found
+     */
+    SArtist *FindArtist(const std::string &id);
+
+    /**
+     * @brief Append a credit to a range. The credits of a range must be
+     *        appended consecutively.
+     * @param[inout] range to append the credit to
+     * @param[in] index to artists
+     * @param[in] credited artist name
+     * @param[in] joining phrase to the next artist
+     * @throw runtime_error if the range is not at the end of credits
+     */
+    void AddCredit(SRange &range, const uint32_t artist, const std::string &name, const std::string &joiner);
+
+    /**
+     * @brief Get the artists of a credit range
+     * @param[in] credit range
+     * @return artists (the preferred names if given, else the credited names)
+     */
+    SCueArtists Artists(const SRange &range) const;
+
+    /**
+     * @brief Get the target of the first link of a type
+     * @param[in] link type
+     * @return link target or empty if not found
+     */
+    std::string Link(const std::string &type) const;
+
+private:
+    std::string arena;  // NUL-terminated strings, with the empty string at 0
+    std::unordered_map<std::string,StrRef> interned; // intern table, until Compact()
+    std::unordered_map<StrRef,uint32_t> artist_ids; // <interned ID, index to artists>, until Compact()
+};
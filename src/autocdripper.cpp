@@ -1,5 +1,10 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <exception>
+#include <stdexcept>
+#include <memory>
 
 #include <fstream>
 #include <iostream>
@@ -14,16 +19,45 @@ using std::endl;
 #include "CSourceCdda.h"
 #include "CSinkWav.h"
 #include "CSinkWavPack.h"
+#include "CSinkChecksum.h"
 
 #include "CDbFreeDb.h"
 #include "CDbMusicBrainz.h"
+#include "CDbMusicBrainzIndex.h"
 #include "CDbDiscogs.h"
 #include "CDbLastFm.h"
 
+#include "CUtilUrl.h"
+#include "CUtilUrlCache.h"
+#include "utils.h"
+
 using std::exception;
 
 int main(int argc, const char *argv[])
 {
+    // cache directory of the HTTP responses & the offline MusicBrainz disc
+    // index (--cache-dir DIR, or --no-cache to go online for everything)
+    std::string cachedir;
+    if (getenv("XDG_CACHE_HOME")) cachedir = std::string(getenv("XDG_CACHE_HOME"))+"/autocdripper";
+    else if (getenv("HOME")) cachedir = std::string(getenv("HOME"))+"/.cache/autocdripper";
+    // --burst to read each track at full speed & verify it with a second
+    // read, instead of reading with paranoia throughout
+    bool burst = false;
+    // --checksum to compute the AccurateRip & CRC32 checksums of the tracks
+    // during the rip, and add them to the cuesheet
+    bool checksum = false;
+    // --tracks to save each track to its own WavPack file, instead of the
+    // whole disc to one file with an embedded cuesheet
+    bool tracks = false;
+    for (int i=1; i<argc; i++)
+    {
+        if (!strcmp(argv[i],"--cache-dir") && i+1<argc) cachedir = argv[++i];
+        else if (!strcmp(argv[i],"--no-cache")) cachedir.clear();
+        else if (!strcmp(argv[i],"--burst")) burst = true;
+        else if (!strcmp(argv[i],"--checksum")) checksum = true;
+        else if (!strcmp(argv[i],"--tracks")) tracks = true;
+    }
+
     try
     {
         CFileNameGenerator fng("","%artist%-%title%",OutputFileFormat::WAVPACK);
@@ -38,15 +72,78 @@ int main(int argc, const char *argv[])
         CCueSheetBuilder csbuilder;
 
         freedb.SetCacheSettings("off");
+        if (!cachedir.empty())
+        {
+            if (!make_dirs(cachedir))
+                throw(std::runtime_error("Could not create the cache directory: " + cachedir));
+            CUtilUrl::SetCache(std::make_shared<CUtilUrlCache>(cachedir+"/http"));
+            mbdb.SetOfflineIndex(std::make_shared<CDbMusicBrainzIndex>(cachedir+"/musicbrainz.idx"));
+        }
         mbdb.SetGrabCoverArtFromAmazon(true);
         mbdb.SetPreferredLocale("en");
         discogs.SetCountryPreference("US");
 
         CSourceCdda cdrom; // auto-detect CD-ROM drive with a audio CD
+        cdrom.SetBurstMode(burst);
 
-        csbuilder.SetCdInfo(cdrom);
-        //csbuilder.SetCdInfo(cdrom,"731452547224"); // jobim songbook
-        //csbuilder.SetCdInfo(cdrom,"025218643429"); // bill evans moon beams
+        // read the track info off the drive before the ripper takes it over
+        const SCueSheet cdinfo = cdrom.GetCueSheet();
+
+        // start ripping right away to a spool file in the output directory;
+        // the file gets its name, cuesheet & cover art at WritePostamble(),
+        // by when the online databases have long answered. The name is made
+        // unique as other drives or processes may spool to the same directory.
+        // (The track files are named as they are written, so the per-track
+        // rip waits for the online databases instead.)
+        std::string spoolpath;
+        std::unique_ptr<CSinkWavPack> wvwriter;
+        ISinkRefVector writers;
+        if (!tracks)
+        {
+            spoolpath = fng.basepath + "autocdripper-XXXXXX.wv.part";
+            if (!make_dirs(parent_dir(spoolpath)))
+                throw(std::runtime_error("Could not create the output directory: " + parent_dir(spoolpath)));
+            int spoolfd = mkstemps(&spoolpath[0], strlen(".wv.part"));
+            if (spoolfd<0)
+                throw(std::runtime_error("Could not create the spool file in " + parent_dir(spoolpath)));
+            close(spoolfd); // reopened by the sink
+            wvwriter.reset(new CSinkWavPack(spoolpath)); // save to the wavpack file
+            writers.push_back(*wvwriter);
+        }
+
+        ISinkRefVector::iterator it;
+        for (it=writers.begin();it!=writers.end();it++)
+        {
+            ISink &writer = (*it).get();
+            writer.Reserve(cdrom.GetLength(CDTIMEUNIT_WORDS)); // preallocate the file
+            writer.Lock(1);
+            writer.WritePreamble(1);  // write the preamble of the destination audio file
+            writer.Unlock(1);
+        }
+
+        // the checksum sink reads the same stream, but writes no file
+        std::unique_ptr<CSinkChecksum> checksums;
+        ISinkRefVector sinks = writers;
+        if (checksum)
+        {
+            checksums.reset(new CSinkChecksum(cdinfo));
+            checksums->Lock(1);
+            checksums->WritePreamble(1);
+            checksums->Unlock(1);
+            sinks.push_back(*checksums);
+        }
+
+        cout << "[MAIN] Instantiating CCdRipper class\n";
+        CCdRipper ripper(cdrom,sinks);
+        if (!tracks)
+        {
+            cout << "[MAIN] Starting CCdRipper thread\n";
+            ripper.Start();
+        }
+
+        csbuilder.SetCdInfo(cdrom,cdinfo);
+        //csbuilder.SetCdInfo(cdrom,cdinfo,"731452547224"); // jobim songbook
+        //csbuilder.SetCdInfo(cdrom,cdinfo,"025218643429"); // bill evans moon beams
 
         //csbuilder.AddDatabase(discogs);
         csbuilder.AddDatabase(mbdb);
@@ -66,72 +163,102 @@ int main(int argc, const char *argv[])
         csbuilder.RequireUpcMatch(false);
         csbuilder.AllowCombinig(true, false);
 
+        // tag the tracks being ripped as the results arrive
+        csbuilder.SetCallback([&writers](const CueSheetUpdate update, const SCueSheet &cs, const UByteVector &cover)
+        {
+            if (update==CueSheetUpdate::PRELIMINARY) cout << "[MAIN] Preliminary cuesheet: " << cs.Title << endl;
+            else if (update==CueSheetUpdate::CUESHEET) cout << "[MAIN] Cuesheet: " << cs.Title << endl;
+            else cout << "[MAIN] Cover image (" << cover.size() << " bytes)" << endl;
+
+            for (ISinkRefVector::iterator it=writers.begin();it!=writers.end();it++)
+            {
+                ISink &writer = (*it).get();
+                if (update==CueSheetUpdate::FRONT_COVER || update==CueSheetUpdate::BACK_COVER)
+                    writer.SetCoverArt(cover, update==CueSheetUpdate::FRONT_COVER);
+                else if (writer.CueSheetEmbeddable())
+                    writer.SetCueSheet(cs);
+            }
+        });
+
         cout << "[MAIN] Starting CCueSheetBuilder thread\n";
         csbuilder.Start();
         cout << "[MAIN] Waiting till CCueSheetBuilder thread completes its task\n";
         csbuilder.WaitTillDone();
 
+        SCueSheet cs;
         if (csbuilder.FoundRelease())
         {
             cout << "[MAIN] Retrieving the populated cuesheet...\n";
-            SCueSheet cs = csbuilder.GetCueSheet();
+            cs = csbuilder.GetCueSheet();
             cout << cs << endl;
-
-            std::string filename = fng(cs);
-            cout << "filename: " << filename << endl;
-
-//            if (csbuilder.FoundFrontCover())
-//            {
-//                cout << "[MAIN] Front Cover found!!!\n";
-
-//                const UByteVector data = csbuilder.GetFrontCover();
-//                std::ofstream FILE("front.jpg");
-//                FILE.write((char*)data.data(),data.size());
-//            }
-
         }
         else
+        {
             cout << "[MAIN] CD info was not found online\n";
+            cs = cdinfo;
 
-        /*
-        CSinkWav wavwriter("track1s.wav"); // save to the wav file
-        CSinkWavPack wvwriter("track1s.wv"); // save to the wav file
-        //ISinkRefVector writers = {wavwriter,wvwriter};
-        ISinkRefVector writers = {wavwriter};
+            // the callback only fires on a match; embed the TOC cuesheet instead
+            for (it=writers.begin();it!=writers.end();it++)
+            {
+                ISink &writer = (*it).get();
+                if (writer.CueSheetEmbeddable()) writer.SetCueSheet(cdinfo);
+            }
+        }
 
-        ISinkRefVector::iterator it;
-        for (it=writers.begin();it!=writers.end();it++)
+        std::string filename;
+        if (tracks)
         {
-            ISink &writer = (*it).get();
-            writer.Lock(1);
-            writer.WritePreamble(1);  // write the preamble of the destination audio file
-            writer.Unlock(1);
+            // a file per track under the album directory, created by the encoder threads
+            CFileNameGenerator trackfng(fng.basepath,"%artist%-%album%/%tracknumber%-%title%",OutputFileFormat::WAVPACK);
+            ripper.SetTrackMode(cs, trackfng, [](const std::string &path) -> ISink*
+            {
+                if (!make_dirs(parent_dir(path)))
+                    throw(std::runtime_error("Could not create the output directory: " + parent_dir(path)));
+                return new CSinkWavPack(path);
+            });
+            cout << "[MAIN] Starting CCdRipper thread\n";
+            ripper.Start();
+        }
+        else
+        {
+            filename = fng(cs);
+            cout << "filename: " << filename << endl;
+            if (!make_dirs(parent_dir(filename)))
+                throw(std::runtime_error("Could not create the output directory: " + parent_dir(filename)));
         }
 
-        // rip the CD
-        cout << "MAIN: Instantiating CCdRipper class\n";
-        CCdRipper ripper(cdrom,writers);
-        cout << "MAIN: Starting CCdRipper thread\n";
-        ripper.Start();
-        cout << "MAIN: Waiting till CCdRipper thread completes its task\n";
+        cout << "[MAIN] Waiting till CCdRipper thread completes its task\n";
         ripper.WaitTillDone();
 
         if (ripper.Canceled())
         {
-            // delete the output file
+            // delete the spool file
+            if (!spoolpath.empty()) std::remove(spoolpath.c_str());
         }
         else
         {
+            if (checksums)
+            {
+                checksums->Lock(1);
+                checksums->WritePostamble(1);
+                checksums->Unlock(1);
+
+                // embed the cuesheet again with the checksums added
+                checksums->AppendRems(cs);
+                cout << "[MAIN] Checksums:\n" << cs << endl;
+            }
+
             for (it=writers.begin();it!=writers.end();it++)
             {
                 ISink &writer = (*it).get();
+                if (checksums && writer.CueSheetEmbeddable()) writer.SetCueSheet(cs);
                 writer.Lock(1);
-                writer.WritePostamble(1);	// go back to header and fill the size
+                writer.SetFinalPath(filename);
+                writer.WritePostamble(1);	// fill the header, write the tags & rename the file
                 writer.Unlock(1);
             }
         }
-        cout << "MAIN: All completed\n";
-        */
+        cout << "[MAIN] All completed\n";
     }
     catch (exception& e)
     {
@@ -1,9 +1,22 @@
 #include "utils.h"
 
 #include <cstring>
+#include <cstdio>
 #include <algorithm>
 #include <vector>
 #include <stdexcept>
+#include <cerrno>
+
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_AVX2_DISPATCH_
+#endif
 
 using std::vector;
 using std::string;
@@ -81,3 +94,195 @@ std::string itoroman (int val)
 
     return rval;
 }
+
+#ifdef HAVE_AVX2_DISPATCH_
+/* AVX2 kernel, compiled for AVX2 regardless of the build flags and only
+   called if the CPU supports it */
+__attribute__((target("avx2")))
+static size_t widen_int16_avx2_(int32_t *dst, const int16_t *src, const size_t n)
+{
+    size_t i = 0;
+    for (; i+16<=n; i+=16)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(src+i));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(src+i+8));
+        _mm256_storeu_si256((__m256i*)(dst+i), _mm256_cvtepi16_epi32(lo));
+        _mm256_storeu_si256((__m256i*)(dst+i+8), _mm256_cvtepi16_epi32(hi));
+    }
+    return i;
+}
+#endif
+
+/**
+ * @brief Sign-extend 16-bit samples to 32-bit samples. Uses SSE2/AVX2
+ *        when available.
+ * @param[out] destination buffer with room for n samples
+ * @param[in] source buffer
+ * @param[in] number of samples
+ */
+void widen_int16(int32_t *dst, const int16_t *src, const size_t n)
+{
+    size_t i = 0;
+
+#ifdef HAVE_AVX2_DISPATCH_
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) i = widen_int16_avx2_(dst, src, n);
+#endif
+
+#if defined(__SSE2__)
+    // interleave each sample with itself, then shift the copy in the low
+    // half out arithmetically to sign-extend
+    for (; i+8<=n; i+=8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src+i));
+        _mm_storeu_si128((__m128i*)(dst+i), _mm_srai_epi32(_mm_unpacklo_epi16(x,x),16));
+        _mm_storeu_si128((__m128i*)(dst+i+4), _mm_srai_epi32(_mm_unpackhi_epi16(x,x),16));
+    }
+#endif
+
+    // remainder (or all if no SIMD)
+    for (; i<n; i++) dst[i] = src[i];
+}
+
+/**
+ * @brief Compute SHA-1 message digest
+ * @param[in] message
+ * @param[in] message length in bytes
+ * @param[out] 20-byte digest
+ */
+void sha1(const void *data, const size_t len, unsigned char digest[20])
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    // pad the message: 0x80, zeros, then 64-bit big-endian bit length
+    vector<unsigned char> msg((const unsigned char*)data, (const unsigned char*)data+len);
+    msg.push_back(0x80);
+    while (msg.size()%64!=56) msg.push_back(0);
+    uint64_t bits = (uint64_t)len*8;
+    for (int i=7; i>=0; i--) msg.push_back((unsigned char)(bits>>(8*i)));
+
+    for (size_t blk=0; blk<msg.size(); blk+=64)
+    {
+        uint32_t w[80];
+        for (int i=0; i<16; i++)
+            w[i] = (msg[blk+4*i]<<24) | (msg[blk+4*i+1]<<16) | (msg[blk+4*i+2]<<8) | msg[blk+4*i+3];
+        for (int i=16; i<80; i++)
+        {
+            uint32_t x = w[i-3]^w[i-8]^w[i-14]^w[i-16];
+            w[i] = (x<<1)|(x>>31);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i=0; i<80; i++)
+        {
+            uint32_t f, k;
+            if (i<20) { f = (b&c)|(~b&d); k = 0x5A827999; }
+            else if (i<40) { f = b^c^d; k = 0x6ED9EBA1; }
+            else if (i<60) { f = (b&c)|(b&d)|(c&d); k = 0x8F1BBCDC; }
+            else { f = b^c^d; k = 0xCA62C1D6; }
+
+            uint32_t t = ((a<<5)|(a>>27)) + f + e + k + w[i];
+            e = d; d = c; c = (b<<30)|(b>>2); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i=0; i<20; i++) digest[i] = (unsigned char)(h[i/4]>>(24-8*(i%4)));
+}
+
+/**
+ * @brief Compute MusicBrainz disc ID from disc TOC
+ * @param[in] first track number
+ * @param[in] track offsets in sectors (incl. the 150-sector lead-in)
+ * @param[in] lead-out offset in sectors (incl. the 150-sector lead-in)
+ * @return 28-character disc ID string
+ */
+std::string musicbrainz_discid(const int first, const std::vector<size_t> &offsets, const size_t leadout)
+{
+    // hex string of first & last track numbers, lead-out, and 99 track offsets
+    char buf[2+2+8*100+1];
+    char *p = buf;
+    p += sprintf(p, "%02X%02X", first, first+(int)offsets.size()-1);
+    p += sprintf(p, "%08X", (unsigned)leadout);
+    for (size_t i=0; i<99; i++)
+        p += sprintf(p, "%08X", (unsigned)(i<offsets.size() ? offsets[i] : 0));
+
+    unsigned char digest[20];
+    sha1(buf, p-buf, digest);
+
+    // base64 with the URL-safe substitutions of MusicBrainz ('.', '_', '-')
+    static const char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._";
+    string id;
+    id.reserve(28);
+    for (int i=0; i<20; i+=3)
+    {
+        uint32_t v = digest[i]<<16 | (i+1<20 ? digest[i+1]<<8 : 0) | (i+2<20 ? digest[i+2] : 0);
+        id += table[(v>>18)&63];
+        id += table[(v>>12)&63];
+        id += (i+1<20) ? table[(v>>6)&63] : '-';
+        id += (i+2<20) ? table[v&63] : '-';
+    }
+
+    return id;
+}
+
+/**
+ * @brief Create a directory along with its missing parent directories
+ * @param[in] directory path
+ * @return true if the directory exists (or has been created)
+ */
+bool make_dirs(const std::string &path)
+{
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos+1))
+    {
+        string dir = path.substr(0, pos);
+        if (!dir.empty() && mkdir(dir.c_str(), 0755) && errno!=EEXIST) return false;
+        if (pos==string::npos) break;
+    }
+
+    struct stat st;
+    return !stat(path.c_str(), &st) && S_ISDIR(st.st_mode);
+}
+
+/**
+ * @brief Get the directory part of a file path
+ * @param[in] file path
+ * @return directory path ("." if the path has no directory part)
+ */
+std::string parent_dir(const std::string &path)
+{
+    size_t pos = path.find_last_of('/');
+    if (pos==string::npos) return ".";
+    if (!pos) return "/";
+    return path.substr(0, pos);
+}
+
+/**
+ * @brief Lock the file (blocks until locked)
+ * @param[in] file descriptor
+ * @param[in] LOCK_SH or LOCK_EX
+ */
+SFileLock::SFileLock(int f, int op) : fd(f)
+{
+    while (flock(fd, op) && errno==EINTR) {}
+}
+
+SFileLock::~SFileLock()
+{
+    flock(fd, LOCK_UN);
+}
+
+/**
+ * @brief Check if the file at a path is not the open file anymore (i.e.,
+ *        replaced or removed by another process)
+ * @param[in] file path
+ * @param[in] file descriptor of the open file
+ * @return true if replaced
+ */
+bool file_replaced(const std::string &path, int fd)
+{
+    struct stat st_path, st_fd;
+    if (stat(path.c_str(), &st_path) || fstat(fd, &st_fd)) return true;
+    return st_path.st_ino!=st_fd.st_ino || st_path.st_dev!=st_fd.st_dev;
+}
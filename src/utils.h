@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 /**
  * @brief Remove non-digit characters from UPC barcode
@@ -16,6 +19,70 @@ void cleanup_upc(std::string &upc);
  */
 std::string itoroman (int val);
 
+/**
+ * @brief Sign-extend 16-bit samples to 32-bit samples. Uses SSE2/AVX2
+ *        when available.
+ * @param[out] destination buffer with room for n samples
+ * @param[in] source buffer
+ * @param[in] number of samples
+ */
+void widen_int16(int32_t *dst, const int16_t *src, const size_t n);
+
+/**
+ * @brief Compute MusicBrainz disc ID from disc TOC
+ * @param[in] first track number
+ * @param[in] track offsets in sectors (incl. the 150-sector lead-in)
+ * @param[in] lead-out offset in sectors (incl. the 150-sector lead-in)
+ * @return 28-character disc ID string
+ */
+std::string musicbrainz_discid(const int first, const std::vector<size_t> &offsets, const size_t leadout);
+
+/**
+ * @brief Compute SHA-1 message digest
+ * @param[in] message
+ * @param[in] message length in bytes
+ * @param[out] 20-byte digest
+ */
+void sha1(const void *data, const size_t len, unsigned char digest[20]);
+
+/**
+ * @brief Create a directory along with its missing parent directories
+ * @param[in] directory path
+ * @return true if the directory exists (or has been created)
+ */
+bool make_dirs(const std::string &path);
+
+/**
+ * @brief Get the directory part of a file path
+ * @param[in] file path
+ * @return directory path ("." if the path has no directory part)
+ */
+std::string parent_dir(const std::string &path);
+
+/**
+ * @brief Holds a flock() on a file for the lifetime of the object
+ */
+struct SFileLock
+{
+    int fd;
+
+    /**
+     * @brief Lock the file (blocks until locked)
+     * @param[in] file descriptor
+     * @param[in] LOCK_SH or LOCK_EX
+     */
+    SFileLock(int fd, int op);
+    ~SFileLock();
+};
+
+/**
+ * @brief Check if the file at a path is not the open file anymore (i.e.,
+ *        replaced or removed by another process)
+ * @param[in] file path
+ * @param[in] file descriptor of the open file
+ * @return true if replaced
+ */
+bool file_replaced(const std::string &path, int fd);
 
 struct string_key_comparer
 {
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+#include "CCdRipper.h"
+#include "CFileNameGenerator.h"
+#include "testutils.h"
+
+static const size_t SECTORSIZE = 1176; // 16-bit samples per sector
+
+// sample value identifying its position on the disc
+static int16_t sample_at(const size_t pos) { return (int16_t)(pos*2654435761u>>16); }
+
+/**
+ * @brief Fake CD source delivering a deterministic signal
+ */
+class CTestSource : public ISourceCdda
+{
+public:
+    CTestSource(const size_t len) : length(len), curr(0), sector(SECTORSIZE) {}
+
+    std::string GetDevicePath() const { return "test"; }
+    size_t GetSectorSize() const { return SECTORSIZE; }
+
+    const int16_t* ReadNextSector()
+    {
+        if (!ReadSectors(sector.data(), 1)) return NULL;
+        return sector.data();
+    }
+
+    size_t ReadSectors(int16_t *buf, const size_t nsectors)
+    {
+        size_t n = std::min(nsectors, length-curr);
+        for (size_t i = 0; i<n*SECTORSIZE; i++)
+            buf[i] = sample_at(curr*SECTORSIZE+i);
+        curr += n;
+        return n;
+    }
+
+    void Rewind() { curr = 0; }
+    size_t GetLength(cdtimeunit_t units=CDTIMEUNIT_SECTORS) const { return length; }
+    SCueSheet GetCueSheet() const { return SCueSheet(); }
+
+private:
+    size_t length;
+    size_t curr;
+    std::vector<int16_t> sector;
+};
+
+// data captured by the sinks, by file path
+static std::mutex mutex_files;
+static std::map<std::string, std::vector<int16_t>> files;
+
+/**
+ * @brief Sink capturing the data written to it
+ */
+class CCaptureSink : public ISink
+{
+public:
+    CCaptureSink(const std::string &p) : path(p), sign(0), npreambles(0), npostambles(0) {}
+
+    bool IsLocked() { return sign!=0; }
+    void Lock(const uintptr_t s) { sign = s; }
+    bool TryLock(const uintptr_t s) { sign = s; return true; }
+    bool Unlock(const uintptr_t s) { sign = 0; return true; }
+    void WaitTillUnlock() {}
+    void Reserve(const size_t nsamples) { data.reserve(nsamples); }
+
+    void WritePreamble(const uintptr_t s) { npreambles++; data.clear(); }
+    int WriteFrame(const int16_t* buf, const size_t framesize, const uintptr_t s)
+    {
+        if (s!=sign) throw(std::runtime_error("Sink not locked."));
+        data.insert(data.end(), buf, buf+framesize);
+        return framesize;
+    }
+    void WritePostamble(const uintptr_t s)
+    {
+        npostambles++;
+        std::lock_guard<std::mutex> lck(mutex_files);
+        files[path] = data;
+    }
+
+    bool CueSheetEmbeddable() { return false; }
+    void SetCueSheet(const SCueSheet& cuesheet) {}
+    void SetCoverArt(const std::vector<unsigned char> &data, const bool front) {}
+    void SetFinalPath(const std::string &p) {}
+
+    std::string path;
+    uintptr_t sign;
+    int npreambles;
+    int npostambles;
+    std::vector<int16_t> data;
+};
+
+// track data must span from its index 1 to the index 1 of the next track
+static void check_track(const std::string &path, const size_t begin, const size_t end)
+{
+    std::lock_guard<std::mutex> lck(mutex_files);
+    auto it = files.find(path);
+    CHECK(it!=files.end());
+    if (it==files.end()) return;
+
+    const std::vector<int16_t> &data = it->second;
+    CHECK(data.size()==(end-begin)*SECTORSIZE);
+
+    bool same = true;
+    for (size_t i = 0; i<data.size() && same; i++)
+        same = data[i]==sample_at(begin*SECTORSIZE+i);
+    CHECK(same);
+}
+
+// 3 tracks on 27 sectors: 3-sector hidden track, track 2 with a 3-sector
+// pregap (index 0 at 9, index 1 at 12), track 3 without pregap
+static void rip(const size_t batchsize, const unsigned nencoders)
+{
+    SCueSheet cs;
+    cs.AddTracks(3);
+    cs.Tracks[0].AddIndex(1,3);
+    cs.Tracks[1].AddIndex(0,9);
+    cs.Tracks[1].AddIndex(1,12);
+    cs.Tracks[2].AddIndex(1,20);
+    cs.TotalTime = 27;
+
+    files.clear();
+
+    CTestSource source(cs.TotalTime);
+    CCaptureSink disc("disc");
+    CCdRipper ripper(source, disc);
+    ripper.SetBatchSize(batchsize);
+
+    CFileNameGenerator namer("", "%tracknumber%", OutputFileFormat::WAVPACK);
+    ripper.SetTrackMode(cs, namer, [](const std::string &path) { return new CCaptureSink(path); }, nencoders);
+
+    ripper.Start();
+    ripper.WaitTillDone();
+    ripper.Stop();
+
+    CHECK(!ripper.Canceled());
+    CHECK(files.size()==3);
+
+    // the disc sink sees the entire disc, hidden track included (its
+    // preamble & postamble are left to the caller)
+    CHECK(disc.npreambles==0 && disc.npostambles==0);
+    disc.WritePostamble(0);
+    check_track("disc", 0, 27);
+
+    // pregap of track 2 goes with track 1
+    check_track("01.wv", 3, 12);
+    check_track("02.wv", 12, 20);
+    check_track("03.wv", 20, 27);
+}
+
+// without any sink, the disc is read through (no ring buffer to feed)
+static void rip_no_sinks()
+{
+    CTestSource source(27);
+    CCdRipper ripper(source, ISinkRefVector());
+
+    ripper.Start();
+    ripper.WaitTillDone();
+    ripper.Stop();
+
+    CHECK(!ripper.Canceled());
+    int16_t sector[SECTORSIZE];
+    CHECK(source.ReadSectors(sector, 1)==0);
+}
+
+int main()
+{
+    rip_no_sinks();
+    rip(1, 1);  // a sector at a time
+    rip(4, 2);  // batches straddling the track boundaries
+    rip(64, 3); // the whole disc in one batch
+
+    return test_result();
+}
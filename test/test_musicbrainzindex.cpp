@@ -0,0 +1,246 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <unistd.h>
+
+#include "CDbMusicBrainzIndex.h"
+#include "utils.h"
+#include "testutils.h"
+
+using std::string;
+
+// fixture paths, in a temporary directory (see main())
+static string path, tsvpath;
+
+// example TOC from the MusicBrainz disc ID documentation
+static string example_discid()
+{
+    std::vector<size_t> offsets = {150, 15363, 32314, 46592, 63414, 80489};
+    return musicbrainz_discid(1, offsets, 95462);
+}
+
+static string fake_key(const int i)
+{
+    return "disc" + std::to_string(i) + "-";
+}
+
+static void test_insert_lookup()
+{
+    const string key = example_discid();
+    CHECK(key=="49HHV7Eb8UKF3aQiNmu1GR8vKTY-");
+
+    CDbMusicBrainzIndex index(path);
+    SMusicBrainzIndexReleases releases;
+    CHECK(!index.Lookup(key, releases));
+    CHECK(index.NumberOfEntries()==0);
+
+    SMusicBrainzIndexReleases in;
+    in.emplace_back("a4864e94-6d75-4ade-bc93-0dabf3521453", 1, "<metadata/>", "en/artist-1\t1\tName\n");
+    in.emplace_back("0bd6f2e3-5f7c-4d6c-9c8f-4e6b2a3f0a11", 2);
+    index.Insert(key, in);
+
+    CHECK(index.Lookup(key, releases));
+    CHECK(releases.size()==2);
+    CHECK(releases[0].id==in[0].id && releases[0].disc==1 && releases[0].data=="<metadata/>");
+    CHECK(releases[0].artists==in[0].artists);
+    CHECK(releases[1].id==in[1].id && releases[1].disc==2 && releases[1].data.empty());
+    CHECK(releases[1].artists.empty());
+
+    // replacing an entry
+    in.resize(1);
+    in[0].data = "<metadata>updated</metadata>";
+    index.Insert(key, in);
+    CHECK(index.Lookup(key, releases));
+    CHECK(releases.size()==1 && releases[0].data==in[0].data);
+    CHECK(index.NumberOfEntries()==1);
+}
+
+// grow past the initial hash table (4096 buckets at 50% load)
+static void test_rebuild()
+{
+    {
+        CDbMusicBrainzIndex index(path);
+        for (int i = 0; i<5000; i++)
+            index.Insert(fake_key(i), SMusicBrainzIndexReleases(1, SMusicBrainzIndexRelease("id"+std::to_string(i), 1+i%3)));
+        CHECK(index.NumberOfEntries()==5001);
+    }
+
+    // reopen
+    CDbMusicBrainzIndex index(path);
+    CHECK(index.NumberOfEntries()==5001);
+
+    SMusicBrainzIndexReleases releases;
+    bool all = true;
+    for (int i = 0; i<5000 && all; i++)
+        all = index.Lookup(fake_key(i), releases) && releases.size()==1
+                && releases[0].id=="id"+std::to_string(i) && releases[0].disc==1+i%3;
+    CHECK(all);
+
+    CHECK(index.Lookup(example_discid(), releases));
+    CHECK(releases.size()==1 && releases[0].data=="<metadata>updated</metadata>");
+}
+
+static void test_import()
+{
+    {
+        std::ofstream os(tsvpath.c_str());
+        os << example_discid() << "\trel-1\t1\n"
+           << example_discid() << "\trel-2\t2\n"
+           << "tsvdisc-\trel-3\n"
+           << "malformed line\n"
+           << "\trel-4\t1\n";
+    }
+
+    CDbMusicBrainzIndex index(path);
+    CHECK(index.Import(tsvpath)==2);
+
+    SMusicBrainzIndexReleases releases;
+    CHECK(index.Lookup(example_discid(), releases));
+    CHECK(releases.size()==2);
+    CHECK(releases[0].id=="rel-1" && releases[0].disc==1 && releases[0].data.empty());
+    CHECK(releases[1].id=="rel-2" && releases[1].disc==2);
+
+    CHECK(index.Lookup("tsvdisc-", releases));
+    CHECK(releases.size()==1 && releases[0].id=="rel-3" && releases[0].disc==1);
+
+    CHECK(index.NumberOfEntries()==5002);
+
+    bool threw = false;
+    try { index.Import(tsvpath+".missing"); } catch (std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
+
+// an index of an older format is started over
+static void test_old_version()
+{
+    {
+        CDbMusicBrainzIndex index(path);
+        index.Insert("olddisc-", SMusicBrainzIndexReleases(1, SMusicBrainzIndexRelease("rel-1")));
+    }
+    {
+        std::fstream fs(path.c_str(), std::ios::in|std::ios::out|std::ios::binary);
+        uint32_t version = 1;
+        fs.seekp(4); fs.write((const char*)&version, 4);
+    }
+
+    CDbMusicBrainzIndex index(path);
+    SMusicBrainzIndexReleases releases;
+    CHECK(index.NumberOfEntries()==0);
+    CHECK(!index.Lookup("olddisc-", releases));
+
+    index.Insert("olddisc-", SMusicBrainzIndexReleases(1, SMusicBrainzIndexRelease("rel-1")));
+    CHECK(index.Lookup("olddisc-", releases) && releases.size()==1);
+}
+
+// two users of the same file (e.g., two processes) see each other's updates
+static void test_shared()
+{
+    CDbMusicBrainzIndex index1(path);
+    CDbMusicBrainzIndex index2(path);
+    SMusicBrainzIndexReleases releases;
+
+    index1.Insert("shared1-", SMusicBrainzIndexReleases(1, SMusicBrainzIndexRelease("rel-1")));
+    CHECK(index2.Lookup("shared1-", releases) && releases.size()==1 && releases[0].id=="rel-1");
+
+    // grown by the other one
+    for (int i = 0; i<100; i++)
+        index2.Insert(fake_key(i), SMusicBrainzIndexReleases(1, SMusicBrainzIndexRelease("id", 1, string(1000, 'x'))));
+    CHECK(index1.Lookup(fake_key(99), releases) && releases.size()==1 && releases[0].data.size()==1000);
+
+    // rebuilt (i.e., replaced) by the other one
+    for (int i = 100; i<5000; i++)
+        index2.Insert(fake_key(i), SMusicBrainzIndexReleases(1, SMusicBrainzIndexRelease("id")));
+    CHECK(index1.NumberOfEntries()==5001);
+    index1.Insert("shared2-", SMusicBrainzIndexReleases(1, SMusicBrainzIndexRelease("rel-2")));
+    CHECK(index2.Lookup("shared2-", releases) && releases.size()==1 && releases[0].id=="rel-2");
+    CHECK(index2.Lookup("shared1-", releases) && releases.size()==1 && releases[0].id=="rel-1");
+}
+
+// bucket offsets & record lengths pointing out of the file must be misses
+static void test_corrupt()
+{
+    const size_t hdrsize = 32, bucketsize = 16;
+
+    std::fstream fs(path.c_str(), std::ios::in|std::ios::out|std::ios::binary);
+    uint64_t nbuckets, end;
+    fs.seekg(8); fs.read((char*)&nbuckets, 8);
+    fs.seekg(24); fs.read((char*)&end, 8);
+
+    // find the buckets of two keys by their record offsets
+    std::vector<uint64_t> offsets;
+    for (uint64_t i = 0; i<nbuckets && offsets.size()<2; i++)
+    {
+        uint64_t offset;
+        fs.seekg(hdrsize+i*bucketsize+8);
+        fs.read((char*)&offset, 8);
+        if (offset) offsets.push_back(hdrsize+i*bucketsize+8);
+    }
+
+    // point the first bucket beyond the end, & the second record's release
+    // count to a huge number
+    uint64_t bad = end+1000000;
+    fs.seekp(offsets[0]); fs.write((const char*)&bad, 8);
+
+    uint64_t rec;
+    fs.seekg(offsets[1]); fs.read((char*)&rec, 8);
+    uint32_t keylen, nrel = 0xffffffff;
+    fs.seekg(rec); fs.read((char*)&keylen, 4);
+    fs.seekp(rec+4); fs.write((const char*)&nrel, 4);
+    fs.close();
+
+    string key;
+    {
+        std::ifstream is(path.c_str(), std::ios::binary);
+        key.resize(keylen);
+        is.seekg(rec+8); is.read(&key[0], keylen);
+    }
+
+    CDbMusicBrainzIndex index(path);
+    SMusicBrainzIndexReleases releases;
+    CHECK(!index.Lookup(key, releases));
+
+    // lookups of the other keys probe through the bad buckets safely
+    size_t nfound = 0;
+    for (int i = 0; i<5000; i++)
+        if (index.Lookup(fake_key(i), releases)) nfound++;
+    CHECK(nfound>=4998);
+
+    // invalid number of buckets
+    {
+        std::fstream fs2(path.c_str(), std::ios::in|std::ios::out|std::ios::binary);
+        uint64_t n = 3;
+        fs2.seekp(8); fs2.write((const char*)&n, 8);
+    }
+    bool threw = false;
+    try { CDbMusicBrainzIndex index2(path); } catch (std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
+
+int main()
+{
+    const string dir = make_temp_dir("test_musicbrainzindex");
+    path = dir + "/musicbrainz.idx";
+    tsvpath = dir + "/musicbrainz.tsv";
+
+    test_insert_lookup();
+    test_rebuild();
+    test_import();
+    test_corrupt();
+
+    remove(path.c_str());
+    test_shared();
+
+    remove(path.c_str());
+    test_old_version();
+
+    remove_temp_dir(dir);
+
+    return test_result();
+}
@@ -0,0 +1,140 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "CSectorRingBuffer.h"
+#include "testutils.h"
+
+// a slot must stay with the readers until every one of them released it
+static void test_refcount()
+{
+    CSectorRingBuffer ring(2, 4, 2);
+    size_t n;
+
+    // fill the ring
+    for (int k=0;k<2;k++)
+    {
+        int16_t *slot = ring.BeginWrite();
+        CHECK(slot!=NULL);
+        for (int i=0;i<4;i++) slot[i] = k*10+i;
+        ring.EndWrite(4-k);
+    }
+
+    // reader 0 drains both slots; the producer must still be blocked
+    for (int k=0;k<2;k++)
+    {
+        const int16_t *slot = ring.BeginRead(n,0);
+        CHECK(slot!=NULL && n==size_t(4-k) && slot[0]==k*10);
+        ring.EndRead(0);
+    }
+
+    bool written = false;
+    std::thread producer([&]()
+    {
+        int16_t *slot = ring.BeginWrite();
+        if (slot) { slot[0] = 20; ring.EndWrite(1); written = true; }
+        ring.Close();
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!written);
+
+    // reader 1 still sees the original data of the oldest slot
+    const int16_t *slot = ring.BeginRead(n,1);
+    CHECK(slot!=NULL && n==4 && slot[3]==3);
+    ring.EndRead(1); // releases slot 0 back to the producer
+
+    producer.join();
+    CHECK(written);
+
+    slot = ring.BeginRead(n,1);
+    CHECK(slot!=NULL && n==3 && slot[0]==10);
+    ring.EndRead(1);
+
+    // both readers get the new slot, then the end of data
+    for (size_t r=0;r<2;r++)
+    {
+        slot = ring.BeginRead(n,r);
+        CHECK(slot!=NULL && n==1 && slot[0]==20);
+        ring.EndRead(r);
+        CHECK(ring.BeginRead(n,r)==NULL && n==0);
+    }
+}
+
+// concurrent readers must each see the full sequence in order
+static void test_stream()
+{
+    const size_t nreaders = 3;
+    const int nslots = 1000;
+    CSectorRingBuffer ring(8, 16, nreaders);
+
+    std::vector<bool> ok(nreaders,false);
+    std::vector<std::thread> readers;
+    for (size_t r=0;r<nreaders;r++)
+        readers.emplace_back([&ring,&ok,r]()
+        {
+            size_t n;
+            int expected = 0;
+            const int16_t *slot;
+            bool good = true;
+            while ((slot = ring.BeginRead(n,r)))
+            {
+                if (n!=16 || slot[0]!=int16_t(expected) || slot[15]!=int16_t(expected)) good = false;
+                expected++;
+                ring.EndRead(r);
+            }
+            ok[r] = good && expected==nslots;
+        });
+
+    for (int k=0;k<nslots;k++)
+    {
+        int16_t *slot = ring.BeginWrite();
+        for (int i=0;i<16;i++) slot[i] = k;
+        ring.EndWrite(16);
+    }
+    ring.Close();
+
+    for (auto &t : readers) t.join();
+    for (size_t r=0;r<nreaders;r++) CHECK(ok[r]);
+}
+
+// Abort() must release a blocked producer and blocked readers
+static void test_abort()
+{
+    CSectorRingBuffer ring(1, 1, 2);
+    ring.BeginWrite();
+    ring.EndWrite(1);
+
+    int16_t *wslot = (int16_t*)1;
+    std::thread producer([&]() { wslot = ring.BeginWrite(); });
+
+    size_t n;
+    ring.BeginRead(n,0);
+    ring.EndRead(0);
+    const int16_t *rslot = (int16_t*)1;
+    std::thread reader([&]() { rslot = ring.BeginRead(n,0); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ring.Abort();
+    producer.join();
+    reader.join();
+
+    CHECK(ring.Aborted());
+    CHECK(wslot==NULL);
+    CHECK(rslot==NULL);
+}
+
+int main()
+{
+    bool threw = false;
+    try { CSectorRingBuffer ring(0,1,1); } catch (std::invalid_argument&) { threw = true; }
+    CHECK(threw);
+
+    test_refcount();
+    test_stream();
+    test_abort();
+
+    return test_result();
+}
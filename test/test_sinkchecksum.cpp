@@ -0,0 +1,105 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+
+#include "CSinkChecksum.h"
+#include "testutils.h"
+
+// Reference checksums of the test signal below, computed independently with
+// the AccurateRip v1/v2 formulas and zlib's crc32():
+//   { AccurateRip v1, AccurateRip v2, CRC32, CRC32 w/o null samples }
+static const uint32_t expected[3][4] = {
+    { 0xE1DDC4B6, 0xE2005702, 0x880D1CB8, 0x7207236F },
+    { 0x5B03AAC3, 0x5BD02FD8, 0xD2055694, 0x7650A19E },
+    { 0x7EFB3AF3, 0x7F54F003, 0x2E19BC23, 0xD01C1AEF },
+};
+
+static const size_t SPS = 588; // stereo samples per sector
+
+// 3-track disc: 2-sector hidden pregap, tracks starting at sectors 2, 10 & 25,
+// 40 sectors total
+static SCueSheet make_cuesheet()
+{
+    SCueSheet cs;
+    cs.AddTracks(3);
+    cs.Tracks[0].AddIndex(1,2);
+    cs.Tracks[1].AddIndex(1,10);
+    cs.Tracks[2].AddIndex(1,25);
+    cs.TotalTime = 40;
+    return cs;
+}
+
+// pseudo-random signal with silent stretches
+static std::vector<int16_t> make_signal(const size_t nsectors)
+{
+    std::vector<int16_t> data(nsectors*SPS*2);
+    uint32_t x = 12345;
+    for (size_t i = 0; i<data.size(); i++)
+    {
+        x = x*1664525u+1013904223u;
+        uint16_t s = x>>16;
+        if ((i/2)%7==0 || (i/64)%5==0) s = 0;
+        data[i] = (int16_t)s;
+    }
+    return data;
+}
+
+// feed the signal in frames of the given size (in 16-bit samples)
+static void run(CSinkChecksum &sink, const std::vector<int16_t> &data, const size_t framesize)
+{
+    uintptr_t sign = (uintptr_t)&sink;
+    sink.Lock(sign);
+    sink.WritePreamble(sign);
+    for (size_t i = 0; i<data.size(); i += framesize)
+    {
+        size_t n = std::min(framesize, data.size()-i);
+        CHECK(sink.WriteFrame(data.data()+i, n, sign)==(int)n);
+    }
+    sink.WritePostamble(sign);
+    sink.Unlock(sign);
+}
+
+static void check_results(const CSinkChecksum &sink)
+{
+    CHECK(sink.NumberOfTracks()==3);
+    for (size_t t = 1; t<=3; t++)
+    {
+        CHECK(sink.GetAccurateRipV1(t)==expected[t-1][0]);
+        CHECK(sink.GetAccurateRipV2(t)==expected[t-1][1]);
+        CHECK(sink.GetCRC32(t)==expected[t-1][2]);
+        CHECK(sink.GetCRC32NoSilence(t)==expected[t-1][3]);
+    }
+}
+
+int main()
+{
+    SCueSheet cs = make_cuesheet();
+    std::vector<int16_t> data = make_signal(cs.TotalTime);
+
+    CSinkChecksum sink(cs);
+
+    // whole sectors, as CCdRipper delivers them
+    run(sink, data, 2*SPS);
+    check_results(sink);
+
+    // frames straddling the track boundaries; WritePreamble() must reset
+    run(sink, data, 2*1000);
+    check_results(sink);
+
+    // one frame for the whole disc
+    run(sink, data, data.size());
+    check_results(sink);
+
+    // REM fields
+    sink.AppendRems(cs);
+    CHECK(cs.Tracks[0].Rems.size()==4);
+    CHECK(cs.Tracks[0].Rems[0]=="ACCURATERIPV1 E1DDC4B6");
+    CHECK(cs.Tracks[2].Rems[3]=="CRC32NS D01C1AEF");
+
+    bool threw = false;
+    try { sink.GetCRC32(4); } catch (std::out_of_range&) { threw = true; }
+    CHECK(threw);
+
+    return test_result();
+}
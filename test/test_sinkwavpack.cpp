@@ -0,0 +1,162 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <wavpack/wavpack.h>
+
+#include "CSinkWavPack.h"
+#include "testutils.h"
+
+// 3.5 parallel segments (8 blocks of 22050 stereo samples each) plus a
+// partial block, in stereo samples
+static const uint32_t NSAMPLES = 22050*8*3 + 22050*4 + 1234;
+
+// fake JPEG cover art (with NUL bytes to check the binary tag)
+static const unsigned char COVER[] = {0xff, 0xd8, 0xff, 0xe0, 0, 1, 2, 0, 0xff, 0xd9};
+
+static uint32_t get_le32(const unsigned char *p)
+{
+    return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24);
+}
+
+static std::vector<int16_t> make_signal()
+{
+    std::vector<int16_t> data(2*NSAMPLES);
+    uint32_t x = 1;
+    for (size_t i = 0; i<data.size(); i++)
+    {
+        x = x*1664525u+1013904223u;
+        data[i] = (int16_t)((x>>20) + 2000*((i/2000)%3)); // compressible noise
+    }
+    return data;
+}
+
+// encode the signal into a file, in frames of one CD sector
+static void encode(const std::string &path, const std::vector<int16_t> &data, const unsigned nthreads)
+{
+    CSinkWavPack sink(path);
+    sink.SetThreads(nthreads);
+    sink.tags.AppendTag("Title", "test");
+
+    // deferred tags, as set by the cuesheet builder while ripping
+    SCueSheet cs;
+    cs.Title = "Album";
+    cs.AddTracks(1);
+    cs.Tracks[0].AddIndex(1, 0);
+    sink.SetCueSheet(cs);
+    sink.SetCoverArt(std::vector<unsigned char>(COVER, COVER+sizeof(COVER)), true);
+
+    sink.Reserve(data.size()); // preallocated space must be released
+    uintptr_t sign = (uintptr_t)&sink;
+    sink.Lock(sign);
+    sink.WritePreamble(sign);
+    for (size_t i = 0; i<data.size(); i += 1176)
+        sink.WriteFrame(data.data()+i, std::min<size_t>(1176, data.size()-i), sign);
+    sink.WritePostamble(sign);
+    sink.Unlock(sign);
+}
+
+// walk the WavPack blocks: block indexes must be contiguous & the first
+// block must carry the total number of samples
+static void check_blocks(const std::string &path)
+{
+    std::ifstream is(path, std::ios::binary);
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+    uint32_t index = 0;
+    size_t nblocks = 0;
+    for (size_t pos = 0; pos+32<=file.size() && !memcmp(&file[pos], "wvpk", 4);)
+    {
+        const unsigned char *hdr = &file[pos];
+        if (!nblocks)
+        {
+            CHECK(hdr[11]==0); // total_samples_u8
+            CHECK(get_le32(hdr+12)==NSAMPLES);
+        }
+        CHECK(hdr[10]==0); // block_index_u8
+        CHECK(get_le32(hdr+16)==index);
+        index += get_le32(hdr+20);
+        pos += get_le32(hdr+4)+8;
+        nblocks++;
+    }
+    CHECK(nblocks>1);
+    CHECK(index==NSAMPLES);
+}
+
+// decode the file & compare it with the signal
+static void check_decode(const std::string &path, const std::vector<int16_t> &data)
+{
+    char error[80];
+    WavpackContext *wpc = WavpackOpenFileInput(path.c_str(), error, 0, 0);
+    CHECK(wpc!=NULL);
+    if (!wpc) return;
+
+    CHECK(WavpackGetNumSamples(wpc)==NSAMPLES);
+
+    std::vector<int32_t> buf(2*4096);
+    size_t pos = 0;
+    bool same = true;
+    uint32_t n;
+    while ((n = WavpackUnpackSamples(wpc, buf.data(), 4096)))
+    {
+        for (size_t i = 0; i<2*n && same; i++)
+            same = pos+i<data.size() && buf[i]==data[pos+i];
+        pos += 2*n;
+    }
+    CHECK(same);
+    CHECK(pos==data.size());
+
+    WavpackCloseFile(wpc);
+}
+
+// read the APEv2 tag back
+static void check_tags(const std::string &path)
+{
+    char error[80];
+    WavpackContext *wpc = WavpackOpenFileInput(path.c_str(), error, OPEN_TAGS, 0);
+    CHECK(wpc!=NULL);
+    if (!wpc) return;
+
+    CHECK(WavpackGetMode(wpc)&MODE_APETAG);
+
+    char val[4096];
+    CHECK(WavpackGetTagItem(wpc, "Title", val, sizeof(val))==4 && !strcmp(val, "test"));
+    CHECK(WavpackGetTagItem(wpc, "cuesheet", val, sizeof(val))>0 && strstr(val, "Album"));
+
+    // binary item: "front.jpg\0" followed by the image
+    const std::string name("front.jpg");
+    int len = WavpackGetBinaryTagItem(wpc, "Cover Art (Front)", val, sizeof(val));
+    CHECK(len==(int)(name.size()+1+sizeof(COVER)));
+    CHECK(len>0 && name==val && !memcmp(val+name.size()+1, COVER, sizeof(COVER)));
+
+    WavpackCloseFile(wpc);
+}
+
+int main()
+{
+    std::vector<int16_t> data = make_signal();
+
+    const std::string dir = make_temp_dir("test_sinkwavpack");
+    const std::string serial = dir + "/serial.wv";
+    const std::string parallel = dir + "/parallel.wv";
+
+    encode(serial, data, 1);
+    encode(parallel, data, 4);
+
+    check_blocks(serial);
+    check_blocks(parallel);
+    check_decode(serial, data);
+    check_decode(parallel, data);
+    check_tags(serial);
+    check_tags(parallel);
+
+    remove_temp_dir(dir);
+
+    return test_result();
+}
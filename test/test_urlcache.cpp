@@ -0,0 +1,153 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CUtilUrlCache.h"
+#include "testutils.h"
+
+using std::string;
+
+static off_t file_size(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? -1 : st.st_size;
+}
+
+// store, look up, overwrite, and reopen
+static void test_store_lookup(const string &dir)
+{
+    CUtilUrlCache::SEntry entry;
+    {
+        CUtilUrlCache cache(dir);
+        CHECK(!cache.Lookup("http://a/1", entry));
+
+        cache.Store("http://a/1", "body 1", "\"etag1\"", "Mon, 01 Jan 2018 00:00:00 GMT");
+        cache.Store("http://a/2", string("bin\0ary", 7), "", "");
+
+        CHECK(cache.Lookup("http://a/1", entry));
+        CHECK(entry.data=="body 1");
+        CHECK(entry.etag=="\"etag1\"");
+        CHECK(entry.lastmod=="Mon, 01 Jan 2018 00:00:00 GMT");
+        CHECK(cache.Fresh(entry));
+
+        CHECK(cache.Lookup("http://a/2", entry));
+        CHECK(entry.data==string("bin\0ary", 7));
+        CHECK(entry.etag.empty() && entry.lastmod.empty());
+
+        // a newer response supersedes the older one
+        cache.Store("http://a/1", "body 1b", "\"etag1b\"", "");
+        CHECK(cache.Lookup("http://a/1", entry));
+        CHECK(entry.data=="body 1b" && entry.etag=="\"etag1b\"");
+    }
+
+    // persists across instances
+    CUtilUrlCache cache(dir);
+    CHECK(cache.Lookup("http://a/1", entry));
+    CHECK(entry.data=="body 1b");
+    CHECK(cache.Lookup("http://a/2", entry));
+
+    cache.Clear();
+    CHECK(!cache.Lookup("http://a/1", entry));
+}
+
+// a stale entry comes back fresh after a "304 Not Modified" refresh
+static void test_refresh(const string &dir)
+{
+    CUtilUrlCache::SEntry entry;
+    {
+        CUtilUrlCache cache(dir, 1);
+        cache.Store("http://b/1", "body", "\"e\"", "");
+        sleep(2);
+
+        CHECK(cache.Lookup("http://b/1", entry));
+        CHECK(!cache.Fresh(entry));
+
+        cache.Refresh("http://b/1");
+        CHECK(cache.Lookup("http://b/1", entry));
+        CHECK(cache.Fresh(entry));
+        CHECK(entry.data=="body");
+
+        cache.Refresh("http://b/none"); // no-op
+        CHECK(!cache.Lookup("http://b/none", entry));
+    }
+
+    // the refreshed time persists
+    CUtilUrlCache cache(dir, 1);
+    CHECK(cache.Lookup("http://b/1", entry));
+    CHECK(cache.Fresh(entry));
+}
+
+// the data file is compacted once it outgrows the size cap, keeping the
+// most recent entries
+static void test_compaction(const string &dir)
+{
+    const uint64_t maxsize = 64*1024;
+    const string body(1000, 'x');
+
+    CUtilUrlCache cache(dir, 3600, maxsize);
+    for (int i = 0; i<1000; i++)
+        cache.Store("http://c/"+std::to_string(i), body, "", "");
+
+    CHECK(file_size(dir+"/cache.dat")<=(off_t)maxsize);
+
+    CUtilUrlCache::SEntry entry;
+    CHECK(cache.Lookup("http://c/999", entry));
+    CHECK(entry.data==body);
+    CHECK(!cache.Lookup("http://c/0", entry));
+
+    // the compacted files are valid on reopen
+    CUtilUrlCache cache2(dir, 3600, maxsize);
+    CHECK(cache2.Lookup("http://c/999", entry));
+    CHECK(entry.data==body);
+}
+
+// two instances (as two processes would) sharing the directory see each
+// other's records and survive each other's compactions
+static void test_shared(const string &dir)
+{
+    const uint64_t maxsize = 16*1024;
+    CUtilUrlCache a(dir, 3600, maxsize);
+    CUtilUrlCache b(dir, 3600, maxsize);
+    CUtilUrlCache::SEntry entry;
+
+    a.Store("http://d/a", "from a", "", "");
+    b.Store("http://d/b", "from b", "", "");
+
+    CHECK(b.Lookup("http://d/a", entry) && entry.data=="from a");
+    CHECK(a.Lookup("http://d/b", entry) && entry.data=="from b");
+
+    // interleaved stores past the cap, compacted by either instance
+    const string body(500, 'y');
+    for (int i = 0; i<200; i++)
+        ((i%2) ? a : b).Store("http://d/"+std::to_string(i), body+std::to_string(i), "", "");
+
+    CHECK(file_size(dir+"/cache.dat")<=(off_t)maxsize);
+    CHECK(a.Lookup("http://d/198", entry) && entry.data==body+"198");
+    CHECK(b.Lookup("http://d/199", entry) && entry.data==body+"199");
+    CHECK(a.Lookup("http://d/199", entry) && entry.data==body+"199");
+}
+
+int main()
+{
+    string dir = make_temp_dir("test_urlcache");
+    test_store_lookup(dir);
+    remove_temp_dir(dir);
+
+    dir = make_temp_dir("test_urlcache");
+    test_refresh(dir);
+    remove_temp_dir(dir);
+
+    dir = make_temp_dir("test_urlcache");
+    test_compaction(dir);
+    remove_temp_dir(dir);
+
+    dir = make_temp_dir("test_urlcache");
+    test_shared(dir);
+    remove_temp_dir(dir);
+
+    return test_result();
+}
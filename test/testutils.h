@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * Minimal harness shared by the unit test programs: CHECK() counts the failed
+ * conditions, & the fixtures live in a temporary directory of their own.
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+#include <dirent.h>
+#include <unistd.h>
+
+static int nfailed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; nfailed++; } } while (0)
+
+/**
+ * @brief Create an empty temporary directory for the test fixtures
+ * @param[in] name prefix of the directory (e.g., the test name)
+ * @return directory path (exits if failed)
+ */
+static inline std::string make_temp_dir(const std::string &name)
+{
+    std::string tmpl = "/tmp/" + name + ".XXXXXX";
+    if (!mkdtemp(&tmpl[0]))
+    {
+        std::cerr << "mkdtemp failed" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return tmpl;
+}
+
+/**
+ * @brief Remove a directory created by make_temp_dir() along with its files
+ * @param[in] directory path
+ */
+static inline void remove_temp_dir(const std::string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    if (d)
+    {
+        struct dirent *e;
+        while ((e = readdir(d)))
+        {
+            std::string name(e->d_name);
+            if (name!="." && name!="..") remove((dir+"/"+name).c_str());
+        }
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+/**
+ * @brief Report the test outcome
+ * @return exit code of the test program
+ */
+static inline int test_result()
+{
+    if (nfailed) std::cout << nfailed << " check(s) failed" << std::endl;
+    else std::cout << "all checks passed" << std::endl;
+    return nfailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}